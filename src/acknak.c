@@ -0,0 +1,52 @@
+#include <gst/gst.h>
+#include "acknak.h"
+
+static const char *type_names[] = {
+	[ACKNAK_TYPE_ACK] = "ack",
+	[ACKNAK_TYPE_NAK] = "nak",
+	[ACKNAK_TYPE_CREDIT] = "credit",
+};
+
+GstEvent *acknak_event_new(enum AcknakType type, guint sequence, guint window)
+{
+	GstStructure *s;
+
+	g_return_val_if_fail(type <= ACKNAK_TYPE_CREDIT, NULL);
+
+	s = gst_structure_new(ACKNAK_EVENT_NAME,
+			      "type", G_TYPE_STRING, type_names[type],
+			      "sequence", G_TYPE_UINT, sequence,
+			      "window", G_TYPE_UINT, window,
+			      NULL);
+
+	return gst_event_new_custom(GST_EVENT_CUSTOM_UPSTREAM, s);
+}
+
+/*
+ * Returns FALSE for events that are not "uart-acknak"; the caller
+ * treats those as a plain ack.  Missing fields read as 0.
+ */
+gboolean acknak_event_parse(GstEvent *event, enum AcknakType *type, guint *sequence,
+			    guint *window)
+{
+	const GstStructure *s;
+	const char *name;
+	guint i;
+
+	s = gst_event_get_structure(event);
+	if (!s || !gst_structure_has_name(s, ACKNAK_EVENT_NAME))
+		return FALSE;
+
+	*type = ACKNAK_TYPE_ACK;
+	name = gst_structure_get_string(s, "type");
+	for (i = 0; name && i < G_N_ELEMENTS(type_names); i++)
+		if (g_str_equal(name, type_names[i]))
+			*type = i;
+
+	if (!gst_structure_get_uint(s, "sequence", sequence))
+		*sequence = 0;
+	if (!gst_structure_get_uint(s, "window", window))
+		*window = 0;
+
+	return TRUE;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <gst/gst.h>
+
+/*
+ * Acknowledgement between a uartsink and the uartsrc on the other end
+ * of the line.
+ *
+ * Downstream of uartsrc, whoever validates frames sends a custom
+ * upstream event.  An event without structure, or with a structure of
+ * another name, is taken as a plain ack.  A "uart-acknak" structure
+ * says more:
+ *
+ *   type      string  "ack", "nak" or "credit"
+ *   sequence  uint    sequence number of the frame acked / naked, the
+ *                     n-th frame since start counting from 0 (mod 256
+ *                     on the wire)
+ *   window    uint    for "credit", the number of frames the sender
+ *                     may have unacknowledged from now on
+ *
+ * On the wire, with acknak-window 0 (stop and wait) a response is a
+ * single ACKNAK_ACK or ACKNAK_NAK byte; credit can't be expressed.  With
+ * a window, each response is two bytes: the code, then the sequence
+ * (ack / nak) or the window (credit, at most 255).
+ */
+#define ACKNAK_ACK (0x06)
+#define ACKNAK_NAK (0x15)
+#define ACKNAK_CREDIT (0x11)
+
+#define ACKNAK_EVENT_NAME "uart-acknak"
+
+enum AcknakType {
+	ACKNAK_TYPE_ACK,
+	ACKNAK_TYPE_NAK,
+	ACKNAK_TYPE_CREDIT,
+};
+
+GstEvent *acknak_event_new(enum AcknakType type, guint sequence, guint window);
+gboolean acknak_event_parse(GstEvent *event, enum AcknakType *type, guint *sequence,
+			    guint *window);
@@ -0,0 +1,76 @@
+#include <glib.h>
+#include "fault.h"
+
+void fault_init(struct fault *fault)
+{
+	fault->seed = 0;
+	fault->loss = 0;
+	fault->burst = 1;
+	fault->corrupt = 0;
+	fault->delay = 0;
+	fault->rand = g_rand_new_with_seed(0);
+	fault->burst_left = 0;
+	fault->dropped = 0;
+	fault->corrupted = 0;
+	fault->delayed = 0;
+}
+
+void fault_clear(struct fault *fault)
+{
+	g_clear_pointer(&fault->rand, g_rand_free);
+}
+
+/* start over from seed; call when the stream (re)starts */
+void fault_reset(struct fault *fault)
+{
+	g_rand_set_seed(fault->rand, fault->seed);
+	fault->burst_left = 0;
+	fault->dropped = 0;
+	fault->corrupted = 0;
+	fault->delayed = 0;
+}
+
+/* TRUE if the current buffer is lost */
+gboolean fault_drop(struct fault *fault)
+{
+	if (fault->burst_left == 0 && fault->loss > 0 &&
+	    g_rand_double(fault->rand) < fault->loss)
+		fault->burst_left = MAX(fault->burst, 1);
+
+	if (fault->burst_left == 0)
+		return FALSE;
+
+	fault->burst_left--;
+	fault->dropped++;
+	return TRUE;
+}
+
+/* flip a random bit in some bytes; returns how many */
+gsize fault_corrupt(struct fault *fault, guint8 *data, gsize size)
+{
+	gsize n = 0;
+	gsize i;
+
+	if (fault->corrupt <= 0)
+		return 0;
+
+	for (i = 0; i < size; i++) {
+		if (g_rand_double(fault->rand) < fault->corrupt) {
+			data[i] ^= 1 << g_rand_int_range(fault->rand, 0, 8);
+			n++;
+		}
+	}
+	fault->corrupted += n;
+
+	return n;
+}
+
+/* extra delay, in nano sec, for the current buffer */
+guint64 fault_delay(struct fault *fault)
+{
+	if (fault->delay == 0)
+		return 0;
+
+	fault->delayed++;
+	return (guint64)g_rand_int_range(fault->rand, 0, fault->delay + 1) * 1000;
+}
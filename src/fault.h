@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+ * Fault injection for loss / throughput experiments.  Every decision
+ * comes from a GRand seeded with seed, so the same settings give the
+ * same faults run after run, independently for each element.
+ */
+struct fault {
+	guint32 seed;
+	gdouble loss;		/* probability that a loss burst starts at a buffer */
+	guint burst;		/* buffers lost per burst */
+	gdouble corrupt;	/* probability that a byte gets a bit flipped */
+	guint delay;		/* max extra delay per buffer, in micro sec */
+
+	GRand *rand;
+	guint burst_left;
+	guint64 dropped;	/* buffers */
+	guint64 corrupted;	/* bytes */
+	guint64 delayed;	/* buffers */
+};
+
+void fault_init(struct fault *fault);
+void fault_clear(struct fault *fault);
+void fault_reset(struct fault *fault);
+
+gboolean fault_drop(struct fault *fault);
+gsize fault_corrupt(struct fault *fault, guint8 *data, gsize size);
+guint64 fault_delay(struct fault *fault);
@@ -1,13 +1,17 @@
 #include <gst/gst.h>
 #include "config.h"
+#include "gstuartduplex.h"
 #include "gstuartsink.h"
 #include "gstuartsrc.h"
+#include "gstuarttransaction.h"
 
 static gboolean
 plugin_init (GstPlugin * plugin)
 {
         gst_element_register(plugin, "uartsink", GST_RANK_NONE, gst_uart_sink_get_type());
         gst_element_register(plugin, "uartsrc", GST_RANK_NONE, gst_uart_src_get_type());
+        gst_element_register(plugin, "uartduplex", GST_RANK_NONE, gst_uart_duplex_get_type());
+        gst_element_register(plugin, "uarttransaction", GST_RANK_NONE, gst_uart_transaction_get_type());
         return TRUE;
 }
 
@@ -0,0 +1,1201 @@
+/* GStreamer
+ * Copyright (C) 2025 Yasushi SHOJI <yashi@spacecubics.com>
+ *
+ * gstuartduplex.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * uartduplex opens a uart once and serves both directions from a single
+ * thread: data arriving on the sink pad is written to the device and
+ * data read from the device is pushed out of the src pad.  Since one
+ * loop owns the fd, ack / nak bytes for our own transmissions and the
+ * ack / nak we answer to the remote side never race each other.
+ */
+
+#define _GNU_SOURCE	/* pipe2() */
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <glib-object.h>
+
+#include "config.h"
+#include "gstuartduplex.h"
+#include "uart.h"
+#include "acknak.h"
+#include "bitswap.h"
+
+#define ACKNAK_DEFAULT_WAIT_TIME (100) /* 100 us */
+#define DEFAULT_BLOCKSIZE (4096)
+#define TX_QUEUE_MAX (4) /* buffers */
+#define RS485_TURNAROUND (2) /* characters of quiet before we take the bus */
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE("sink",
+								   GST_PAD_SINK,
+								   GST_PAD_ALWAYS,
+								   GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE("src",
+								  GST_PAD_SRC,
+								  GST_PAD_ALWAYS,
+								  GST_STATIC_CAPS_ANY);
+
+GST_DEBUG_CATEGORY_STATIC(gst_uart_duplex_debug);
+#define GST_CAT_DEFAULT gst_uart_duplex_debug
+
+enum {
+	ARG_0,
+	ARG_DEVICE,
+	ARG_BAUD_RATE,
+	ARG_PARITY,
+	ARG_BITSWAP,
+	ARG_ACKNAK,
+	ARG_ACKNAK_WAIT,
+	ARG_NAK_PROBABILITY,
+	ARG_BLOCKSIZE,
+	ARG_RS485,
+	ARG_RS485_RTS_ON_SEND,
+	ARG_RS485_DELAY_BEFORE,
+	ARG_RS485_DELAY_AFTER,
+	ARG_LOW_LATENCY,
+};
+
+struct _GstUartDuplexPrivate {
+	GstPad *sinkpad;
+	GstPad *srcpad;
+
+	char *device;
+	int baud_rate;
+	enum UartParity parity;
+	gboolean reconfigure;
+	gboolean bitswap;
+	gboolean acknak;
+	guint32 acknak_wait;
+	guint nak_probability;
+	guint blocksize;
+	struct uart_rs485 rs485;
+	gboolean low_latency;
+
+	struct uart *uart;
+	GstPoll *fdset;
+	GstPollFD pollfd;
+	GstPollFD wakefd;
+	int wake[2];
+	gboolean rx_started;
+	int rx_baud_rate;	/* in the caps last pushed */
+	enum UartParity rx_parity;
+	gboolean rx_bitswap;
+	GstClockTime rx_last;	/* monotonic, of the last byte received */
+
+	/* protected by lock */
+	GMutex lock;
+	GCond cond;
+	gboolean tx_flushing;
+	GQueue tx_queue;
+	GstBuffer *tx_buffer;
+	GstMapInfo tx_info;
+	gsize tx_offset;
+	gboolean tx_resent;
+	gboolean awaiting_ack;
+	GstClockTime ack_deadline;
+	GByteArray *responses;
+	guint64 response_count;
+	guint response_seq;	/* next frame we expect to answer */
+};
+
+typedef struct _GstUartDuplexPrivate GstUartDuplexPrivate;
+
+#define _do_init							\
+	GST_DEBUG_CATEGORY_INIT (gst_uart_duplex_debug, "uartduplex", GST_DEBUG_FG_YELLOW | GST_DEBUG_BOLD, "uartduplex element"); \
+	G_ADD_PRIVATE(GstUartDuplex);
+
+G_DEFINE_TYPE_WITH_CODE(GstUartDuplex, gst_uart_duplex, GST_TYPE_ELEMENT, _do_init);
+
+static void gst_uart_duplex_set_property(GObject * object, guint prop_id,
+					 const GValue * value, GParamSpec * pspec);
+static void gst_uart_duplex_get_property(GObject * object, guint prop_id, GValue * value,
+					 GParamSpec * pspec);
+static void gst_uart_duplex_dispose(GObject * obj);
+static void gst_uart_duplex_finalize(GObject * obj);
+static GstStateChangeReturn gst_uart_duplex_change_state(GstElement * element,
+							 GstStateChange transition);
+static GstFlowReturn gst_uart_duplex_chain(GstPad * pad, GstObject * parent, GstBuffer * buffer);
+static gboolean gst_uart_duplex_sink_event(GstPad * pad, GstObject * parent, GstEvent * event);
+static gboolean gst_uart_duplex_src_event(GstPad * pad, GstObject * parent, GstEvent * event);
+static gboolean gst_uart_duplex_sink_activate_mode(GstPad * pad, GstObject * parent,
+						   GstPadMode mode, gboolean active);
+static gboolean gst_uart_duplex_src_activate_mode(GstPad * pad, GstObject * parent,
+						  GstPadMode mode, gboolean active);
+static void gst_uart_duplex_loop(GstUartDuplex * duplex);
+
+static void
+gst_uart_duplex_class_init(GstUartDuplexClass * klass)
+{
+	GObjectClass *gobject_class;
+	GstElementClass *gstelement_class;
+
+	gobject_class = G_OBJECT_CLASS(klass);
+	gstelement_class = GST_ELEMENT_CLASS(klass);
+
+	gobject_class->set_property = gst_uart_duplex_set_property;
+	gobject_class->get_property = gst_uart_duplex_get_property;
+	gobject_class->dispose = gst_uart_duplex_dispose;
+	gobject_class->finalize = gst_uart_duplex_finalize;
+
+	gst_element_class_set_static_metadata(gstelement_class, "UART Duplex", "Source/Sink/UART",
+					      "Read data from and write data to a uart / tty",
+					      "Yasushi SHOJI <yashi@spacecubics.com>");
+	gst_element_class_add_static_pad_template(gstelement_class, &sinktemplate);
+	gst_element_class_add_static_pad_template(gstelement_class, &srctemplate);
+
+	gstelement_class->change_state = GST_DEBUG_FUNCPTR(gst_uart_duplex_change_state);
+
+	g_object_class_install_property(gobject_class, ARG_DEVICE,
+					g_param_spec_string("device", "Device",
+							    "UART / tty device to read from and write to",
+							    "ttyS0",
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BAUD_RATE,
+					g_param_spec_int("baud-rate", "Baud rate",
+							 "baud rate for the device",
+							 50, 4000000, 115200,
+							 G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							 G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_PARITY,
+					g_param_spec_string("parity", "Parity",
+							    "Parity checking for the device",
+							    "no",
+							    G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							    G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BITSWAP,
+					g_param_spec_boolean("bitswap", "Bit Swap",
+							     "Swap bits in a byte",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ACKNAK,
+					g_param_spec_boolean("acknak", "Acknowledgement",
+							     "Enable acknowledgement arbitration",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ACKNAK_WAIT,
+					g_param_spec_uint("acknak-wait", "Ack/Nak Wait Time (usec)",
+							  "Wait time for Ack / Nak in micro sec",
+							  0, 1000000, ACKNAK_DEFAULT_WAIT_TIME,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_NAK_PROBABILITY,
+					g_param_spec_uint("nak-probability", "NAK Probability",
+							  "In number of packet, likelihood of returning NAK instead of ACK",
+							  0, G_MAXUINT, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BLOCKSIZE,
+					g_param_spec_uint("blocksize", "Block size",
+							  "Size in bytes to read per buffer",
+							  1, G_MAXUINT, DEFAULT_BLOCKSIZE,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485,
+					g_param_spec_boolean("rs485", "RS-485",
+							     "Half duplex on an RS-485 bus; RTS enables the transmitter",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_RTS_ON_SEND,
+					g_param_spec_boolean("rs485-rts-on-send", "RS-485 RTS On Send",
+							     "RTS is high while sending (and low after), or the other way around",
+							     TRUE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_DELAY_BEFORE,
+					g_param_spec_uint("rs485-delay-before", "RS-485 Delay Before Send (msec)",
+							  "Time from enabling the transmitter to the first bit",
+							  0, 1000, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_DELAY_AFTER,
+					g_param_spec_uint("rs485-delay-after", "RS-485 Delay After Send (msec)",
+							  "Time from the last bit to disabling the transmitter",
+							  0, 1000, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_LOW_LATENCY,
+					g_param_spec_boolean("low-latency", "Low Latency",
+							     "Have the driver hand over data as soon as it comes in "
+							     "(ASYNC_LOW_LATENCY, USB latency timer, FIFO trigger level)",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_uart_duplex_init(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	priv->sinkpad = gst_pad_new_from_static_template(&sinktemplate, "sink");
+	gst_pad_set_chain_function(priv->sinkpad, GST_DEBUG_FUNCPTR(gst_uart_duplex_chain));
+	gst_pad_set_event_function(priv->sinkpad, GST_DEBUG_FUNCPTR(gst_uart_duplex_sink_event));
+	gst_pad_set_activatemode_function(priv->sinkpad,
+					  GST_DEBUG_FUNCPTR(gst_uart_duplex_sink_activate_mode));
+	gst_element_add_pad(GST_ELEMENT(duplex), priv->sinkpad);
+
+	priv->srcpad = gst_pad_new_from_static_template(&srctemplate, "src");
+	gst_pad_set_event_function(priv->srcpad, GST_DEBUG_FUNCPTR(gst_uart_duplex_src_event));
+	gst_pad_set_activatemode_function(priv->srcpad,
+					  GST_DEBUG_FUNCPTR(gst_uart_duplex_src_activate_mode));
+	gst_element_add_pad(GST_ELEMENT(duplex), priv->srcpad);
+
+	priv->device = NULL;
+	priv->baud_rate = 115200;
+	priv->parity = UART_PARITY_NO;
+	priv->reconfigure = FALSE;
+	priv->bitswap = FALSE;
+	priv->acknak = FALSE;
+	priv->acknak_wait = ACKNAK_DEFAULT_WAIT_TIME;
+	priv->nak_probability = 0;
+	priv->blocksize = DEFAULT_BLOCKSIZE;
+	priv->rs485.enabled = FALSE;
+	priv->rs485.rts_on_send = TRUE;
+	priv->rs485.delay_before = 0;
+	priv->rs485.delay_after = 0;
+	priv->rs485.rx_during_tx = FALSE;
+	priv->low_latency = FALSE;
+	priv->uart = NULL;
+	priv->fdset = NULL;
+	priv->wake[0] = -1;
+	priv->wake[1] = -1;
+	priv->rx_started = FALSE;
+
+	g_mutex_init(&priv->lock);
+	g_cond_init(&priv->cond);
+	priv->tx_flushing = TRUE;
+	g_queue_init(&priv->tx_queue);
+	priv->tx_buffer = NULL;
+	priv->tx_offset = 0;
+	priv->tx_resent = FALSE;
+	priv->awaiting_ack = FALSE;
+	priv->ack_deadline = GST_CLOCK_TIME_NONE;
+	priv->responses = g_byte_array_new();
+	priv->response_count = 0;
+	priv->response_seq = 0;
+}
+
+static void
+gst_uart_duplex_dispose(GObject * obj)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(GST_UART_DUPLEX(obj));
+	GST_DEBUG("priv->device: %s (@%p)", priv->device, priv->device);
+	if (priv->device) {
+		g_free(priv->device);
+		priv->device = NULL;
+	}
+
+	G_OBJECT_CLASS(gst_uart_duplex_parent_class)->dispose(obj);
+}
+
+static void
+gst_uart_duplex_finalize(GObject * obj)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(GST_UART_DUPLEX(obj));
+
+	g_byte_array_unref(priv->responses);
+	g_cond_clear(&priv->cond);
+	g_mutex_clear(&priv->lock);
+
+	G_OBJECT_CLASS(gst_uart_duplex_parent_class)->finalize(obj);
+}
+
+static void
+gst_uart_duplex_wake(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	guint8 c = 0;
+
+	if (priv->wake[1] >= 0 && write(priv->wake[1], &c, 1) < 0 && errno != EAGAIN)
+		GST_WARNING_OBJECT(duplex, "cannot wake the loop: %s", g_strerror(errno));
+}
+
+/* the port setup the properties ask for; called with the object lock */
+static void
+gst_uart_duplex_get_config(GstUartDuplex * duplex, struct uart_config *config)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	config->baud_rate = priv->baud_rate;
+	config->parity = priv->parity;
+	config->mark_errors = FALSE;
+}
+
+static gboolean
+gst_uart_duplex_open(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	struct uart_config config;
+	GError *error = NULL;
+
+	if (!priv->device || priv->device[0] == '\0')
+		goto no_device;
+
+	priv->uart = uart_open(priv->device, O_RDWR | O_NONBLOCK);
+	if (!priv->uart)
+		goto open_failed;
+
+	GST_DEBUG_OBJECT(duplex, "opened %s as fd %d", priv->device, priv->uart->fd);
+
+	/* uart_open() flushed already */
+	GST_OBJECT_LOCK(duplex);
+	gst_uart_duplex_get_config(duplex, &config);
+	GST_OBJECT_UNLOCK(duplex);
+	if (uart_configure(priv->uart, &config, TCSANOW, &error) < 0)
+		goto setting_failed;
+	priv->reconfigure = FALSE;
+
+	if (priv->rs485.enabled) {
+		int ret = uart_set_rs485(priv->uart, &priv->rs485);
+
+		if (ret < 0)
+			GST_ELEMENT_WARNING(duplex, RESOURCE, SETTINGS,
+					    ("Could not set up RS-485 on \"%s\".", priv->device),
+					    GST_ERROR_SYSTEM);
+		else if (ret > 0)
+			GST_INFO_OBJECT(duplex, "no RS-485 in the driver; switching RTS ourselves");
+	}
+	if (priv->low_latency) {
+		struct uart_latency latency;
+
+		if (uart_set_low_latency(priv->uart, TRUE) < 0 && errno != ENOTTY)
+			GST_ELEMENT_WARNING(duplex, RESOURCE, SETTINGS,
+					    ("Could not lower the latency of \"%s\".", priv->device),
+					    GST_ERROR_SYSTEM);
+		if (uart_get_latency(priv->uart, &latency) == 0)
+			GST_INFO_OBJECT(duplex, "low latency %d, latency timer %d msec, rx trigger %d bytes",
+					latency.low_latency, latency.latency_timer,
+					latency.rx_trig_bytes);
+	}
+
+	if (pipe2(priv->wake, O_CLOEXEC | O_NONBLOCK) < 0)
+		goto poll_failed;
+
+	priv->fdset = gst_poll_new(TRUE);
+	if (!priv->fdset)
+		goto poll_failed;
+
+	gst_poll_fd_init(&priv->pollfd);
+	priv->pollfd.fd = priv->uart->fd;
+	gst_poll_add_fd(priv->fdset, &priv->pollfd);
+	gst_poll_fd_ctl_read(priv->fdset, &priv->pollfd, TRUE);
+
+	gst_poll_fd_init(&priv->wakefd);
+	priv->wakefd.fd = priv->wake[0];
+	gst_poll_add_fd(priv->fdset, &priv->wakefd);
+	gst_poll_fd_ctl_read(priv->fdset, &priv->wakefd, TRUE);
+	gst_poll_set_flushing(priv->fdset, TRUE);
+
+	priv->rx_started = FALSE;
+	priv->rx_baud_rate = 0;
+	priv->rx_last = 0;
+	priv->response_count = 0;
+	priv->response_seq = 0;
+
+	return TRUE;
+
+no_device:
+	{
+		GST_ELEMENT_ERROR(duplex, RESOURCE, NOT_FOUND,
+				  ("No device name specified for data communication."), (NULL));
+		return FALSE;
+	}
+open_failed:
+	{
+		GST_ELEMENT_ERROR(duplex, RESOURCE, OPEN_READ_WRITE,
+				  ("Could not open device \"%s\" for data communication.", priv->device),
+				  GST_ERROR_SYSTEM);
+		return FALSE;
+	}
+setting_failed:
+	{
+		GST_ELEMENT_ERROR(duplex, RESOURCE, SETTINGS,
+				  ("%s", error->message), GST_ERROR_SYSTEM);
+		g_clear_error(&error);
+		uart_close(priv->uart);
+		priv->uart = NULL;
+		return FALSE;
+	}
+poll_failed:
+	{
+		GST_ELEMENT_ERROR(duplex, RESOURCE, OPEN_READ_WRITE, (NULL),
+				  GST_ERROR_SYSTEM);
+		if (priv->wake[0] >= 0) {
+			g_close(priv->wake[0], NULL);
+			g_close(priv->wake[1], NULL);
+			priv->wake[0] = priv->wake[1] = -1;
+		}
+		uart_close(priv->uart);
+		priv->uart = NULL;
+		return FALSE;
+	}
+}
+
+static void
+gst_uart_duplex_close(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	if (!priv->uart)
+		return;
+
+	gst_poll_free(priv->fdset);
+	priv->fdset = NULL;
+	/* set_property wakes us under the lock */
+	GST_OBJECT_LOCK(duplex);
+	g_close(priv->wake[0], NULL);
+	g_close(priv->wake[1], NULL);
+	priv->wake[0] = priv->wake[1] = -1;
+	GST_OBJECT_UNLOCK(duplex);
+
+	uart_close(priv->uart);
+	priv->uart = NULL;
+}
+
+static GstStateChangeReturn
+gst_uart_duplex_change_state(GstElement * element, GstStateChange transition)
+{
+	GstUartDuplex *duplex = GST_UART_DUPLEX(element);
+	GstStateChangeReturn ret;
+
+	switch (transition) {
+	case GST_STATE_CHANGE_READY_TO_PAUSED:
+		if (!gst_uart_duplex_open(duplex))
+			return GST_STATE_CHANGE_FAILURE;
+		break;
+	default:
+		break;
+	}
+
+	ret = GST_ELEMENT_CLASS(gst_uart_duplex_parent_class)->change_state(element, transition);
+	if (ret == GST_STATE_CHANGE_FAILURE)
+		return ret;
+
+	switch (transition) {
+	case GST_STATE_CHANGE_READY_TO_PAUSED:
+	case GST_STATE_CHANGE_PLAYING_TO_PAUSED:
+		/* the receive side is a live source */
+		ret = GST_STATE_CHANGE_NO_PREROLL;
+		break;
+	case GST_STATE_CHANGE_PAUSED_TO_READY:
+		gst_uart_duplex_close(duplex);
+		break;
+	default:
+		break;
+	}
+
+	return ret;
+}
+
+/* drop whatever is queued for transmission; called with lock held */
+static void
+gst_uart_duplex_tx_clear(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	g_queue_clear_full(&priv->tx_queue, (GDestroyNotify) gst_buffer_unref);
+	if (priv->tx_buffer) {
+		gst_buffer_unmap(priv->tx_buffer, &priv->tx_info);
+		gst_buffer_unref(priv->tx_buffer);
+		priv->tx_buffer = NULL;
+	}
+	priv->awaiting_ack = FALSE;
+	g_cond_broadcast(&priv->cond);
+}
+
+static gboolean
+gst_uart_duplex_sink_activate_mode(GstPad * pad, GstObject * parent, GstPadMode mode,
+				   gboolean active)
+{
+	GstUartDuplex *duplex = GST_UART_DUPLEX(parent);
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	if (mode != GST_PAD_MODE_PUSH)
+		return FALSE;
+
+	g_mutex_lock(&priv->lock);
+	priv->tx_flushing = !active;
+	if (!active)
+		gst_uart_duplex_tx_clear(duplex);
+	g_mutex_unlock(&priv->lock);
+
+	return TRUE;
+}
+
+static gboolean
+gst_uart_duplex_src_activate_mode(GstPad * pad, GstObject * parent, GstPadMode mode,
+				  gboolean active)
+{
+	GstUartDuplex *duplex = GST_UART_DUPLEX(parent);
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	if (mode != GST_PAD_MODE_PUSH)
+		return FALSE;
+
+	if (active) {
+		gst_poll_set_flushing(priv->fdset, FALSE);
+		return gst_pad_start_task(pad, (GstTaskFunction) gst_uart_duplex_loop, duplex, NULL);
+	}
+
+	if (priv->fdset)
+		gst_poll_set_flushing(priv->fdset, TRUE);
+	return gst_pad_stop_task(pad);
+}
+
+static GstFlowReturn
+gst_uart_duplex_chain(GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+	GstUartDuplex *duplex = GST_UART_DUPLEX(parent);
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	GstMapInfo info;
+
+	GST_DEBUG_OBJECT(duplex, "buffer size=%" G_GSIZE_FORMAT, gst_buffer_get_size(buffer));
+
+	if (priv->bitswap) {
+		buffer = gst_buffer_make_writable(buffer);
+		gst_buffer_map(buffer, &info, GST_MAP_WRITE);
+		bitswap(info.data, info.size);
+		gst_buffer_unmap(buffer, &info);
+	}
+
+	g_mutex_lock(&priv->lock);
+	while (!priv->tx_flushing && g_queue_get_length(&priv->tx_queue) >= TX_QUEUE_MAX)
+		g_cond_wait(&priv->cond, &priv->lock);
+	if (priv->tx_flushing) {
+		g_mutex_unlock(&priv->lock);
+		gst_buffer_unref(buffer);
+		return GST_FLOW_FLUSHING;
+	}
+	g_queue_push_tail(&priv->tx_queue, buffer);
+	g_mutex_unlock(&priv->lock);
+	gst_uart_duplex_wake(duplex);
+
+	return GST_FLOW_OK;
+}
+
+static gboolean
+gst_uart_duplex_sink_event(GstPad * pad, GstObject * parent, GstEvent * event)
+{
+	GstUartDuplex *duplex = GST_UART_DUPLEX(parent);
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	GST_DEBUG_OBJECT(pad, "%s", GST_EVENT_TYPE_NAME(event));
+
+	switch (GST_EVENT_TYPE(event)) {
+	case GST_EVENT_FLUSH_START:
+		g_mutex_lock(&priv->lock);
+		priv->tx_flushing = TRUE;
+		gst_uart_duplex_tx_clear(duplex);
+		g_mutex_unlock(&priv->lock);
+		break;
+	case GST_EVENT_FLUSH_STOP:
+		g_mutex_lock(&priv->lock);
+		priv->tx_flushing = FALSE;
+		g_mutex_unlock(&priv->lock);
+		break;
+	case GST_EVENT_EOS:
+		/* the transmit side is done; the receive side keeps going */
+		g_mutex_lock(&priv->lock);
+		while (!priv->tx_flushing &&
+		       (priv->tx_buffer || !g_queue_is_empty(&priv->tx_queue)))
+			g_cond_wait(&priv->cond, &priv->lock);
+		g_mutex_unlock(&priv->lock);
+		break;
+	default:
+		break;
+	}
+	gst_event_unref(event);
+
+	return TRUE;
+}
+
+static gboolean
+gst_uart_duplex_src_event(GstPad * pad, GstObject * parent, GstEvent * event)
+{
+	GstUartDuplex *duplex = GST_UART_DUPLEX(parent);
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	enum AcknakType type;
+	guint sequence;
+	guint window;
+	guint8 response;
+
+	switch (GST_EVENT_TYPE(event)) {
+	case GST_EVENT_CUSTOM_UPSTREAM:
+		GST_DEBUG_OBJECT(duplex, "got a custom event %" GST_PTR_FORMAT, event);
+		if (!priv->acknak) {
+			GST_INFO_OBJECT(duplex, "but not sending it since ack/nak is not enabled");
+			gst_event_unref(event);
+			return TRUE;
+		}
+
+		g_mutex_lock(&priv->lock);
+		/* anything but ours is a plain ack of the next frame */
+		if (!acknak_event_parse(event, &type, &sequence, &window)) {
+			type = ACKNAK_TYPE_ACK;
+			sequence = priv->response_seq;
+			window = 0;
+		}
+		/* stop and wait only; a credit needs a window to go in */
+		if (type == ACKNAK_TYPE_CREDIT) {
+			g_mutex_unlock(&priv->lock);
+			GST_WARNING_OBJECT(duplex, "credit for %u frames needs an ack/nak window, "
+					   "which uartduplex does not have; dropped", window);
+			gst_event_unref(event);
+			return FALSE;
+		}
+		priv->response_count++;
+		if (type == ACKNAK_TYPE_NAK ||
+		    (priv->nak_probability && ((priv->response_count % priv->nak_probability) == 0))) {
+			response = ACKNAK_NAK;
+			GST_WARNING_OBJECT(duplex, "Sending nak for frame %u", sequence);
+			priv->response_seq = sequence;
+		}
+		else {
+			response = ACKNAK_ACK;
+			GST_DEBUG_OBJECT(duplex, "Sending ack for frame %u", sequence);
+			priv->response_seq = sequence + 1;
+		}
+		g_byte_array_append(priv->responses, &response, 1);
+		g_mutex_unlock(&priv->lock);
+		gst_uart_duplex_wake(duplex);
+
+		gst_event_unref(event);
+		return TRUE;
+	default:
+		return gst_pad_event_default(pad, parent, event);
+	}
+}
+
+/* called with lock held */
+static void
+gst_uart_duplex_tx_done(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	gst_buffer_unmap(priv->tx_buffer, &priv->tx_info);
+	gst_buffer_unref(priv->tx_buffer);
+	priv->tx_buffer = NULL;
+	priv->awaiting_ack = FALSE;
+	g_cond_broadcast(&priv->cond);
+}
+
+/*
+ * A byte arrived while we wait for ack / nak; handle it the same way
+ * uartsink does.  Returns TRUE if the byte was consumed.  Called with
+ * lock held.
+ */
+static gboolean
+gst_uart_duplex_handle_acknak(GstUartDuplex * duplex, guint8 acknak)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+
+	switch (acknak) {
+	case ACKNAK_ACK:
+		GST_DEBUG_OBJECT(duplex, "ack (0x%02x) received", acknak);
+		gst_uart_duplex_tx_done(duplex);
+		return TRUE;
+	case ACKNAK_NAK:
+		GST_DEBUG_OBJECT(duplex, "nak (0x%02x) received", acknak);
+		priv->awaiting_ack = FALSE;
+		priv->tx_offset = 0;
+		priv->tx_resent = TRUE;
+		return TRUE;
+	default:
+		GST_DEBUG_OBJECT(duplex, "unknown byte for ack/nak (0x%02x)", acknak);
+		return FALSE;
+	}
+}
+
+static GstFlowReturn
+gst_uart_duplex_push(GstUartDuplex * duplex, GstBuffer * buffer)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	GstClock *clock;
+	int baud_rate;
+	enum UartParity parity;
+	gboolean swap;
+
+	GST_OBJECT_LOCK(duplex);
+	baud_rate = priv->baud_rate;
+	parity = priv->parity;
+	swap = priv->bitswap;
+	GST_OBJECT_UNLOCK(duplex);
+
+	if (!priv->rx_started) {
+		gchar *stream_id;
+
+		stream_id = gst_pad_create_stream_id(priv->srcpad, GST_ELEMENT(duplex), NULL);
+		gst_pad_push_event(priv->srcpad, gst_event_new_stream_start(stream_id));
+		g_free(stream_id);
+	}
+	/* the line settings, as uartsrc advertises them; again when they change */
+	if (baud_rate != priv->rx_baud_rate || parity != priv->rx_parity ||
+	    swap != priv->rx_bitswap) {
+		GstCaps *caps;
+
+		caps = gst_caps_new_simple("application/x-uart",
+					   "baud", G_TYPE_INT, baud_rate,
+					   "parity", G_TYPE_STRING, uart_parity_to_string(parity),
+					   "bitswap", G_TYPE_BOOLEAN, swap, NULL);
+		GST_DEBUG_OBJECT(duplex, "caps %" GST_PTR_FORMAT, caps);
+		gst_pad_push_event(priv->srcpad, gst_event_new_caps(caps));
+		gst_caps_unref(caps);
+		priv->rx_baud_rate = baud_rate;
+		priv->rx_parity = parity;
+		priv->rx_bitswap = swap;
+	}
+	if (!priv->rx_started) {
+		GstSegment segment;
+
+		gst_segment_init(&segment, GST_FORMAT_TIME);
+		gst_pad_push_event(priv->srcpad, gst_event_new_segment(&segment));
+		priv->rx_started = TRUE;
+	}
+
+	clock = gst_element_get_clock(GST_ELEMENT(duplex));
+	if (clock) {
+		GstClockTime now = gst_clock_get_time(clock);
+		GstClockTime base_time = gst_element_get_base_time(GST_ELEMENT(duplex));
+
+		if (now > base_time)
+			GST_BUFFER_PTS(buffer) = now - base_time;
+		gst_object_unref(clock);
+	}
+
+	GST_DEBUG_OBJECT(duplex, "%" GST_PTR_FORMAT, buffer);
+
+	return gst_pad_push(priv->srcpad, buffer);
+}
+
+static GstFlowReturn
+gst_uart_duplex_receive(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	GstBuffer *buffer;
+	GstMapInfo info;
+	gssize red;
+	gsize offset = 0;
+
+	buffer = gst_buffer_new_allocate(NULL, priv->blocksize, NULL);
+	gst_buffer_map(buffer, &info, GST_MAP_WRITE);
+	red = read(priv->uart->fd, info.data, info.size);
+	if (red <= 0) {
+		gst_buffer_unmap(buffer, &info);
+		gst_buffer_unref(buffer);
+		if (red < 0 && (errno == EAGAIN || errno == EINTR))
+			return GST_FLOW_OK;
+		if (red == 0)
+			return GST_FLOW_EOS;
+		GST_ELEMENT_ERROR(duplex, RESOURCE, READ,
+				  ("Could not read from device \"%s\".", priv->device),
+				  GST_ERROR_SYSTEM);
+		return GST_FLOW_ERROR;
+	}
+	priv->rx_last = g_get_monotonic_time() * GST_USECOND;
+
+	g_mutex_lock(&priv->lock);
+	if (priv->awaiting_ack && gst_uart_duplex_handle_acknak(duplex, info.data[0]))
+		offset = 1;
+	g_mutex_unlock(&priv->lock);
+
+	if (priv->bitswap)
+		bitswap(info.data + offset, red - offset);
+	gst_buffer_unmap(buffer, &info);
+
+	if ((gsize)red == offset) {
+		gst_buffer_unref(buffer);
+		return GST_FLOW_OK;
+	}
+	gst_buffer_resize(buffer, offset, red - offset);
+
+	GST_DEBUG_OBJECT(duplex, "read %zd bytes from \"%s\"", red, priv->device);
+
+	return gst_uart_duplex_push(duplex, buffer);
+}
+
+static void
+gst_uart_duplex_reconfigure(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	struct uart_config config;
+	GError *error = NULL;
+	int ret;
+
+	GST_OBJECT_LOCK(duplex);
+	if (!priv->reconfigure) {
+		GST_OBJECT_UNLOCK(duplex);
+		return;
+	}
+	priv->reconfigure = FALSE;
+	gst_uart_duplex_get_config(duplex, &config);
+	GST_OBJECT_UNLOCK(duplex);
+
+	ret = uart_reconfigure(priv->uart, &config, &error);
+	if (ret < 0) {
+		GST_ELEMENT_WARNING(duplex, RESOURCE, SETTINGS, ("%s", error->message), (NULL));
+		g_clear_error(&error);
+	}
+	else if (ret > 0) {
+		GST_INFO_OBJECT(duplex, "now at %d baud, parity %d",
+				uart_termios_baud_rate(&priv->uart->current), uart_get_parity(priv->uart));
+	}
+}
+
+/*
+ * On RS-485, how long until the bus has been quiet for RS485_TURNAROUND
+ * characters and is ours to talk on; 0 if it is now.
+ */
+static GstClockTime
+gst_uart_duplex_bus_busy(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	GstClockTime now, free_at;
+
+	if (!priv->rs485.enabled)
+		return 0;
+
+	now = g_get_monotonic_time() * GST_USECOND;
+	free_at = priv->rx_last + uart_wire_time(priv->uart, RS485_TURNAROUND);
+
+	return free_at > now ? free_at - now : 0;
+}
+
+static GstFlowReturn
+gst_uart_duplex_transmit(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	GstFlowReturn flow = GST_FLOW_OK;
+	gssize written;
+
+	g_mutex_lock(&priv->lock);
+
+	/* answers first; the remote side is waiting for them */
+	if (priv->responses->len) {
+		uart_rs485_begin(priv->uart);
+		written = write(priv->uart->fd, priv->responses->data, priv->responses->len);
+		if (written > 0)
+			g_byte_array_remove_range(priv->responses, 0, written);
+		if (!priv->responses->len)
+			uart_rs485_end(priv->uart);
+	}
+
+	if (priv->awaiting_ack) {
+		if (g_get_monotonic_time() * GST_USECOND < priv->ack_deadline)
+			goto done;
+		GST_DEBUG_OBJECT(duplex, "ack/nak timeout; resending");
+		priv->awaiting_ack = FALSE;
+		priv->tx_offset = 0;
+		priv->tx_resent = TRUE;
+	}
+
+	if (!priv->tx_buffer) {
+		/* an answer may still be coming in */
+		if (gst_uart_duplex_bus_busy(duplex) > 0)
+			goto done;
+		/* between buffers; nothing of ours is half way out */
+		gst_uart_duplex_reconfigure(duplex);
+		priv->tx_buffer = g_queue_pop_head(&priv->tx_queue);
+		if (!priv->tx_buffer)
+			goto done;
+		gst_buffer_map(priv->tx_buffer, &priv->tx_info, GST_MAP_READ);
+		priv->tx_offset = 0;
+		priv->tx_resent = FALSE;
+		g_cond_broadcast(&priv->cond);
+	}
+
+	uart_rs485_begin(priv->uart);
+	written = write(priv->uart->fd, priv->tx_info.data + priv->tx_offset,
+			priv->tx_info.size - priv->tx_offset);
+	if (written < 0) {
+		if (errno == EAGAIN || errno == EINTR)
+			goto done;
+		GST_ELEMENT_ERROR(duplex, RESOURCE, WRITE,
+				  ("Could not write to device \"%s\".", priv->device),
+				  GST_ERROR_SYSTEM);
+		gst_uart_duplex_tx_done(duplex);
+		flow = GST_FLOW_ERROR;
+		goto done;
+	}
+	priv->tx_offset += written;
+	if (priv->tx_offset < priv->tx_info.size)
+		goto done;
+
+	GST_DEBUG_OBJECT(duplex, "%" G_GSIZE_FORMAT " bytes written", priv->tx_info.size);
+	/* turn the bus around as soon as the last bit is out */
+	uart_rs485_end(priv->uart);
+	/* like uartsink, a buffer is resent at most once */
+	if (priv->acknak && !priv->tx_resent) {
+		int queued = MAX(uart_get_output_queue(priv->uart), 0);
+
+		priv->awaiting_ack = TRUE;
+		priv->ack_deadline = g_get_monotonic_time() * GST_USECOND +
+			uart_wire_time(priv->uart, queued) + priv->acknak_wait * GST_USECOND;
+	}
+	else
+		gst_uart_duplex_tx_done(duplex);
+
+done:
+	g_mutex_unlock(&priv->lock);
+
+	return flow;
+}
+
+static void
+gst_uart_duplex_loop(GstUartDuplex * duplex)
+{
+	GstUartDuplexPrivate *priv = gst_uart_duplex_get_instance_private(duplex);
+	GstClockTime timeout = GST_CLOCK_TIME_NONE;
+	GstFlowReturn flow = GST_FLOW_OK;
+	gboolean want_write;
+	GstClockTime busy;
+	guint8 buf[64];
+	gint ret;
+
+	g_mutex_lock(&priv->lock);
+	want_write = priv->responses->len > 0 ||
+		(!priv->awaiting_ack && (priv->tx_buffer || !g_queue_is_empty(&priv->tx_queue)));
+	if (priv->awaiting_ack) {
+		GstClockTime now = g_get_monotonic_time() * GST_USECOND;
+
+		timeout = priv->ack_deadline > now ? priv->ack_deadline - now : 0;
+	}
+	/* wait for the bus to go quiet rather than for the fd to be writable */
+	else if (want_write && !priv->tx_buffer && !priv->responses->len &&
+		 (busy = gst_uart_duplex_bus_busy(duplex)) > 0) {
+		want_write = FALSE;
+		timeout = busy;
+	}
+	g_mutex_unlock(&priv->lock);
+	gst_poll_fd_ctl_write(priv->fdset, &priv->pollfd, want_write);
+
+	ret = gst_poll_wait(priv->fdset, timeout);
+	if (ret < 0) {
+		if (errno == EBUSY)
+			goto flushing;
+		if (errno == EINTR || errno == EAGAIN)
+			return;
+		GST_ELEMENT_ERROR(duplex, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+		goto pause;
+	}
+
+	if (gst_poll_fd_can_read(priv->fdset, &priv->wakefd))
+		while (read(priv->wake[0], buf, sizeof(buf)) > 0)
+			;
+
+	if (gst_poll_fd_has_error(priv->fdset, &priv->pollfd) ||
+	    gst_poll_fd_has_closed(priv->fdset, &priv->pollfd)) {
+		GST_ELEMENT_ERROR(duplex, RESOURCE, READ,
+				  ("Device \"%s\" went away.", priv->device), (NULL));
+		goto pause;
+	}
+
+	if (gst_poll_fd_can_read(priv->fdset, &priv->pollfd)) {
+		flow = gst_uart_duplex_receive(duplex);
+		if (flow == GST_FLOW_NOT_LINKED) {
+			/* nobody listens to the receive side; keep transmitting */
+			GST_LOG_OBJECT(duplex, "not linked; dropping received data");
+			flow = GST_FLOW_OK;
+		}
+		if (flow != GST_FLOW_OK)
+			goto pause;
+	}
+
+	flow = gst_uart_duplex_transmit(duplex);
+	if (flow != GST_FLOW_OK)
+		goto pause;
+
+	return;
+
+flushing:
+	GST_DEBUG_OBJECT(duplex, "flushing, pausing task");
+	gst_pad_pause_task(priv->srcpad);
+	return;
+pause:
+	GST_DEBUG_OBJECT(duplex, "pausing task, reason %s", gst_flow_get_name(flow));
+	if (flow == GST_FLOW_EOS)
+		gst_pad_push_event(priv->srcpad, gst_event_new_eos());
+	else if (flow == GST_FLOW_NOT_NEGOTIATED || flow < GST_FLOW_EOS)
+		GST_ELEMENT_FLOW_ERROR(duplex, flow);
+	gst_pad_pause_task(priv->srcpad);
+}
+
+static void
+gst_uart_duplex_set_property(GObject * object, guint prop_id, const GValue * value,
+			     GParamSpec * pspec)
+{
+	GstUartDuplex *duplex;
+	GstUartDuplexPrivate *priv;
+
+	duplex = GST_UART_DUPLEX(object);
+	priv = gst_uart_duplex_get_instance_private(duplex);
+
+	switch (prop_id) {
+	case ARG_DEVICE:
+		g_free(priv->device);
+		priv->device = g_value_dup_string(value);
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), priv->device);
+		break;
+
+	case ARG_BAUD_RATE:
+		GST_OBJECT_LOCK(duplex);
+		priv->baud_rate = g_value_get_int(value);
+		priv->reconfigure = TRUE;
+		gst_uart_duplex_wake(duplex);
+		GST_OBJECT_UNLOCK(duplex);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->baud_rate);
+		break;
+
+	case ARG_PARITY:
+	{
+		const char *s = g_value_get_string(value);
+		GST_OBJECT_LOCK(duplex);
+		if (!uart_parity_from_string(s, &priv->parity))
+			GST_WARNING_OBJECT(duplex, "unknown parity \"%s\"", s);
+		priv->reconfigure = TRUE;
+		gst_uart_duplex_wake(duplex);
+		GST_OBJECT_UNLOCK(duplex);
+
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
+		break;
+	}
+	case ARG_BITSWAP:
+		priv->bitswap = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->bitswap);
+		break;
+
+	case ARG_ACKNAK:
+		priv->acknak = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->acknak);
+		break;
+
+	case ARG_ACKNAK_WAIT:
+		priv->acknak_wait = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->acknak_wait);
+		break;
+
+	case ARG_NAK_PROBABILITY:
+		priv->nak_probability = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->nak_probability);
+		break;
+
+	case ARG_BLOCKSIZE:
+		priv->blocksize = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->blocksize);
+		break;
+
+	case ARG_RS485:
+		priv->rs485.enabled = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->rs485.enabled);
+		break;
+
+	case ARG_RS485_RTS_ON_SEND:
+		priv->rs485.rts_on_send = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->rs485.rts_on_send);
+		break;
+
+	case ARG_RS485_DELAY_BEFORE:
+		priv->rs485.delay_before = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->rs485.delay_before);
+		break;
+
+	case ARG_RS485_DELAY_AFTER:
+		priv->rs485.delay_after = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->rs485.delay_after);
+		break;
+
+	case ARG_LOW_LATENCY:
+		priv->low_latency = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->low_latency);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gst_uart_duplex_get_property(GObject * object, guint prop_id, GValue * value,
+			     GParamSpec * pspec)
+{
+	GstUartDuplex *duplex;
+	GstUartDuplexPrivate *priv;
+
+	duplex = GST_UART_DUPLEX(object);
+	priv = gst_uart_duplex_get_instance_private(duplex);
+
+	switch (prop_id) {
+	case ARG_DEVICE:
+		g_value_set_string(value, priv->device);
+		break;
+
+	case ARG_BAUD_RATE:
+		g_value_set_int(value, priv->baud_rate);
+		break;
+
+	case ARG_PARITY:
+		g_value_set_string(value, uart_parity_to_string(priv->parity));
+		break;
+
+	case ARG_BITSWAP:
+		g_value_set_boolean(value, priv->bitswap);
+		break;
+
+	case ARG_ACKNAK:
+		g_value_set_boolean(value, priv->acknak);
+		break;
+
+	case ARG_ACKNAK_WAIT:
+		g_value_set_uint(value, priv->acknak_wait);
+		break;
+
+	case ARG_NAK_PROBABILITY:
+		g_value_set_uint(value, priv->nak_probability);
+		break;
+
+	case ARG_BLOCKSIZE:
+		g_value_set_uint(value, priv->blocksize);
+		break;
+
+	case ARG_RS485:
+		g_value_set_boolean(value, priv->rs485.enabled);
+		break;
+
+	case ARG_RS485_RTS_ON_SEND:
+		g_value_set_boolean(value, priv->rs485.rts_on_send);
+		break;
+
+	case ARG_RS485_DELAY_BEFORE:
+		g_value_set_uint(value, priv->rs485.delay_before);
+		break;
+
+	case ARG_RS485_DELAY_AFTER:
+		g_value_set_uint(value, priv->rs485.delay_after);
+		break;
+
+	case ARG_LOW_LATENCY:
+		g_value_set_boolean(value, priv->low_latency);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		break;
+	}
+}
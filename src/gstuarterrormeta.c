@@ -0,0 +1,110 @@
+/* GStreamer
+ * Copyright (C) 2025 Yasushi SHOJI <yashi@spacecubics.com>
+ *
+ * gstuarterrormeta.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include "gstuarterrormeta.h"
+
+GType
+gst_uart_error_meta_api_get_type(void)
+{
+	static GType type = 0;
+	static const gchar *tags[] = { NULL };
+
+	if (g_once_init_enter(&type)) {
+		GType t = gst_meta_api_type_register("GstUartErrorMetaAPI", tags);
+
+		g_once_init_leave(&type, t);
+	}
+
+	return type;
+}
+
+static gboolean
+gst_uart_error_meta_init(GstMeta * meta, gpointer params, GstBuffer * buffer)
+{
+	GstUartErrorMeta *emeta = (GstUartErrorMeta *)meta;
+
+	emeta->offsets = g_array_new(FALSE, FALSE, sizeof(guint));
+
+	return TRUE;
+}
+
+static void
+gst_uart_error_meta_free(GstMeta * meta, GstBuffer * buffer)
+{
+	GstUartErrorMeta *emeta = (GstUartErrorMeta *)meta;
+
+	g_clear_pointer(&emeta->offsets, g_array_unref);
+}
+
+/* a copy of part of the buffer keeps the errors in that part */
+static gboolean
+gst_uart_error_meta_transform(GstBuffer * dest, GstMeta * meta, GstBuffer * buffer,
+			      GQuark type, gpointer data)
+{
+	GstUartErrorMeta *emeta = (GstUartErrorMeta *)meta;
+	GstMetaTransformCopy *copy = data;
+	GstUartErrorMeta *dmeta = NULL;
+	guint i;
+
+	if (!GST_META_TRANSFORM_IS_COPY(type))
+		return FALSE;
+
+	for (i = 0; i < emeta->offsets->len; i++) {
+		guint offset = g_array_index(emeta->offsets, guint, i);
+
+		if (copy->region && (offset < copy->offset || offset - copy->offset >= copy->size))
+			continue;
+		if (!dmeta)
+			dmeta = gst_buffer_add_uart_error_meta(dest);
+		if (copy->region)
+			offset -= copy->offset;
+		g_array_append_val(dmeta->offsets, offset);
+	}
+
+	return TRUE;
+}
+
+const GstMetaInfo *
+gst_uart_error_meta_get_info(void)
+{
+	static const GstMetaInfo *info = NULL;
+
+	if (g_once_init_enter((GstMetaInfo **)&info)) {
+		const GstMetaInfo *i = gst_meta_register(GST_UART_ERROR_META_API_TYPE,
+							 "GstUartErrorMeta",
+							 sizeof(GstUartErrorMeta),
+							 gst_uart_error_meta_init,
+							 gst_uart_error_meta_free,
+							 gst_uart_error_meta_transform);
+
+		g_once_init_leave((GstMetaInfo **)&info, (GstMetaInfo *)i);
+	}
+
+	return info;
+}
+
+GstUartErrorMeta *
+gst_buffer_add_uart_error_meta(GstBuffer * buffer)
+{
+	g_return_val_if_fail(GST_IS_BUFFER(buffer), NULL);
+
+	return (GstUartErrorMeta *)gst_buffer_add_meta(buffer, GST_UART_ERROR_META_INFO, NULL);
+}
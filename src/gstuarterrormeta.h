@@ -0,0 +1,44 @@
+#pragma once
+
+/* GStreamer
+ * Copyright (C) 2025 Yasushi SHOJI <yashi@spacecubics.com>
+ *
+ * gstuarterrormeta.h:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+#include <gst/gst.h>
+
+G_BEGIN_DECLS
+
+#define GST_UART_ERROR_META_API_TYPE (gst_uart_error_meta_api_get_type())
+#define GST_UART_ERROR_META_INFO (gst_uart_error_meta_get_info())
+
+/* bytes of the buffer that came in with a parity or framing error */
+typedef struct {
+	GstMeta meta;
+	GArray *offsets;	/* guint, ascending */
+} GstUartErrorMeta;
+
+GType gst_uart_error_meta_api_get_type(void);
+const GstMetaInfo *gst_uart_error_meta_get_info(void);
+GstUartErrorMeta *gst_buffer_add_uart_error_meta(GstBuffer * buffer);
+
+#define gst_buffer_get_uart_error_meta(b) \
+	((GstUartErrorMeta *)gst_buffer_get_meta((b), GST_UART_ERROR_META_API_TYPE))
+
+G_END_DECLS
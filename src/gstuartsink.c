@@ -21,26 +21,53 @@
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <time.h>
 #include <glib/gstdio.h>
 #include <glib-object.h>
 
 #include "config.h"
 #include "gstuartsink.h"
 #include "uart.h"
+#include "uartconn.h"
+#include "uartlines.h"
+#include "fault.h"
+#include "acknak.h"
 #include "bitswap.h"
+#include "lzss.h"
+#include "rs.h"
+#include "ring.h"
 
 #define ACKNAK_DEFAULT_WAIT_TIME (100) /* 100 us */
+#define ACKNAK_MAX_RETRIES (5)
+#define PACING_DEFAULT_LATENCY (10000) /* 10 ms */
+#define LANE_DEFAULT_PRIORITY (1)
+#define RECONNECT_DEFAULT_INTERVAL (500) /* 500 ms */
+#define LANE_SHARE_WINDOW (64 * 1024) /* bytes */
+#define COMPRESS_DEFAULT_BLOCK_SIZE (1024)
+#define COMPRESS_DEFAULT_WINDOW (10)
+#define COMPRESS_DEFAULT_LOOKAHEAD (4)
+#define COMPRESS_DEFAULT_RESET (8) /* blocks */
+#define FEC_DEFAULT_PARITY (16)
+#define FEC_DEFAULT_DEPTH (8)
+#define ASYNC_DEFAULT_QUEUE_SIZE (16) /* buffers */
+#define TIMED_SLEEP_MARGIN (2 * GST_MSECOND) /* left to clock_nanosleep() */
 
 static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE("sink",
 								   GST_PAD_SINK,
 								   GST_PAD_ALWAYS,
 								   GST_STATIC_CAPS_ANY);
 
+static GstStaticPadTemplate lanetemplate = GST_STATIC_PAD_TEMPLATE("sink_%u",
+								   GST_PAD_SINK,
+								   GST_PAD_REQUEST,
+								   GST_STATIC_CAPS_ANY);
+
 GST_DEBUG_CATEGORY_STATIC(gst_uart_sink_debug);
 #define GST_CAT_DEFAULT gst_uart_sink_debug
 
@@ -52,20 +79,149 @@ enum {
 	ARG_BITSWAP,
 	ARG_ACKNAK,
 	ARG_ACKNAK_WAIT,
+	ARG_ACKNAK_WINDOW,
+	ARG_PACING,
+	ARG_PACING_LATENCY,
+	ARG_BULK_SHARE,
+	ARG_BULK_FRAME_SIZE,
+	ARG_RECONNECT,
+	ARG_RECONNECT_INTERVAL,
+	ARG_FAULT_SEED,
+	ARG_FAULT_LOSS,
+	ARG_FAULT_BURST,
+	ARG_FAULT_CORRUPT,
+	ARG_FAULT_DELAY,
+	ARG_FAULT_STATS,
+	ARG_DTR,
+	ARG_RTS,
+	ARG_RS485,
+	ARG_RS485_RTS_ON_SEND,
+	ARG_RS485_DELAY_BEFORE,
+	ARG_RS485_DELAY_AFTER,
+	ARG_COMPRESS,
+	ARG_COMPRESS_BLOCK_SIZE,
+	ARG_COMPRESS_WINDOW,
+	ARG_COMPRESS_LOOKAHEAD,
+	ARG_COMPRESS_RESET,
+	ARG_COMPRESS_STATS,
+	ARG_FEC,
+	ARG_FEC_PARITY,
+	ARG_FEC_DEPTH,
+	ARG_FEC_STATS,
+	ARG_ASYNC,
+	ARG_ASYNC_QUEUE_SIZE,
+	ARG_ASYNC_STATS,
+	ARG_TIMED,
+	ARG_TIMED_STATS,
+	ARG_KEEP_OPEN,
+	ARG_ADDRESS,
+};
+
+enum {
+	ARG_PAD_0,
+	ARG_PAD_PRIORITY,
+};
+
+/*
+ * Sink pads are transmission lanes.  The always "sink" pad is the bulk
+ * lane (priority 0); request pads default to LANE_DEFAULT_PRIORITY.
+ */
+struct _GstUartSinkPad {
+	GstPad parent;
+	guint priority;
+	/* scheduling state, protected by the sink's tx_lock */
+	gboolean waiting;
+	gboolean flushing;
+	gboolean eos;
+	guint64 ticket;
+	guint64 sent;	/* recent bytes, towards bulk-share */
+	/*
+	 * async: buffers go through queue to a writer thread of the lane.
+	 * The queue is lock free; queue_lock and queue_cond are only to
+	 * sleep on it, flagged by writer_idle and upstream_waits so the
+	 * other side knows to wake us up.
+	 */
+	struct ring queue;
+	GThread *writer;
+	GMutex queue_lock;
+	GCond queue_cond;
+	gint writer_idle;
+	gint upstream_waits;
+	gint discard;	/* flushing; the writer throws the queue away */
+	gint quit;
+	gint flow;	/* GstFlowReturn of the writer, for the next render */
 };
 
+G_DEFINE_TYPE(GstUartSinkPad, gst_uart_sink_pad, GST_TYPE_PAD);
+
 struct _GstUartSinkPrivate {
 	char *device;
 	int baud_rate;
 	enum UartParity parity;
+	gboolean reconfigure;
 	gboolean bitswap;
 	gboolean acknak;
 	guint32 acknak_wait;
+	guint acknak_window;
+	/* go-back-N state, used with the wire held */
+	GQueue unacked;	/* GBytes of the frames sent but not acked, oldest first */
+	guint8 acknak_seq;	/* of the next frame */
+	guint acknak_credit;
+	guint acknak_retries;
+	gint acknak_partial;	/* first byte of a response, or -1 */
+	gboolean pacing;
+	guint32 pacing_latency;
 	struct uart *uart;
 	GstPoll *fdset_write;
 	GstPoll *fdset_read;
+	GstPoll *fdset_wait;
+	GMutex tx_lock;
+	GCond tx_cond;
+	gboolean tx_busy;
+	guint64 tx_ticket;
+	GList *lanes;
+	guint lane_count;
+	guint bulk_share;
+	guint bulk_frame_size;
+	guint64 total_bytes;
+	gboolean reconnect;
+	guint reconnect_interval;
+	struct fault fault;
+	struct uart_conn conn;	/* of the device that went away */
 	guint64 bytes_written;
 	guint64 current_pos;
+	gboolean dtr;
+	gboolean rts;
+	struct uart_rs485 rs485;
+	gboolean compress;
+	guint compress_block_size;
+	guint compress_window;
+	guint compress_lookahead;
+	guint compress_reset;
+	/* used with the wire held */
+	struct lzss lzss;
+	guint8 *packed;	/* LZSS_BLOCK_BOUND(compress_block_size) */
+	guint compress_count;	/* blocks since the last reset, 0 to reset */
+	gboolean fec;
+	guint fec_parity;
+	guint fec_depth;
+	struct rs_frame fec_frame;
+	guint8 *coded;		/* RS_FRAME_BOUND(fec_depth) */
+	gboolean async;
+	guint async_queue_size;
+	guint64 async_buffers;	/* the object lock, for the writers */
+	guint64 async_stalls;	/* renders that waited on a full queue */
+	guint64 async_discarded;
+	gboolean timed;
+	/* the object lock */
+	guint64 timed_buffers;
+	guint64 timed_late;	/* off by more than a character */
+	GstClockTimeDiff timed_error_sum;
+	GstClockTimeDiff timed_error_min;
+	GstClockTimeDiff timed_error_max;
+	gboolean keep_open;
+	char *kept_device;	/* priv->uart stayed open for this one */
+	gint address;		/* multidrop node each buffer goes to, or -1 */
 };
 
 typedef struct _GstUartSinkPrivate GstUartSinkPrivate;
@@ -82,6 +238,15 @@ static void gst_uart_sink_get_property(GObject * object, guint prop_id, GValue *
 				       GParamSpec * pspec);
 
 static void gst_uart_sink_dispose(GObject * obj);
+static void gst_uart_sink_finalize(GObject * obj);
+static GstStateChangeReturn gst_uart_sink_change_state(GstElement * element,
+						       GstStateChange transition);
+static GstPad *gst_uart_sink_request_new_pad(GstElement * element, GstPadTemplate * templ,
+					     const gchar * name, const GstCaps * caps);
+static void gst_uart_sink_release_pad(GstElement * element, GstPad * pad);
+static void gst_uart_sink_lanes_set_flushing(GstUartSink * uartsink, gboolean flushing);
+static void gst_uart_sink_timed_reset(GstUartSink * uartsink);
+static void gst_uart_sink_lines_event(GstUartSink * uartsink, GstUartSinkPad * lane, GstEvent * event);
 
 static gboolean gst_uart_sink_query(GstBaseSink * basesink, GstQuery * query);
 static GstFlowReturn gst_uart_sink_render(GstBaseSink * sink, GstBuffer * buffer);
@@ -90,6 +255,7 @@ static gboolean gst_uart_sink_stop(GstBaseSink * basesink);
 static gboolean gst_uart_sink_unlock(GstBaseSink * basesink);
 static gboolean gst_uart_sink_unlock_stop(GstBaseSink * basesink);
 static gboolean gst_uart_sink_event(GstBaseSink * sink, GstEvent * event);
+static gboolean gst_uart_sink_set_caps(GstBaseSink * basesink, GstCaps * caps);
 
 static void
 gst_uart_sink_class_init(GstUartSinkClass * klass)
@@ -105,11 +271,19 @@ gst_uart_sink_class_init(GstUartSinkClass * klass)
 	gobject_class->set_property = gst_uart_sink_set_property;
 	gobject_class->get_property = gst_uart_sink_get_property;
 	gobject_class->dispose = gst_uart_sink_dispose;
+	gobject_class->finalize = gst_uart_sink_finalize;
 
 	gst_element_class_set_static_metadata(gstelement_class, "UART Sink", "Sink/UART",
 					      "Write data to a uart / tty",
 					      "Yasushi SHOJI <yashi@spacecubics.com>");
-	gst_element_class_add_static_pad_template(gstelement_class, &sinktemplate);
+	gst_element_class_add_static_pad_template_with_gtype(gstelement_class, &sinktemplate,
+							     GST_TYPE_UART_SINK_PAD);
+	gst_element_class_add_static_pad_template_with_gtype(gstelement_class, &lanetemplate,
+							     GST_TYPE_UART_SINK_PAD);
+
+	gstelement_class->change_state = GST_DEBUG_FUNCPTR(gst_uart_sink_change_state);
+	gstelement_class->request_new_pad = GST_DEBUG_FUNCPTR(gst_uart_sink_request_new_pad);
+	gstelement_class->release_pad = GST_DEBUG_FUNCPTR(gst_uart_sink_release_pad);
 
 	gstbasesink_class->render = GST_DEBUG_FUNCPTR(gst_uart_sink_render);
 	gstbasesink_class->start = GST_DEBUG_FUNCPTR(gst_uart_sink_start);
@@ -118,6 +292,7 @@ gst_uart_sink_class_init(GstUartSinkClass * klass)
 	gstbasesink_class->unlock_stop = GST_DEBUG_FUNCPTR(gst_uart_sink_unlock_stop);
 	gstbasesink_class->event = GST_DEBUG_FUNCPTR(gst_uart_sink_event);
 	gstbasesink_class->query = GST_DEBUG_FUNCPTR(gst_uart_sink_query);
+	gstbasesink_class->set_caps = GST_DEBUG_FUNCPTR(gst_uart_sink_set_caps);
 
 	g_object_class_install_property(gobject_class, ARG_DEVICE,
 					g_param_spec_string("device", "Device",
@@ -127,13 +302,15 @@ gst_uart_sink_class_init(GstUartSinkClass * klass)
 	g_object_class_install_property(gobject_class, ARG_BAUD_RATE,
 					g_param_spec_int("baud-rate", "Baud rate",
 							 "baud rate for the device",
-							 50, 460800, 115200,
-							 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+							 50, 4000000, 115200,
+							 G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							 G_PARAM_STATIC_STRINGS));
 	g_object_class_install_property(gobject_class, ARG_PARITY,
 					g_param_spec_string("parity", "Parity",
 							    "Parity checking for the device",
 							    "no",
-							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+							    G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							    G_PARAM_STATIC_STRINGS));
 	g_object_class_install_property(gobject_class, ARG_BITSWAP,
 					g_param_spec_boolean("bitswap", "Bit Swap",
 							     "Swap bits in a byte",
@@ -149,6 +326,273 @@ gst_uart_sink_class_init(GstUartSinkClass * klass)
 							  "Wait time for Ack / Nak in micro sec",
 							  0, 1000000, ACKNAK_DEFAULT_WAIT_TIME,
 							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ACKNAK_WINDOW,
+					g_param_spec_uint("acknak-window", "Ack/Nak Window",
+							  "Frames sent ahead of their ack (go-back-N); 0 for stop and wait",
+							  0, 255, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_PACING,
+					g_param_spec_boolean("pacing", "Pacing",
+							     "Pace writes at the wire rate instead of filling the output queue",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_PACING_LATENCY,
+					g_param_spec_uint("pacing-latency", "Pacing Latency (usec)",
+							  "Maximum time data may wait in the output queue when pacing, in micro sec",
+							  0, 10000000, PACING_DEFAULT_LATENCY,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BULK_SHARE,
+					g_param_spec_uint("bulk-share", "Bulk Share (%)",
+							  "Share of the wire reserved for the lowest waiting lane, 0 for strict priority",
+							  0, 100, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BULK_FRAME_SIZE,
+					g_param_spec_uint("bulk-frame-size", "Bulk Frame Size",
+							  "Split bulk (priority 0) buffers into frames of this many bytes, 0 to send whole buffers",
+							  0, G_MAXUINT, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RECONNECT,
+					g_param_spec_boolean("reconnect", "Reconnect",
+							     "Wait for the device to come back instead of failing when it goes away",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RECONNECT_INTERVAL,
+					g_param_spec_uint("reconnect-interval", "Reconnect Interval (msec)",
+							  "Retry opening a device that went away at least this often",
+							  1, G_MAXUINT, RECONNECT_DEFAULT_INTERVAL,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_SEED,
+					g_param_spec_uint("fault-seed", "Fault Seed",
+							  "Seed for fault injection; the same seed gives the same faults",
+							  0, G_MAXUINT, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_LOSS,
+					g_param_spec_double("fault-loss", "Fault Loss",
+							    "Probability that a burst of lost buffers starts at a buffer",
+							    0.0, 1.0, 0.0,
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_BURST,
+					g_param_spec_uint("fault-burst", "Fault Burst",
+							  "Number of buffers lost in a row",
+							  1, G_MAXUINT, 1,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_CORRUPT,
+					g_param_spec_double("fault-corrupt", "Fault Corrupt",
+							    "Probability that a byte gets a bit flipped",
+							    0.0, 1.0, 0.0,
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_DELAY,
+					g_param_spec_uint("fault-delay", "Fault Delay (usec)",
+							  "Delay each buffer by a random time up to this many micro sec",
+							  0, 10000000, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_STATS,
+					g_param_spec_boxed("fault-stats", "Fault Stats",
+							   "Dropped buffers, corrupted bytes and delayed buffers so far",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_DTR,
+					g_param_spec_boolean("dtr", "DTR",
+							     "State of the DTR line",
+							     TRUE,
+							     G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							     G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RTS,
+					g_param_spec_boolean("rts", "RTS",
+							     "State of the RTS line",
+							     TRUE,
+							     G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							     G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485,
+					g_param_spec_boolean("rs485", "RS-485",
+							     "Drive the RS-485 transmitter enable with RTS while sending",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_RTS_ON_SEND,
+					g_param_spec_boolean("rs485-rts-on-send", "RS-485 RTS On Send",
+							     "RTS is high while sending (and low after), or the other way around",
+							     TRUE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_DELAY_BEFORE,
+					g_param_spec_uint("rs485-delay-before", "RS-485 Delay Before Send (msec)",
+							  "Time from enabling the transmitter to the first bit",
+							  0, 1000, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_DELAY_AFTER,
+					g_param_spec_uint("rs485-delay-after", "RS-485 Delay After Send (msec)",
+							  "Time from the last bit to disabling the transmitter",
+							  0, 1000, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_COMPRESS,
+					g_param_spec_boolean("compress", "Compress",
+							     "Send LZSS compressed blocks, for a uartsrc with decompress=true",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_COMPRESS_BLOCK_SIZE,
+					g_param_spec_uint("compress-block-size", "Compress Block Size",
+							  "Bytes compressed into one block at most",
+							  64, LZSS_BLOCK_MAX, COMPRESS_DEFAULT_BLOCK_SIZE,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_COMPRESS_WINDOW,
+					g_param_spec_uint("compress-window", "Compress Window",
+							  "Dictionary size as a power of two",
+							  LZSS_WINDOW_BITS_MIN, LZSS_WINDOW_BITS_MAX,
+							  COMPRESS_DEFAULT_WINDOW,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_COMPRESS_LOOKAHEAD,
+					g_param_spec_uint("compress-lookahead", "Compress Lookahead",
+							  "Bits for the length of a match",
+							  LZSS_LOOKAHEAD_BITS_MIN, LZSS_LOOKAHEAD_BITS_MAX,
+							  COMPRESS_DEFAULT_LOOKAHEAD,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_COMPRESS_RESET,
+					g_param_spec_uint("compress-reset", "Compress Reset",
+							  "Start a new dictionary every this many blocks, "
+							  "so a receiver that lost one gets back in (0 = never)",
+							  0, G_MAXUINT, COMPRESS_DEFAULT_RESET,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_COMPRESS_STATS,
+					g_param_spec_boxed("compress-stats", "Compress Stats",
+							   "Blocks, stored blocks, bytes in and on the wire, and their ratio",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FEC,
+					g_param_spec_boolean("fec", "FEC",
+							     "Send Reed-Solomon coded frames, for a uartsrc with fec=true",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FEC_PARITY,
+					g_param_spec_uint("fec-parity", "FEC Parity",
+							  "Parity bytes per 255 byte codeword; half as many bad bytes get corrected",
+							  RS_PARITY_MIN, RS_PARITY_MAX, FEC_DEFAULT_PARITY,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FEC_DEPTH,
+					g_param_spec_uint("fec-depth", "FEC Depth",
+							  "Codewords interleaved in a frame, against bursts",
+							  1, RS_DEPTH_MAX, FEC_DEFAULT_DEPTH,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FEC_STATS,
+					g_param_spec_boxed("fec-stats", "FEC Stats",
+							   "Frames, bytes in and on the wire, and the code rate",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ASYNC,
+					g_param_spec_boolean("async", "Async",
+							     "Write from a thread of each lane; render only queues the buffer",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ASYNC_QUEUE_SIZE,
+					g_param_spec_uint("async-queue-size", "Async Queue Size",
+							  "Buffers queued per lane before render blocks, rounded up to a power of two",
+							  1, 4096, ASYNC_DEFAULT_QUEUE_SIZE,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ASYNC_STATS,
+					g_param_spec_boxed("async-stats", "Async Stats",
+							   "Buffers written, renders that waited on a full queue, and buffers discarded on flush",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_TIMED,
+					g_param_spec_boolean("timed", "Timed",
+							     "Put the first byte of a buffer on the wire at its timestamp",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_TIMED_STATS,
+					g_param_spec_boxed("timed-stats", "Timed Stats",
+							   "Timed buffers, those late by more than a character, and the error of the wire time in ns",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_KEEP_OPEN,
+					g_param_spec_boolean("keep-open", "Keep Open",
+							     "Keep the device open and set up from PAUSED to READY, until NULL",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ADDRESS,
+					g_param_spec_int("address", "Address",
+							 "9-bit multidrop: send each buffer as a frame to this node, "
+							 "the address byte with mark parity and the data with space (-1 = off)",
+							 -1, 255, -1,
+							 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_uart_sink_pad_set_property(GObject * object, guint prop_id, const GValue * value,
+			       GParamSpec * pspec)
+{
+	GstUartSinkPad *pad = GST_UART_SINK_PAD(object);
+
+	switch (prop_id) {
+	case ARG_PAD_PRIORITY:
+		pad->priority = g_value_get_uint(value);
+		GST_DEBUG_OBJECT(pad, "priority: '%u'", pad->priority);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gst_uart_sink_pad_get_property(GObject * object, guint prop_id, GValue * value,
+			       GParamSpec * pspec)
+{
+	GstUartSinkPad *pad = GST_UART_SINK_PAD(object);
+
+	switch (prop_id) {
+	case ARG_PAD_PRIORITY:
+		g_value_set_uint(value, pad->priority);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gst_uart_sink_pad_finalize(GObject * obj)
+{
+	GstUartSinkPad *pad = GST_UART_SINK_PAD(obj);
+
+	g_cond_clear(&pad->queue_cond);
+	g_mutex_clear(&pad->queue_lock);
+
+	G_OBJECT_CLASS(gst_uart_sink_pad_parent_class)->finalize(obj);
+}
+
+static void
+gst_uart_sink_pad_class_init(GstUartSinkPadClass * klass)
+{
+	GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+
+	gobject_class->set_property = gst_uart_sink_pad_set_property;
+	gobject_class->get_property = gst_uart_sink_pad_get_property;
+	gobject_class->finalize = gst_uart_sink_pad_finalize;
+
+	g_object_class_install_property(gobject_class, ARG_PAD_PRIORITY,
+					g_param_spec_uint("priority", "Priority",
+							  "Transmission priority of the lane, 0 being bulk",
+							  0, G_MAXUINT, 0,
+							  G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							  G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_uart_sink_pad_init(GstUartSinkPad * pad)
+{
+	pad->priority = 0;
+	pad->waiting = FALSE;
+	pad->flushing = TRUE;
+	pad->ticket = 0;
+	pad->queue.slots = NULL;
+	pad->writer = NULL;
+	g_mutex_init(&pad->queue_lock);
+	g_cond_init(&pad->queue_cond);
+	pad->writer_idle = FALSE;
+	pad->upstream_waits = 0;
+	pad->discard = FALSE;
+	pad->quit = FALSE;
+	pad->flow = GST_FLOW_OK;
 }
 
 static void
@@ -158,14 +602,63 @@ gst_uart_sink_init(GstUartSink * uartsink)
 	priv->device = NULL;
 	priv->baud_rate = 115200;
 	priv->parity = UART_PARITY_NO;
+	priv->reconfigure = FALSE;
 	priv->bitswap = FALSE;
 	priv->acknak = FALSE;
 	priv->acknak_wait = ACKNAK_DEFAULT_WAIT_TIME;
+	priv->acknak_window = 0;
+	g_queue_init(&priv->unacked);
+	priv->pacing = FALSE;
+	priv->pacing_latency = PACING_DEFAULT_LATENCY;
 	priv->uart = NULL;
 	priv->fdset_write = NULL;
+	priv->fdset_wait = NULL;
+	g_mutex_init(&priv->tx_lock);
+	g_cond_init(&priv->tx_cond);
+	priv->tx_busy = FALSE;
+	priv->tx_ticket = 0;
+	priv->lanes = g_list_append(NULL, GST_BASE_SINK_PAD(uartsink));
+	priv->lane_count = 0;
+	priv->bulk_share = 0;
+	priv->bulk_frame_size = 0;
+	priv->total_bytes = 0;
+	priv->reconnect = FALSE;
+	fault_init(&priv->fault);
+	priv->reconnect_interval = RECONNECT_DEFAULT_INTERVAL;
+	priv->conn.lost_since = 0;
 	priv->bytes_written = 0;
 	priv->current_pos = 0;
 	priv->fdset_read = NULL;
+	priv->dtr = TRUE;
+	priv->rts = TRUE;
+	priv->rs485.enabled = FALSE;
+	priv->rs485.rts_on_send = TRUE;
+	priv->rs485.delay_before = 0;
+	priv->rs485.delay_after = 0;
+	priv->rs485.rx_during_tx = FALSE;
+	priv->compress = FALSE;
+	priv->compress_block_size = COMPRESS_DEFAULT_BLOCK_SIZE;
+	priv->compress_window = COMPRESS_DEFAULT_WINDOW;
+	priv->compress_lookahead = COMPRESS_DEFAULT_LOOKAHEAD;
+	priv->compress_reset = COMPRESS_DEFAULT_RESET;
+	lzss_init(&priv->lzss, COMPRESS_DEFAULT_WINDOW, COMPRESS_DEFAULT_LOOKAHEAD);
+	priv->packed = NULL;
+	priv->compress_count = 0;
+	priv->fec = FALSE;
+	priv->fec_parity = FEC_DEFAULT_PARITY;
+	priv->fec_depth = FEC_DEFAULT_DEPTH;
+	rs_frame_init(&priv->fec_frame, FEC_DEFAULT_PARITY, FEC_DEFAULT_DEPTH);
+	priv->coded = NULL;
+	priv->async = FALSE;
+	priv->async_queue_size = ASYNC_DEFAULT_QUEUE_SIZE;
+	priv->async_buffers = 0;
+	priv->async_stalls = 0;
+	priv->async_discarded = 0;
+	priv->timed = FALSE;
+	gst_uart_sink_timed_reset(uartsink);
+	priv->keep_open = FALSE;
+	priv->kept_device = NULL;
+	priv->address = -1;
 
 	gst_base_sink_set_sync(GST_BASE_SINK(uartsink), FALSE);
 }
@@ -183,6 +676,96 @@ gst_uart_sink_dispose(GObject * obj)
 	G_OBJECT_CLASS(gst_uart_sink_parent_class)->dispose(obj);
 }
 
+/* the device keep-open left open; for good, or it is another one now */
+static void
+gst_uart_sink_close_kept(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+
+	if (!priv->kept_device)
+		return;
+	GST_DEBUG_OBJECT(uartsink, "closing \"%s\" kept open", priv->kept_device);
+	if (priv->uart) {
+		uart_close(priv->uart);
+		priv->uart = NULL;
+	}
+	g_clear_pointer(&priv->kept_device, g_free);
+}
+
+static void
+gst_uart_sink_finalize(GObject * obj)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(GST_UART_SINK(obj));
+
+	g_list_free(priv->lanes);
+	g_cond_clear(&priv->tx_cond);
+	g_mutex_clear(&priv->tx_lock);
+	fault_clear(&priv->fault);
+	lzss_clear(&priv->lzss);
+	gst_uart_sink_close_kept(GST_UART_SINK(obj));
+
+	G_OBJECT_CLASS(gst_uart_sink_parent_class)->finalize(obj);
+}
+
+static GstStateChangeReturn
+gst_uart_sink_change_state(GstElement * element, GstStateChange transition)
+{
+	GstUartSink *uartsink = GST_UART_SINK(element);
+
+	switch (transition) {
+	case GST_STATE_CHANGE_READY_TO_PAUSED:
+		gst_uart_sink_lanes_set_flushing(uartsink, FALSE);
+		break;
+	case GST_STATE_CHANGE_PAUSED_TO_READY:
+		/* request pads have no unlock(); release them before they deactivate */
+		gst_uart_sink_lanes_set_flushing(uartsink, TRUE);
+		break;
+	case GST_STATE_CHANGE_READY_TO_NULL:
+		gst_uart_sink_close_kept(uartsink);
+		break;
+	default:
+		break;
+	}
+
+	return GST_ELEMENT_CLASS(gst_uart_sink_parent_class)->change_state(element, transition);
+}
+
+/*
+ * application/x-uart caps say how the data was taken off a line; send
+ * it out the same way.  Anything else leaves the properties alone.
+ */
+static gboolean
+gst_uart_sink_set_caps(GstBaseSink * basesink, GstCaps * caps)
+{
+	GstUartSink *uartsink = GST_UART_SINK(basesink);
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstStructure *s = gst_caps_get_structure(caps, 0);
+	const char *parity_name;
+	enum UartParity parity;
+	gboolean bitswap;
+	int baud_rate;
+
+	if (!gst_structure_has_name(s, "application/x-uart"))
+		return TRUE;
+
+	GST_OBJECT_LOCK(uartsink);
+	if (gst_structure_get_int(s, "baud", &baud_rate) && baud_rate != priv->baud_rate) {
+		priv->baud_rate = baud_rate;
+		priv->reconfigure = TRUE;
+	}
+	parity_name = gst_structure_get_string(s, "parity");
+	if (uart_parity_from_string(parity_name, &parity) && parity != priv->parity) {
+		priv->parity = parity;
+		priv->reconfigure = TRUE;
+	}
+	if (gst_structure_get_boolean(s, "bitswap", &bitswap))
+		priv->bitswap = bitswap;
+	GST_OBJECT_UNLOCK(uartsink);
+	GST_DEBUG_OBJECT(uartsink, "caps %" GST_PTR_FORMAT, caps);
+
+	return TRUE;
+}
+
 static gboolean
 gst_uart_sink_query(GstBaseSink * basesink, GstQuery * query)
 {
@@ -212,6 +795,29 @@ gst_uart_sink_query(GstBaseSink * basesink, GstQuery * query)
 		}
 		break;
 	}
+	case GST_QUERY_LATENCY:
+	{
+		GstClockTime min, max;
+		gboolean live;
+
+		/*
+		 * no sync, so basesink would not take part; we do when timed
+		 * or pacing, and the render delay is the pacing latency
+		 */
+		if (!priv->timed && !priv->pacing) {
+			res = GST_BASE_SINK_CLASS(gst_uart_sink_parent_class)->query(basesink, query);
+			break;
+		}
+		if (!gst_pad_peer_query(GST_BASE_SINK_PAD(basesink), query))
+			break;
+		gst_query_parse_latency(query, &live, &min, &max);
+		min += gst_base_sink_get_render_delay(basesink);
+		if (GST_CLOCK_TIME_IS_VALID(max))
+			max += gst_base_sink_get_render_delay(basesink);
+		gst_query_set_latency(query, TRUE, min, max);
+		res = TRUE;
+		break;
+	}
 	case GST_QUERY_FORMATS:
 		gst_query_set_formats(query, 2, GST_FORMAT_DEFAULT, GST_FORMAT_BYTES);
 		res = TRUE;
@@ -226,88 +832,1365 @@ gst_uart_sink_query(GstBaseSink * basesink, GstQuery * query)
 		gst_query_set_seeking(query, fmt, FALSE, 0, -1);
 		res = TRUE;
 		break;
-	}
+	}
+	default:
+		res =
+		    GST_BASE_SINK_CLASS(gst_uart_sink_parent_class)->query(basesink, query);
+		break;
+	}
+	return res;
+}
+
+/* put DTR / RTS as the properties say; called with the object lock held */
+static void
+gst_uart_sink_apply_lines(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	int set = 0;
+	int clear = 0;
+
+	if (!priv->uart)
+		return;
+
+	if (priv->dtr)
+		set |= TIOCM_DTR;
+	else
+		clear |= TIOCM_DTR;
+	/* on RS-485, RTS is the transmitter enable */
+	if (!priv->rs485.enabled) {
+		if (priv->rts)
+			set |= TIOCM_RTS;
+		else
+			clear |= TIOCM_RTS;
+	}
+	if (uart_set_modem_lines(priv->uart, set, clear) < 0)
+		GST_WARNING_OBJECT(uartsink, "can not set DTR / RTS: %s", g_strerror(errno));
+}
+
+/* have the driver switch the RS-485 transmitter, or do it ourselves */
+static void
+gst_uart_sink_apply_rs485(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	int ret;
+
+	if (!priv->rs485.enabled)
+		return;
+
+	ret = uart_set_rs485(priv->uart, &priv->rs485);
+	if (ret < 0)
+		GST_ELEMENT_WARNING(uartsink, RESOURCE, SETTINGS,
+				    ("Could not set up RS-485 on \"%s\".", priv->device),
+				    GST_ERROR_SYSTEM);
+	else if (ret > 0)
+		GST_INFO_OBJECT(uartsink, "no RS-485 in the driver; switching RTS ourselves");
+}
+
+/* the port setup the properties ask for; called with the object lock */
+static void
+gst_uart_sink_get_config(GstUartSink * uartsink, struct uart_config *config)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+
+	config->baud_rate = priv->baud_rate;
+	config->parity = priv->address >= 0 ? UART_PARITY_SPACE : priv->parity;
+	config->mark_errors = FALSE;
+}
+
+/* the device went away; close it and remember how it was set up */
+static void
+gst_uart_sink_disconnect(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstPollFD fd = GST_POLL_FD_INIT;
+
+	GST_ELEMENT_WARNING(uartsink, RESOURCE, WRITE,
+			    ("Device \"%s\" went away; waiting for it to come back.", priv->device),
+			    (NULL));
+
+	fd.fd = priv->uart->fd;
+	gst_poll_remove_fd(priv->fdset_write, &fd);
+	gst_poll_remove_fd(priv->fdset_read, &fd);
+	uart_conn_lost(&priv->conn, GST_ELEMENT(uartsink), priv->device, &priv->uart);
+}
+
+/*
+ * Wait for the device to come back and reopen it, see
+ * uart_conn_wait().  Whatever was in flight when it went away is lost.
+ * Returns FALSE if we got flushed meanwhile; the next write tries
+ * again.  Called with the wire held, see gst_uart_sink_lane_acquire().
+ */
+static gboolean
+gst_uart_sink_reconnect(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstPollFD fd = GST_POLL_FD_INIT;
+	struct uart_config config;
+	struct uart *uart;
+	GstClockTime downtime;
+
+	GST_OBJECT_LOCK(uartsink);
+	gst_uart_sink_get_config(uartsink, &config);
+	GST_OBJECT_UNLOCK(uartsink);
+
+	uart = uart_conn_wait(&priv->conn, GST_ELEMENT(uartsink), priv->device, &config,
+			      priv->fdset_wait, priv->reconnect_interval, &downtime);
+	if (!uart)
+		return FALSE;
+
+	fd.fd = uart->fd;
+	gst_poll_add_fd(priv->fdset_write, &fd);
+	gst_poll_fd_ctl_write(priv->fdset_write, &fd, TRUE);
+	gst_poll_add_fd(priv->fdset_read, &fd);
+	gst_poll_fd_ctl_read(priv->fdset_read, &fd, TRUE);
+	GST_OBJECT_LOCK(uartsink);
+	priv->uart = uart;
+	gst_uart_sink_apply_lines(uartsink);
+	GST_OBJECT_UNLOCK(uartsink);
+	gst_uart_sink_apply_rs485(uartsink);
+	/* the other end may have missed the block we were in */
+	priv->compress_count = 0;
+
+	uart_conn_post(GST_ELEMENT(uartsink), priv->device, TRUE, downtime);
+
+	return TRUE;
+}
+
+/* a write failed with errno; reconnect if that is what we do */
+static GstFlowReturn
+gst_uart_sink_hangup(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+
+	if (!priv->reconnect) {
+		GST_ELEMENT_ERROR(uartsink, RESOURCE, WRITE,
+				  ("Device \"%s\" went away.", priv->device), GST_ERROR_SYSTEM);
+		return GST_FLOW_ERROR;
+	}
+	gst_uart_sink_disconnect(uartsink);
+	if (!gst_uart_sink_reconnect(uartsink))
+		return GST_FLOW_FLUSHING;
+
+	return GST_FLOW_OK;
+}
+
+/*
+ * Write data while keeping no more than pacing_latency worth of bytes
+ * in the driver's output queue.  Anything beyond that waits here, where
+ * it can still be flushed, rather than in the kernel.
+ */
+static GstFlowReturn
+gst_uart_sink_write_paced(GstUartSink * uartsink, const guint8 * data, gsize size)
+{
+	GstUartSinkPrivate *priv;
+	guint64 char_time;
+	gsize limit;
+	gsize offset = 0;
+
+	priv = gst_uart_sink_get_instance_private(uartsink);
+
+	char_time = MAX(uart_wire_time(priv->uart, 1), 1);
+	limit = MAX(priv->pacing_latency * GST_USECOND / char_time, 1);
+
+	while (offset < size) {
+		gssize written;
+		int queued;
+
+		queued = uart_get_output_queue(priv->uart);
+		if (queued < 0)
+			queued = 0;
+
+		if ((gsize)queued >= limit) {
+			GstClockTime wait = uart_wire_time(priv->uart, queued - limit + 1);
+
+			GST_LOG_OBJECT(uartsink, "%d bytes queued; waiting %" GST_TIME_FORMAT,
+				       queued, GST_TIME_ARGS(wait));
+			if (gst_poll_wait(priv->fdset_wait, wait) < 0 && errno == EBUSY)
+				return GST_FLOW_FLUSHING;
+			continue;
+		}
+
+		written = write(priv->uart->fd, data + offset, MIN(size - offset, limit - queued));
+		if (written < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			if (uart_error_is_hangup(errno)) {
+				GstFlowReturn flow = gst_uart_sink_hangup(uartsink);
+
+				if (flow != GST_FLOW_OK)
+					return flow;
+				continue;
+			}
+			GST_ELEMENT_ERROR(uartsink, RESOURCE, WRITE,
+					  ("Could not write to device \"%s\".", priv->device),
+					  GST_ERROR_SYSTEM);
+			return GST_FLOW_ERROR;
+		}
+		offset += written;
+	}
+	GST_DEBUG_OBJECT(uartsink, "%" G_GSIZE_FORMAT " bytes paced out", size);
+
+	return GST_FLOW_OK;
+}
+
+/* write a whole frame, riding out a reconnect */
+static GstFlowReturn
+gst_uart_sink_write_frame(GstUartSink * uartsink, const guint8 * data, gsize size)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	gsize offset = 0;
+
+	if (priv->uart)
+		uart_rs485_begin(priv->uart);
+	if (priv->pacing && priv->uart)
+		return gst_uart_sink_write_paced(uartsink, data, size);
+	while (offset < size) {
+		gssize written;
+
+		if (!priv->uart)
+			return GST_FLOW_FLUSHING;
+		written = write(priv->uart->fd, data + offset, size - offset);
+		if (written < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			if (uart_error_is_hangup(errno)) {
+				GstFlowReturn flow = gst_uart_sink_hangup(uartsink);
+
+				if (flow != GST_FLOW_OK)
+					return flow;
+				/* the peer lost whatever was in flight */
+				offset = 0;
+				continue;
+			}
+			GST_ELEMENT_ERROR(uartsink, RESOURCE, WRITE,
+					  ("Could not write to device \"%s\".", priv->device),
+					  GST_ERROR_SYSTEM);
+			return GST_FLOW_ERROR;
+		}
+		offset += written;
+	}
+
+	return GST_FLOW_OK;
+}
+
+/* the peer has the n oldest frames */
+static void
+gst_uart_sink_acknak_release(GstUartSink * uartsink, guint n)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+
+	while (n--)
+		g_bytes_unref(g_queue_pop_head(&priv->unacked));
+	priv->acknak_retries = 0;
+}
+
+/* go back: send every frame not acked yet, oldest first */
+static GstFlowReturn
+gst_uart_sink_acknak_resend(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstFlowReturn flow = GST_FLOW_OK;
+	GList *l;
+
+	GST_DEBUG_OBJECT(uartsink, "resending %u frames", g_queue_get_length(&priv->unacked));
+	for (l = priv->unacked.head; l && flow == GST_FLOW_OK; l = l->next) {
+		gsize size;
+		const guint8 *data = g_bytes_get_data(l->data, &size);
+
+		flow = gst_uart_sink_write_frame(uartsink, data, size);
+	}
+
+	return flow;
+}
+
+/*
+ * Take in whatever responses arrived, waiting for one if block is set.
+ * A response acks (cumulatively) or naks a sequence, or sets the
+ * credit; see acknak.h.  No response within acknak-wait, past the time
+ * the output queue takes to drain, resends the whole window.
+ */
+static GstFlowReturn
+gst_uart_sink_acknak_receive(GstUartSink * uartsink, gboolean block)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstClockTime timeout = 0;
+	gboolean go_back = FALSE;
+	guint8 buf[64];
+	gssize red;
+	gssize i;
+	gint ret;
+
+	if (block) {
+		int queued;
+
+		/* half duplex; the answer needs the bus */
+		if (priv->uart)
+			uart_rs485_end(priv->uart);
+		queued = priv->uart ? uart_get_output_queue(priv->uart) : 0;
+
+		timeout = priv->acknak_wait * GST_USECOND;
+		if (queued > 0)
+			timeout += uart_wire_time(priv->uart, queued);
+	}
+
+	ret = gst_poll_wait(priv->fdset_read, timeout);
+	if (ret < 0) {
+		if (errno == EBUSY)
+			return GST_FLOW_FLUSHING;
+		return GST_FLOW_OK;
+	}
+	if (ret == 0) {
+		if (!block || g_queue_is_empty(&priv->unacked))
+			return GST_FLOW_OK;
+		if (++priv->acknak_retries > ACKNAK_MAX_RETRIES) {
+			GST_ELEMENT_WARNING(uartsink, RESOURCE, WRITE,
+					    ("No acknowledgement after %d retries; dropping %u frames.",
+					     ACKNAK_MAX_RETRIES, g_queue_get_length(&priv->unacked)),
+					    (NULL));
+			gst_uart_sink_acknak_release(uartsink, g_queue_get_length(&priv->unacked));
+			return GST_FLOW_OK;
+		}
+		GST_DEBUG_OBJECT(uartsink, "ack/nak timeout; going back");
+		return gst_uart_sink_acknak_resend(uartsink);
+	}
+	if (!priv->uart)
+		return GST_FLOW_OK;
+
+	red = read(priv->uart->fd, buf, sizeof(buf));
+	if (red < 0) {
+		if (errno == EINTR || errno == EAGAIN)
+			return GST_FLOW_OK;
+		if (uart_error_is_hangup(errno))
+			return gst_uart_sink_hangup(uartsink);
+		GST_ELEMENT_ERROR(uartsink, RESOURCE, READ,
+				  ("Could not read ack/nak from device \"%s\".", priv->device),
+				  GST_ERROR_SYSTEM);
+		return GST_FLOW_ERROR;
+	}
+
+	for (i = 0; i < red; i++) {
+		guint length = g_queue_get_length(&priv->unacked);
+		guint8 base = priv->acknak_seq - length;
+		guint8 code;
+		guint n;
+
+		if (priv->acknak_partial < 0) {
+			if (buf[i] == ACKNAK_ACK || buf[i] == ACKNAK_NAK || buf[i] == ACKNAK_CREDIT)
+				priv->acknak_partial = buf[i];
+			else
+				GST_DEBUG_OBJECT(uartsink, "unknown byte for ack/nak (0x%02x)", buf[i]);
+			continue;
+		}
+		code = priv->acknak_partial;
+		priv->acknak_partial = -1;
+		n = (guint8)(buf[i] - base);
+
+		switch (code) {
+		case ACKNAK_ACK:
+			GST_LOG_OBJECT(uartsink, "ack for frame %u", buf[i]);
+			if (n < length)
+				gst_uart_sink_acknak_release(uartsink, n + 1);
+			break;
+		case ACKNAK_NAK:
+			GST_DEBUG_OBJECT(uartsink, "nak for frame %u", buf[i]);
+			if (n < length) {
+				gst_uart_sink_acknak_release(uartsink, n);
+				go_back = TRUE;
+			}
+			break;
+		case ACKNAK_CREDIT:
+			GST_DEBUG_OBJECT(uartsink, "credit for %u frames", buf[i]);
+			priv->acknak_credit = buf[i];
+			priv->acknak_retries = 0;
+			break;
+		}
+	}
+
+	if (go_back)
+		return gst_uart_sink_acknak_resend(uartsink);
+
+	return GST_FLOW_OK;
+}
+
+/*
+ * Send a frame with up to acknak-window (or the credit the peer gave,
+ * if less) frames ahead of their acks.
+ */
+static GstFlowReturn
+gst_uart_sink_write_windowed(GstUartSink * uartsink, guint8 * data, gsize size)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstFlowReturn flow;
+
+	while (g_queue_get_length(&priv->unacked) >= MIN(priv->acknak_window, priv->acknak_credit)) {
+		flow = gst_uart_sink_acknak_receive(uartsink, TRUE);
+		if (flow != GST_FLOW_OK)
+			return flow;
+	}
+
+	flow = gst_uart_sink_write_frame(uartsink, data, size);
+	if (flow != GST_FLOW_OK)
+		return flow;
+	g_queue_push_tail(&priv->unacked, g_bytes_new(data, size));
+	priv->acknak_seq++;
+
+	return gst_uart_sink_acknak_receive(uartsink, FALSE);
+}
+
+/* wait for the acks of every frame in flight */
+static GstFlowReturn
+gst_uart_sink_acknak_drain(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstFlowReturn flow = GST_FLOW_OK;
+
+	while (flow == GST_FLOW_OK && !g_queue_is_empty(&priv->unacked))
+		flow = gst_uart_sink_acknak_receive(uartsink, TRUE);
+
+	return flow;
+}
+
+static GstFlowReturn
+gst_uart_sink_write(GstUartSink * uartsink, guint8 * data, gsize size)
+{
+	GstUartSinkPrivate *priv;
+	GstFlowReturn flow = GST_FLOW_OK;
+	gssize written;
+	GstPollFD fd = GST_POLL_FD_INIT;
+	gint ret;
+
+	priv = gst_uart_sink_get_instance_private(uartsink);
+
+	if (priv->pacing && !priv->acknak)
+		return gst_uart_sink_write_paced(uartsink, data, size);
+	if (priv->acknak && priv->acknak_window)
+		return gst_uart_sink_write_windowed(uartsink, data, size);
+
+again:
+	if (priv->pacing) {
+		/* stop and wait; the frame is paced, then waits for its answer */
+		flow = gst_uart_sink_write_paced(uartsink, data, size);
+		if (flow != GST_FLOW_OK)
+			return flow;
+		written = size;
+	}
+	else {
+		written = write(priv->uart->fd, data, size);
+		if (written < 0 && uart_error_is_hangup(errno)) {
+			flow = gst_uart_sink_hangup(uartsink);
+			if (flow != GST_FLOW_OK)
+				return flow;
+			goto again;
+		}
+	}
+	GST_DEBUG_OBJECT(uartsink, "%" G_GSSIZE_FORMAT " bytes written", written);
+	uart_flush(priv->uart);
+	uart_rs485_end(priv->uart);
+	GST_DEBUG_OBJECT(uartsink, "and flushed");
+	if (priv->acknak) {
+		GST_DEBUG_OBJECT(uartsink, "gst_poll_wait() for %d usec", priv->acknak_wait);
+		ret = gst_poll_wait(priv->fdset_read, priv->acknak_wait * 1000);
+		GST_DEBUG_OBJECT(uartsink, "gst_poll_wait() returned %d", ret);
+		if (ret < 0)
+			return GST_FLOW_FLUSHING;
+		if (ret == 0) {
+			GST_DEBUG_OBJECT(uartsink, "ack/nak timeout; resending");
+			goto resend;
+		}
+
+		fd.fd = priv->uart->fd;
+		if (gst_poll_fd_can_read(priv->fdset_read, &fd)) {
+			guint8 acknak;
+			gssize red;
+			red = read(priv->uart->fd, &acknak, 1);
+			if (red < 0) {
+				GST_ERROR_OBJECT(uartsink, "read error %" G_GSIZE_FORMAT, red);
+				return GST_FLOW_ERROR;
+			}
+
+			switch (acknak) {
+			case ACKNAK_ACK:
+				GST_DEBUG_OBJECT(uartsink, "ack (0x%02x) received", acknak);
+				return flow;
+			case ACKNAK_NAK:
+				GST_DEBUG_OBJECT(uartsink, "nak (0x%02x) received", acknak);
+				goto resend;
+			default:
+				GST_DEBUG_OBJECT(uartsink, "unknown byte for ack/nak (0x%02x)", acknak);
+				flow = GST_FLOW_ERROR;
+			}
+		}
+	}
+
+	return flow;
+
+resend:
+	GST_DEBUG_OBJECT(uartsink, "resending %" G_GSIZE_FORMAT" bytes", size);
+	uart_rs485_begin(priv->uart);
+	written = write(priv->uart->fd, data, size);
+	uart_flush(priv->uart);
+	uart_rs485_end(priv->uart);
+
+	return flow;
+}
+
+/* gst_uart_sink_write() with whatever faults are configured */
+static GstFlowReturn
+gst_uart_sink_write_faulty(GstUartSink * uartsink, guint8 * data, gsize size)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstFlowReturn flow;
+	GstClockTime delay;
+	guint8 *copy;
+
+	if (fault_drop(&priv->fault)) {
+		GST_LOG_OBJECT(uartsink, "fault: dropping %" G_GSIZE_FORMAT " bytes", size);
+		return GST_FLOW_OK;
+	}
+
+	delay = fault_delay(&priv->fault);
+	if (delay && gst_poll_wait(priv->fdset_wait, delay) < 0 && errno == EBUSY)
+		return GST_FLOW_FLUSHING;
+
+	if (priv->fault.corrupt <= 0)
+		return gst_uart_sink_write(uartsink, data, size);
+
+	/* the buffer is not ours to scribble on */
+	copy = g_malloc(size);
+	memcpy(copy, data, size);
+	fault_corrupt(&priv->fault, copy, size);
+	flow = gst_uart_sink_write(uartsink, copy, size);
+	g_free(copy);
+
+	return flow;
+}
+
+/* gst_uart_sink_write_faulty() in Reed-Solomon frames, if so configured */
+static GstFlowReturn
+gst_uart_sink_write_coded(GstUartSink * uartsink, guint8 * data, gsize size)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	struct rs_frame *frame = &priv->fec_frame;
+	GstFlowReturn flow = GST_FLOW_OK;
+	gsize max = RS_FRAME_PAYLOAD(frame->rs.nroots, frame->depth);
+	gsize offset = 0;
+
+	if (!priv->fec)
+		return gst_uart_sink_write_faulty(uartsink, data, size);
+
+	while (flow == GST_FLOW_OK && offset < size) {
+		gsize n = MIN(max, size - offset);
+		gsize coded;
+
+		coded = rs_frame_pack(frame, data + offset, n, priv->coded);
+		GST_LOG_OBJECT(uartsink, "%" G_GSIZE_FORMAT " bytes into a %" G_GSIZE_FORMAT
+			       " byte frame", n, coded);
+		flow = gst_uart_sink_write_faulty(uartsink, priv->coded, coded);
+		offset += n;
+	}
+
+	return flow;
+}
+
+/*
+ * gst_uart_sink_write_coded() in LZSS blocks.  The dictionary goes on
+ * from one frame to the next, whichever lane it is from, as the wire
+ * is held while we pack.
+ */
+static GstFlowReturn
+gst_uart_sink_write_compressed(GstUartSink * uartsink, const guint8 * data, gsize size)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstFlowReturn flow = GST_FLOW_OK;
+	gsize offset = 0;
+
+	while (flow == GST_FLOW_OK && offset < size) {
+		gsize n = MIN(priv->compress_block_size, size - offset);
+		gboolean reset = priv->compress_count == 0;
+		gsize packed;
+
+		packed = lzss_block_pack(&priv->lzss, data + offset, n, reset, priv->packed);
+		GST_LOG_OBJECT(uartsink, "%" G_GSIZE_FORMAT " bytes into %" G_GSIZE_FORMAT "%s",
+			       n, packed, reset ? ", new dictionary" : "");
+		priv->compress_count++;
+		if (priv->compress_reset && priv->compress_count >= priv->compress_reset)
+			priv->compress_count = 0;
+
+		flow = gst_uart_sink_write_coded(uartsink, priv->packed, packed);
+		offset += n;
+	}
+
+	return flow;
+}
+
+/*
+ * Pick the lane that gets the wire next: the waiting lane with the
+ * highest priority, first come first served among equals, unless the
+ * lowest waiting lane got less than bulk-share percent of recent
+ * traffic.  Called with tx_lock held.
+ */
+static GstUartSinkPad *
+gst_uart_sink_next_lane(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstUartSinkPad *best = NULL;
+	GstUartSinkPad *lowest = NULL;
+	GList *l;
+
+	for (l = priv->lanes; l; l = l->next) {
+		GstUartSinkPad *lane = l->data;
+
+		if (!lane->waiting)
+			continue;
+		if (!best || lane->priority > best->priority ||
+		    (lane->priority == best->priority && lane->ticket < best->ticket))
+			best = lane;
+		if (!lowest || lane->priority < lowest->priority ||
+		    (lane->priority == lowest->priority && lane->ticket < lowest->ticket))
+			lowest = lane;
+	}
+
+	if (best != lowest && priv->bulk_share &&
+	    lowest->sent * 100 < priv->bulk_share * priv->total_bytes)
+		return lowest;
+
+	return best;
+}
+
+/* a lane waiting for the wire gives up when it starts flushing */
+static void
+gst_uart_sink_lane_set_flushing(GstUartSink * uartsink, GstUartSinkPad * lane, gboolean flushing)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+
+	g_mutex_lock(&priv->tx_lock);
+	lane->flushing = flushing;
+	g_cond_broadcast(&priv->tx_cond);
+	g_mutex_unlock(&priv->tx_lock);
+}
+
+static void
+gst_uart_sink_lanes_set_flushing(GstUartSink * uartsink, gboolean flushing)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GList *l;
+
+	g_mutex_lock(&priv->tx_lock);
+	for (l = priv->lanes; l; l = l->next) {
+		GST_UART_SINK_PAD(l->data)->flushing = flushing;
+		if (!flushing)
+			GST_UART_SINK_PAD(l->data)->eos = FALSE;
+	}
+	g_cond_broadcast(&priv->tx_cond);
+	g_mutex_unlock(&priv->tx_lock);
+}
+
+/* a request lane got EOS, or lost it to a flush */
+static void
+gst_uart_sink_lane_set_eos(GstUartSink * uartsink, GstUartSinkPad * lane, gboolean eos)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+
+	g_mutex_lock(&priv->tx_lock);
+	lane->eos = eos;
+	g_cond_broadcast(&priv->tx_cond);
+	g_mutex_unlock(&priv->tx_lock);
+}
+
+/*
+ * The always pad got EOS; wait for every linked request lane to get
+ * there too before basesink posts it.  Returns FALSE if the always pad
+ * got flushed meanwhile.
+ */
+static gboolean
+gst_uart_sink_lanes_wait_eos(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstUartSinkPad *bulk = GST_UART_SINK_PAD(GST_BASE_SINK_PAD(uartsink));
+	gboolean done = FALSE;
+	GList *l;
+
+	g_mutex_lock(&priv->tx_lock);
+	while (!bulk->flushing) {
+		done = TRUE;
+		for (l = priv->lanes; l; l = l->next) {
+			GstUartSinkPad *lane = l->data;
+
+			if (lane != bulk && !lane->eos && gst_pad_is_linked(GST_PAD(lane)))
+				done = FALSE;
+		}
+		if (done)
+			break;
+		g_cond_wait(&priv->tx_cond, &priv->tx_lock);
+	}
+	g_mutex_unlock(&priv->tx_lock);
+
+	return done;
+}
+
+static gboolean
+gst_uart_sink_lane_acquire(GstUartSink * uartsink, GstUartSinkPad * lane)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	gboolean flushing;
+
+	g_mutex_lock(&priv->tx_lock);
+	lane->waiting = TRUE;
+	lane->ticket = priv->tx_ticket++;
+	while (!(flushing = lane->flushing) &&
+	       (priv->tx_busy || gst_uart_sink_next_lane(uartsink) != lane))
+		g_cond_wait(&priv->tx_cond, &priv->tx_lock);
+	lane->waiting = FALSE;
+	if (!flushing)
+		priv->tx_busy = TRUE;
+	else
+		g_cond_broadcast(&priv->tx_cond);
+	g_mutex_unlock(&priv->tx_lock);
+
+	return !flushing;
+}
+
+static void
+gst_uart_sink_lane_release(GstUartSink * uartsink, GstUartSinkPad * lane, gsize size)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GList *l;
+
+	g_mutex_lock(&priv->tx_lock);
+	priv->tx_busy = FALSE;
+	lane->sent += size;
+	priv->total_bytes += size;
+	/* only the recent history counts towards the share */
+	if (priv->total_bytes > LANE_SHARE_WINDOW) {
+		for (l = priv->lanes; l; l = l->next)
+			GST_UART_SINK_PAD(l->data)->sent /= 2;
+		priv->total_bytes /= 2;
+	}
+	g_cond_broadcast(&priv->tx_cond);
+	g_mutex_unlock(&priv->tx_lock);
+}
+
+static void
+gst_uart_sink_reconfigure(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	struct uart_config config;
+	GError *error = NULL;
+	int ret;
+
+	GST_OBJECT_LOCK(uartsink);
+	if (!priv->reconfigure) {
+		GST_OBJECT_UNLOCK(uartsink);
+		return;
+	}
+	priv->reconfigure = FALSE;
+	gst_uart_sink_get_config(uartsink, &config);
+	GST_OBJECT_UNLOCK(uartsink);
+
+	ret = uart_reconfigure(priv->uart, &config, &error);
+	if (ret < 0) {
+		GST_ELEMENT_WARNING(uartsink, RESOURCE, SETTINGS, ("%s", error->message), (NULL));
+		g_clear_error(&error);
+	}
+	else if (ret > 0) {
+		GST_INFO_OBJECT(uartsink, "now at %d baud, parity %d",
+				uart_termios_baud_rate(&priv->uart->current), uart_get_parity(priv->uart));
+	}
+}
+
+static void
+gst_uart_sink_timed_reset(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+
+	priv->timed_buffers = 0;
+	priv->timed_late = 0;
+	priv->timed_error_sum = 0;
+	priv->timed_error_min = 0;
+	priv->timed_error_max = 0;
+}
+
+static GstClockTime
+gst_uart_sink_monotonic_time(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return GST_TIMESPEC_TO_TIME(now);
+}
+
+/*
+ * CLOCK_MONOTONIC time the buffer is due on the wire, or
+ * GST_CLOCK_TIME_NONE to send it right away.  The pipeline clock is
+ * mapped by the offset of the two now.
+ */
+static GstClockTime
+gst_uart_sink_due_time(GstUartSink * uartsink, GstUartSinkPad * lane, GstBuffer * buffer)
+{
+	GstBaseSink *basesink = GST_BASE_SINK(uartsink);
+	const GstSegment *segment;
+	GstClockTime ts, running, target, now;
+	GstClockTimeDiff due;
+	GstEvent *event;
+	GstClock *clock;
+
+	ts = GST_BUFFER_PTS_IS_VALID(buffer) ? GST_BUFFER_PTS(buffer) : GST_BUFFER_DTS(buffer);
+	if (!GST_CLOCK_TIME_IS_VALID(ts))
+		return GST_CLOCK_TIME_NONE;
+
+	event = gst_pad_get_sticky_event(GST_PAD(lane), GST_EVENT_SEGMENT, 0);
+	if (!event)
+		return GST_CLOCK_TIME_NONE;
+	gst_event_parse_segment(event, &segment);
+	running = gst_segment_to_running_time(segment, GST_FORMAT_TIME, ts);
+	gst_event_unref(event);
+	if (!GST_CLOCK_TIME_IS_VALID(running))
+		return GST_CLOCK_TIME_NONE;
+
+	clock = gst_element_get_clock(GST_ELEMENT(uartsink));
+	if (!clock)
+		return GST_CLOCK_TIME_NONE;
+	target = running + gst_element_get_base_time(GST_ELEMENT(uartsink)) +
+		gst_base_sink_get_latency(basesink) + gst_base_sink_get_render_delay(basesink);
+	now = gst_clock_get_time(clock);
+	gst_object_unref(clock);
+
+	due = gst_uart_sink_monotonic_time() + GST_CLOCK_DIFF(now, target);
+	return MAX(due, 0);
+}
+
+/*
+ * Sleep until shortly before due, without the wire and waking up on a
+ * flush; the rest is left to gst_uart_sink_timed_sleep().  FALSE when
+ * flushing.
+ */
+static gboolean
+gst_uart_sink_timed_wait(GstUartSink * uartsink, GstUartSinkPad * lane, GstClockTime due)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	gint64 end;
+	gboolean flushing;
+
+	/* g_get_monotonic_time() is CLOCK_MONOTONIC */
+	end = (gint64)(due - MIN(due, TIMED_SLEEP_MARGIN)) / GST_USECOND;
+	GST_LOG_OBJECT(lane, "due in %" GST_STIME_FORMAT,
+		       GST_STIME_ARGS(GST_CLOCK_DIFF(gst_uart_sink_monotonic_time(), due)));
+
+	g_mutex_lock(&priv->tx_lock);
+	while (!(flushing = lane->flushing) &&
+	       g_cond_wait_until(&priv->tx_cond, &priv->tx_lock, end))
+		;
+	g_mutex_unlock(&priv->tx_lock);
+
+	return !flushing;
+}
+
+/*
+ * With the wire held, sleep until the first byte written goes out at
+ * due: early by the wire time of what the driver still has queued, and
+ * by rs485-delay-before, which only starts once we are back.  Keeps
+ * score of how close that came.
+ */
+static void
+gst_uart_sink_timed_sleep(GstUartSink * uartsink, GstClockTime due)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstClockTimeDiff error;
+	GstClockTime at, out, lead;
+	struct timespec ts;
+	int queued;
+
+	lead = priv->uart->rs485.enabled ? priv->uart->rs485.delay_before * GST_MSECOND : 0;
+	queued = MAX(uart_get_output_queue(priv->uart), 0);
+	at = due - MIN(due, lead + uart_wire_time(priv->uart, queued));
+	GST_TIME_TO_TIMESPEC(at, ts);
+	while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+		;
+
+	/* the queue drained some while we slept */
+	queued = MAX(uart_get_output_queue(priv->uart), 0);
+	out = gst_uart_sink_monotonic_time() + lead + uart_wire_time(priv->uart, queued);
+	error = GST_CLOCK_DIFF(due, out);
+	GST_LOG_OBJECT(uartsink, "first byte out %" GST_STIME_FORMAT " off", GST_STIME_ARGS(error));
+
+	GST_OBJECT_LOCK(uartsink);
+	if (!priv->timed_buffers++) {
+		priv->timed_error_min = error;
+		priv->timed_error_max = error;
+	}
+	priv->timed_error_sum += error;
+	priv->timed_error_min = MIN(priv->timed_error_min, error);
+	priv->timed_error_max = MAX(priv->timed_error_max, error);
+	if (error > (GstClockTimeDiff)uart_wire_time(priv->uart, 1))
+		priv->timed_late++;
+	GST_OBJECT_UNLOCK(uartsink);
+}
+
+/*
+ * The address byte that begins a multidrop frame, with the 9th bit,
+ * the parity, at mark.  TCSADRAIN switches parity only once what was
+ * written is out, so this costs two drains a frame.
+ */
+static GstFlowReturn
+gst_uart_sink_write_address(GstUartSink * uartsink, guint8 address)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	struct uart_config config;
+	GstFlowReturn flow;
+	gssize written;
+
+	if (priv->bitswap)
+		bitswap(&address, 1);
+again:
+	written = -1;
+	config.baud_rate = uart_termios_baud_rate(&priv->uart->current);
+	config.parity = UART_PARITY_MARK;
+	config.mark_errors = FALSE;
+	if (uart_configure(priv->uart, &config, TCSADRAIN, NULL) == 0) {
+		written = write(priv->uart->fd, &address, 1);
+		config.parity = UART_PARITY_SPACE;
+		if (written == 1 && uart_configure(priv->uart, &config, TCSADRAIN, NULL) < 0)
+			written = -1;
+	}
+	if (written == 1)
+		return GST_FLOW_OK;
+	if (uart_error_is_hangup(errno)) {
+		flow = gst_uart_sink_hangup(uartsink);
+		if (flow != GST_FLOW_OK)
+			return flow;
+		goto again;
+	}
+	GST_ELEMENT_ERROR(uartsink, RESOURCE, WRITE,
+			  ("Could not send address %u to \"%s\".", address, priv->device),
+			  GST_ERROR_SYSTEM);
+
+	return GST_FLOW_ERROR;
+}
+
+/*
+ * Send data on behalf of a lane.  The wire is handed over between
+ * lanes at frame boundaries only; a frame is a whole buffer, except on
+ * bulk lanes where bulk-frame-size may cut it into smaller pieces.
+ * Unless due is GST_CLOCK_TIME_NONE, the first byte goes out then.
+ */
+static GstFlowReturn
+gst_uart_sink_transmit(GstUartSink * uartsink, GstUartSinkPad * lane, guint8 * data, gsize size,
+		       GstClockTime due)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstFlowReturn flow = GST_FLOW_OK;
+	gsize frame = size;
+	gsize offset = 0;
+
+	if (lane->priority == 0 && priv->bulk_frame_size && !priv->acknak)
+		frame = priv->bulk_frame_size;
+
+	do {
+		gsize n = MIN(frame, size - offset);
+
+		if (!gst_uart_sink_lane_acquire(uartsink, lane))
+			return GST_FLOW_FLUSHING;
+		/* a reconnect got flushed earlier */
+		if (!priv->uart && !gst_uart_sink_reconnect(uartsink)) {
+			gst_uart_sink_lane_release(uartsink, lane, 0);
+			return GST_FLOW_FLUSHING;
+		}
+		gst_uart_sink_reconfigure(uartsink);
+		GST_LOG_OBJECT(lane, "sending %" G_GSIZE_FORMAT " bytes at priority %u",
+			       n, lane->priority);
+		/* don't hold the bus while we wait */
+		if (offset == 0 && GST_CLOCK_TIME_IS_VALID(due))
+			gst_uart_sink_timed_sleep(uartsink, due);
+		uart_rs485_begin(priv->uart);
+		if (priv->address >= 0)
+			flow = gst_uart_sink_write_address(uartsink, priv->address);
+		if (flow == GST_FLOW_OK && priv->compress)
+			flow = gst_uart_sink_write_compressed(uartsink, data + offset, n);
+		else if (flow == GST_FLOW_OK)
+			flow = gst_uart_sink_write_coded(uartsink, data + offset, n);
+		/* let go of the bus between frames, for whoever answers */
+		if (priv->uart)
+			uart_rs485_end(priv->uart);
+		gst_uart_sink_lane_release(uartsink, lane, n);
+		offset += n;
+	} while (flow == GST_FLOW_OK && offset < size);
+
+	return flow;
+}
+
+static GstFlowReturn
+gst_uart_sink_send(GstUartSink * uartsink, GstUartSinkPad * lane, GstBuffer * buffer)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstClockTime due = GST_CLOCK_TIME_NONE;
+	GstFlowReturn flow;
+	GstMapInfo info;
+	guint8 *copy;
+
+	if (priv->timed) {
+		due = gst_uart_sink_due_time(uartsink, lane, buffer);
+		if (GST_CLOCK_TIME_IS_VALID(due) && !gst_uart_sink_timed_wait(uartsink, lane, due))
+			return GST_FLOW_FLUSHING;
+	}
+
+	gst_buffer_map(buffer, &info, GST_MAP_READ);
+	if (!priv->bitswap) {
+		flow = gst_uart_sink_transmit(uartsink, lane, info.data, info.size, due);
+		gst_buffer_unmap(buffer, &info);
+		return flow;
+	}
+
+	/* the buffer is not ours to scribble on; upstream, or a tee, may still read it */
+	copy = g_malloc(info.size);
+	memcpy(copy, info.data, info.size);
+	gst_buffer_unmap(buffer, &info);
+	bitswap(copy, info.size);
+	flow = gst_uart_sink_transmit(uartsink, lane, copy, info.size, due);
+	g_free(copy);
+
+	return flow;
+}
+
+/* wake up the other side of the queue, if it sleeps */
+static void
+gst_uart_sink_queue_wake(GstUartSinkPad * lane, gint * sleeping)
+{
+	if (!g_atomic_int_get(sleeping))
+		return;
+	g_mutex_lock(&lane->queue_lock);
+	g_cond_broadcast(&lane->queue_cond);
+	g_mutex_unlock(&lane->queue_lock);
+}
+
+static void
+gst_uart_sink_queue_discard(GstUartSink * uartsink, GstUartSinkPad * lane)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstBuffer *buffer;
+	guint n = 0;
+
+	while ((buffer = ring_pop(&lane->queue))) {
+		gst_buffer_unref(buffer);
+		n++;
+	}
+	GST_OBJECT_LOCK(uartsink);
+	priv->async_discarded += n;
+	GST_OBJECT_UNLOCK(uartsink);
+	GST_DEBUG_OBJECT(lane, "discarded %u buffers", n);
+}
+
+static gpointer
+gst_uart_sink_writer(gpointer data)
+{
+	GstUartSinkPad *lane = data;
+	GstUartSink *uartsink = GST_UART_SINK(GST_PAD_PARENT(lane));
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstBuffer *buffer;
+	GstFlowReturn flow;
+
+	GST_DEBUG_OBJECT(lane, "writer started");
+	while (!g_atomic_int_get(&lane->quit)) {
+		if (g_atomic_int_get(&lane->discard)) {
+			gst_uart_sink_queue_discard(uartsink, lane);
+			g_mutex_lock(&lane->queue_lock);
+			g_atomic_int_set(&lane->discard, FALSE);
+			g_cond_broadcast(&lane->queue_cond);
+			g_mutex_unlock(&lane->queue_lock);
+			continue;
+		}
+
+		buffer = ring_pop(&lane->queue);
+		if (!buffer) {
+			/* idle first, then look again: a push in between wakes us */
+			g_mutex_lock(&lane->queue_lock);
+			g_atomic_int_set(&lane->writer_idle, TRUE);
+			if (!ring_count(&lane->queue) && !g_atomic_int_get(&lane->quit) &&
+			    !g_atomic_int_get(&lane->discard)) {
+				/* drained; for EOS */
+				if (g_atomic_int_get(&lane->upstream_waits))
+					g_cond_broadcast(&lane->queue_cond);
+				g_cond_wait(&lane->queue_cond, &lane->queue_lock);
+			}
+			g_atomic_int_set(&lane->writer_idle, FALSE);
+			g_mutex_unlock(&lane->queue_lock);
+			continue;
+		}
+		gst_uart_sink_queue_wake(lane, &lane->upstream_waits);
+
+		flow = gst_uart_sink_send(uartsink, lane, buffer);
+		gst_buffer_unref(buffer);
+		GST_OBJECT_LOCK(uartsink);
+		priv->async_buffers++;
+		GST_OBJECT_UNLOCK(uartsink);
+		/* the error was posted; upstream stops at the next render */
+		if (flow != GST_FLOW_OK && flow != GST_FLOW_FLUSHING) {
+			GST_DEBUG_OBJECT(lane, "writer got %s", gst_flow_get_name(flow));
+			g_atomic_int_set(&lane->flow, flow);
+		}
+	}
+	gst_uart_sink_queue_discard(uartsink, lane);
+	GST_DEBUG_OBJECT(lane, "writer stopped");
+
+	return NULL;
+}
+
+static void
+gst_uart_sink_writer_stop(GstUartSinkPad * lane)
+{
+	if (!lane->writer)
+		return;
+
+	g_mutex_lock(&lane->queue_lock);
+	g_atomic_int_set(&lane->quit, TRUE);
+	g_cond_broadcast(&lane->queue_cond);
+	g_mutex_unlock(&lane->queue_lock);
+	g_thread_join(lane->writer);
+	lane->writer = NULL;
+	ring_clear(&lane->queue);
+}
+
+/*
+ * Queue a buffer for the writer of the lane, started on the first one.
+ * Blocks while the queue is full, unless flushing.
+ */
+static GstFlowReturn
+gst_uart_sink_queue_push(GstUartSink * uartsink, GstUartSinkPad * lane, GstBuffer * buffer)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstFlowReturn flow;
+	gboolean stalled = FALSE;
+
+	if (!lane->writer) {
+		ring_init(&lane->queue, priv->async_queue_size);
+		g_atomic_int_set(&lane->quit, FALSE);
+		g_atomic_int_set(&lane->discard, FALSE);
+		g_atomic_int_set(&lane->flow, GST_FLOW_OK);
+		lane->writer = g_thread_new(GST_PAD_NAME(lane), gst_uart_sink_writer, lane);
+	}
+
+	flow = g_atomic_int_get(&lane->flow);
+	if (flow != GST_FLOW_OK)
+		return flow;
+
+	buffer = gst_buffer_ref(buffer);
+	while (!ring_push(&lane->queue, buffer)) {
+		g_mutex_lock(&lane->queue_lock);
+		g_atomic_int_inc(&lane->upstream_waits);
+		while (ring_count(&lane->queue) == ring_size(&lane->queue) &&
+		       !g_atomic_int_get(&lane->discard))
+			g_cond_wait(&lane->queue_cond, &lane->queue_lock);
+		g_atomic_int_dec_and_test(&lane->upstream_waits);
+		g_mutex_unlock(&lane->queue_lock);
+		stalled = TRUE;
+		if (g_atomic_int_get(&lane->discard)) {
+			gst_buffer_unref(buffer);
+			return GST_FLOW_FLUSHING;
+		}
+	}
+	gst_uart_sink_queue_wake(lane, &lane->writer_idle);
+
+	if (stalled) {
+		GST_OBJECT_LOCK(uartsink);
+		priv->async_stalls++;
+		GST_OBJECT_UNLOCK(uartsink);
+	}
+
+	return GST_FLOW_OK;
+}
+
+/* wait for the writer to put everything queued on the wire */
+static void
+gst_uart_sink_queue_drain(GstUartSinkPad * lane)
+{
+	if (!lane->writer)
+		return;
+
+	GST_DEBUG_OBJECT(lane, "draining %u buffers", ring_count(&lane->queue));
+	g_mutex_lock(&lane->queue_lock);
+	g_atomic_int_inc(&lane->upstream_waits);
+	while ((ring_count(&lane->queue) || !g_atomic_int_get(&lane->writer_idle)) &&
+	       !g_atomic_int_get(&lane->discard) && !g_atomic_int_get(&lane->quit))
+		g_cond_wait(&lane->queue_cond, &lane->queue_lock);
+	g_atomic_int_dec_and_test(&lane->upstream_waits);
+	g_mutex_unlock(&lane->queue_lock);
+}
+
+/*
+ * Flush start has the writer throw the queue away; flush stop waits
+ * until it has, and clears any error for the new data.  Call flush
+ * stop before the lane stops flushing, so the writer is not stuck
+ * sending.
+ */
+static void
+gst_uart_sink_queue_set_flushing(GstUartSinkPad * lane, gboolean flushing)
+{
+	g_mutex_lock(&lane->queue_lock);
+	if (flushing) {
+		g_atomic_int_set(&lane->discard, TRUE);
+		g_cond_broadcast(&lane->queue_cond);
+	}
+	else {
+		if (!lane->writer)
+			g_atomic_int_set(&lane->discard, FALSE);
+		g_atomic_int_inc(&lane->upstream_waits);
+		while (g_atomic_int_get(&lane->discard))
+			g_cond_wait(&lane->queue_cond, &lane->queue_lock);
+		g_atomic_int_dec_and_test(&lane->upstream_waits);
+		g_atomic_int_set(&lane->flow, GST_FLOW_OK);
+	}
+	g_mutex_unlock(&lane->queue_lock);
+}
+
+static GstFlowReturn
+gst_uart_sink_render(GstBaseSink * basesink, GstBuffer * buffer)
+{
+	GstUartSink *uartsink;
+	GstUartSinkPrivate *priv;
+	GstUartSinkPad *lane;
+
+	GST_DEBUG_OBJECT(basesink, "buffer size=%" G_GSIZE_FORMAT,
+			 gst_buffer_get_size(buffer));
+
+	uartsink = GST_UART_SINK(basesink);
+	priv = gst_uart_sink_get_instance_private(uartsink);
+	lane = GST_UART_SINK_PAD(GST_BASE_SINK_PAD(basesink));
+
+	if (priv->async)
+		return gst_uart_sink_queue_push(uartsink, lane, buffer);
+
+	return gst_uart_sink_send(uartsink, lane, buffer);
+}
+
+static GstFlowReturn
+gst_uart_sink_lane_chain(GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+	GstUartSink *uartsink;
+	GstUartSinkPrivate *priv;
+	GstFlowReturn flow = GST_FLOW_FLUSHING;
+	gboolean eos;
+
+	uartsink = GST_UART_SINK(parent);
+	priv = gst_uart_sink_get_instance_private(uartsink);
+
+	g_mutex_lock(&priv->tx_lock);
+	eos = GST_UART_SINK_PAD(pad)->eos;
+	g_mutex_unlock(&priv->tx_lock);
+	if (eos) {
+		GST_DEBUG_OBJECT(pad, "dropping %" GST_PTR_FORMAT " after EOS", buffer);
+		flow = GST_FLOW_EOS;
+	}
+	/* started; the uart itself may be away for a reconnect */
+	else if (priv->fdset_wait) {
+		if (priv->async)
+			flow = gst_uart_sink_queue_push(uartsink, GST_UART_SINK_PAD(pad), buffer);
+		else
+			flow = gst_uart_sink_send(uartsink, GST_UART_SINK_PAD(pad), buffer);
+	}
+	gst_buffer_unref(buffer);
+
+	return flow;
+}
+
+/*
+ * Events on request lanes.  There is nothing to pass them on to; the
+ * ones that matter are handled as on the always pad, and EOS is posted
+ * by the always pad once every lane got it.
+ */
+static gboolean
+gst_uart_sink_lane_event(GstPad * pad, GstObject * parent, GstEvent * event)
+{
+	GstUartSink *uartsink = GST_UART_SINK(parent);
+	GstUartSinkPad *lane = GST_UART_SINK_PAD(pad);
+	gboolean ret = TRUE;
+	GstCaps *caps;
+
+	GST_DEBUG_OBJECT(pad, "%s", GST_EVENT_TYPE_NAME(event));
+	switch (GST_EVENT_TYPE(event)) {
+	case GST_EVENT_FLUSH_START:
+		gst_uart_sink_lane_set_flushing(uartsink, lane, TRUE);
+		gst_uart_sink_queue_set_flushing(lane, TRUE);
+		break;
+	case GST_EVENT_FLUSH_STOP:
+		gst_uart_sink_queue_set_flushing(lane, FALSE);
+		gst_uart_sink_lane_set_eos(uartsink, lane, FALSE);
+		gst_uart_sink_lane_set_flushing(uartsink, lane, FALSE);
+		break;
+	case GST_EVENT_CAPS:
+		gst_event_parse_caps(event, &caps);
+		ret = gst_uart_sink_set_caps(GST_BASE_SINK(uartsink), caps);
+		break;
+	case GST_EVENT_EOS:
+		gst_uart_sink_queue_drain(lane);
+		gst_uart_sink_lane_set_eos(uartsink, lane, TRUE);
+		break;
+	case GST_EVENT_CUSTOM_DOWNSTREAM:
+		if (gst_event_has_name(event, UART_MODEM_LINES_EVENT)) {
+			gst_uart_sink_queue_drain(lane);
+			gst_uart_sink_lines_event(uartsink, lane, event);
+		}
+		break;
 	default:
-		res =
-		    GST_BASE_SINK_CLASS(gst_uart_sink_parent_class)->query(basesink, query);
 		break;
 	}
-	return res;
+	gst_event_unref(event);
+
+	return ret;
 }
 
-static GstFlowReturn
-gst_uart_sink_render(GstBaseSink * basesink, GstBuffer * buffer)
+static GstPad *
+gst_uart_sink_request_new_pad(GstElement * element, GstPadTemplate * templ,
+			      const gchar * name, const GstCaps * caps)
 {
 	GstUartSink *uartsink;
 	GstUartSinkPrivate *priv;
-	GstFlowReturn flow = GST_FLOW_OK;
-	GstMapInfo info;
-	gssize written;
-	GstPollFD fd = GST_POLL_FD_INIT;
-	gint ret;
-
-	GST_DEBUG_OBJECT(basesink, "buffer size=%" G_GSIZE_FORMAT,
-			 gst_buffer_get_size(buffer));
+	GstPad *pad;
+	gchar *pad_name = NULL;
 
-	uartsink = GST_UART_SINK(basesink);
+	uartsink = GST_UART_SINK(element);
 	priv = gst_uart_sink_get_instance_private(uartsink);
 
-	gst_buffer_map(buffer, &info, GST_MAP_READ);
-	if (priv->bitswap)
-		bitswap(info.data, info.size);
-	written = write(priv->uart->fd, info.data, info.size);
-	GST_DEBUG_OBJECT(basesink, "%" G_GSSIZE_FORMAT " bytes written", written);
-	uart_flush(priv->uart);
-	GST_DEBUG_OBJECT(basesink, "and flushed");
-	if (priv->acknak) {
-		GST_DEBUG_OBJECT(uartsink, "gst_poll_wait() for %d usec", priv->acknak_wait);
-		ret = gst_poll_wait(priv->fdset_read, priv->acknak_wait * 1000);
-		GST_DEBUG_OBJECT(uartsink, "gst_poll_wait() returned %d", ret);
-		if (ret < 0)
-			return GST_FLOW_FLUSHING;
-		if (ret == 0) {
-			GST_DEBUG_OBJECT(uartsink, "ack/nak timeout; resending");
-			goto resend;
-		}
+	GST_OBJECT_LOCK(uartsink);
+	if (!name)
+		name = pad_name = g_strdup_printf("sink_%u", priv->lane_count);
+	priv->lane_count++;
+	GST_OBJECT_UNLOCK(uartsink);
 
-		fd.fd = priv->uart->fd;
-		if (gst_poll_fd_can_read(priv->fdset_read, &fd)) {
-			guint8 acknak;
-			gssize red;
-			red = read(priv->uart->fd, &acknak, 1);
-			if (red < 0) {
-				GST_ERROR_OBJECT(uartsink, "read error %" G_GSIZE_FORMAT, red);
-				flow = GST_FLOW_ERROR;
-				goto done;
-			}
+	pad = g_object_new(GST_TYPE_UART_SINK_PAD, "name", name, "direction", GST_PAD_SINK,
+			   "template", templ, "priority", LANE_DEFAULT_PRIORITY, NULL);
+	g_free(pad_name);
 
-			switch (acknak) {
-			case 0x6:
-				GST_DEBUG_OBJECT(uartsink, "ack (0x%02x) received", acknak);
-				goto done;
-				break;
-			case 0x15:
-				GST_DEBUG_OBJECT(uartsink, "nak (0x%02x) received", acknak);
-				goto resend;
-				break;
-			default:
-				GST_DEBUG_OBJECT(uartsink, "unknown byte for ack/nak (0x%02x)", acknak);
-				flow = GST_FLOW_ERROR;
-			}
-		}
-	}
+	gst_pad_set_chain_function(pad, GST_DEBUG_FUNCPTR(gst_uart_sink_lane_chain));
+	gst_pad_set_event_function(pad, GST_DEBUG_FUNCPTR(gst_uart_sink_lane_event));
 
-done:
-	gst_buffer_unmap(buffer, &info);
+	g_mutex_lock(&priv->tx_lock);
+	GST_UART_SINK_PAD(pad)->flushing = GST_STATE(element) <= GST_STATE_READY;
+	priv->lanes = g_list_append(priv->lanes, pad);
+	g_mutex_unlock(&priv->tx_lock);
 
-	return flow;
+	if (GST_STATE(element) > GST_STATE_READY)
+		gst_pad_set_active(pad, TRUE);
+	gst_element_add_pad(element, pad);
 
-resend:
-	GST_DEBUG_OBJECT(uartsink, "resending %" G_GSIZE_FORMAT" bytes", info.size);
-	written = write(priv->uart->fd, info.data, info.size);
-	uart_flush(priv->uart);
+	return pad;
+}
+
+static void
+gst_uart_sink_release_pad(GstElement * element, GstPad * pad)
+{
+	GstUartSinkPrivate *priv;
+
+	priv = gst_uart_sink_get_instance_private(GST_UART_SINK(element));
+
+	g_mutex_lock(&priv->tx_lock);
+	priv->lanes = g_list_remove(priv->lanes, pad);
+	GST_UART_SINK_PAD(pad)->flushing = TRUE;
+	g_cond_broadcast(&priv->tx_cond);
+	g_mutex_unlock(&priv->tx_lock);
 
-	goto done;
+	gst_uart_sink_queue_set_flushing(GST_UART_SINK_PAD(pad), TRUE);
+	gst_uart_sink_writer_stop(GST_UART_SINK_PAD(pad));
+	gst_pad_set_active(pad, FALSE);
+	gst_element_remove_pad(element, pad);
 }
 
 static gboolean
@@ -316,8 +2199,8 @@ gst_uart_sink_start(GstBaseSink * basesink)
 	GstUartSink *uartsink;
 	GstUartSinkPrivate *priv;
 	GstPollFD fd = GST_POLL_FD_INIT;
+	struct uart_config config;
 	GError *error = NULL;
-	int ret;
 
 	uartsink = GST_UART_SINK(basesink);
 	priv = gst_uart_sink_get_instance_private(uartsink);
@@ -327,9 +2210,17 @@ gst_uart_sink_start(GstBaseSink * basesink)
 	if (!priv->device || priv->device[0] == '\0')
 		goto no_device;
 
-	priv->uart = uart_open_raw(priv->device, O_RDWR);
-	if (!priv->uart)
-		goto open_failed;
+	if (g_strcmp0(priv->kept_device, priv->device))
+		gst_uart_sink_close_kept(uartsink);
+	if (priv->kept_device) {
+		GST_INFO_OBJECT(uartsink, "\"%s\" is still open", priv->device);
+		g_clear_pointer(&priv->kept_device, g_free);
+	}
+	else {
+		priv->uart = uart_open(priv->device, O_RDWR);
+		if (!priv->uart)
+			goto open_failed;
+	}
 
 	GST_DEBUG("c_iflag: 0x%x", priv->uart->orig.c_iflag);
 	GST_DEBUG("c_oflag: 0x%x", priv->uart->orig.c_oflag);
@@ -340,13 +2231,19 @@ gst_uart_sink_start(GstBaseSink * basesink)
 	GST_DEBUG("ispeed: %d", priv->uart->orig.c_ispeed);
 	GST_DEBUG("ispeed: %d", uart_get_baud_rate(priv->uart));
 
-	ret = uart_set_baud_rate(priv->uart, priv->baud_rate, &error);
-	if (error)
+	/* uart_open() flushed already; a kept one has nothing to throw away */
+	GST_OBJECT_LOCK(uartsink);
+	gst_uart_sink_get_config(uartsink, &config);
+	GST_OBJECT_UNLOCK(uartsink);
+	if (uart_configure(priv->uart, &config, TCSANOW, &error) < 0)
 		goto setting_failed;
-	GST_DEBUG("ret: %d", ret);
 	GST_DEBUG("baud rate: %d", priv->baud_rate);
 
-	uart_set_parity(priv->uart, priv->parity);
+	priv->reconfigure = FALSE;
+	GST_OBJECT_LOCK(uartsink);
+	gst_uart_sink_apply_lines(uartsink);
+	GST_OBJECT_UNLOCK(uartsink);
+	gst_uart_sink_apply_rs485(uartsink);
 
 	GST_DEBUG("== after set parity ==");
 	GST_DEBUG("c_iflag: 0x%x", priv->uart->orig.c_iflag);
@@ -373,8 +2270,29 @@ gst_uart_sink_start(GstBaseSink * basesink)
 	gst_poll_add_fd(priv->fdset_read, &fd);
 	gst_poll_fd_ctl_read(priv->fdset_read, &fd, TRUE);
 
+	/* no fd; used as a flushable sleep */
+	priv->fdset_wait = gst_poll_new(TRUE);
+	if (!priv->fdset_wait)
+		goto poll_failed;
+
 	priv->bytes_written = 0;
 	priv->current_pos = 0;
+	fault_reset(&priv->fault);
+	priv->acknak_seq = 0;
+	priv->acknak_credit = priv->acknak_window;
+	priv->acknak_retries = 0;
+	priv->acknak_partial = -1;
+	lzss_clear(&priv->lzss);
+	lzss_init(&priv->lzss, priv->compress_window, priv->compress_lookahead);
+	g_free(priv->packed);
+	priv->packed = g_malloc(LZSS_BLOCK_BOUND(priv->compress_block_size));
+	priv->compress_count = 0;
+	rs_frame_init(&priv->fec_frame, priv->fec_parity, priv->fec_depth);
+	g_free(priv->coded);
+	priv->coded = g_malloc(RS_FRAME_BOUND(priv->fec_depth));
+	GST_OBJECT_LOCK(uartsink);
+	gst_uart_sink_timed_reset(uartsink);
+	GST_OBJECT_UNLOCK(uartsink);
 
 	return TRUE;
 
@@ -396,15 +2314,16 @@ setting_failed:
 	{
 		GST_ELEMENT_ERROR(uartsink, RESOURCE, SETTINGS,
 				  ("%s", error->message), GST_ERROR_SYSTEM);
-		g_close(priv->uart->fd, NULL);
-		priv->uart->fd = -1;
+		g_clear_error(&error);
+		uart_close(priv->uart);
+		priv->uart = NULL;
 		return FALSE;
 
 	}
 poll_failed:
 	{
-		g_close(priv->uart->fd, NULL);
-		priv->uart->fd = -1;
+		uart_close(priv->uart);
+		priv->uart = NULL;
 		GST_ELEMENT_ERROR(uartsink, RESOURCE, OPEN_READ_WRITE, (NULL),
 				  GST_ERROR_SYSTEM);
 		return FALSE;
@@ -417,24 +2336,50 @@ gst_uart_sink_stop(GstBaseSink * basesink)
 	GstUartSink *uartsink;
 	GstUartSinkPrivate *priv;
 	GstPollFD fd = GST_POLL_FD_INIT;
+	struct uart *uart;
+	GList *lanes, *l;
 
 	GST_DEBUG("%s", __func__);
 	uartsink = GST_UART_SINK(basesink);
 	priv = gst_uart_sink_get_instance_private(uartsink);
 
+	/* the lanes are flushing by now, nothing holds the wire for long */
+	g_mutex_lock(&priv->tx_lock);
+	lanes = g_list_copy_deep(priv->lanes, (GCopyFunc)gst_object_ref, NULL);
+	g_mutex_unlock(&priv->tx_lock);
+	for (l = lanes; l; l = l->next)
+		gst_uart_sink_writer_stop(GST_UART_SINK_PAD(l->data));
+	g_list_free_full(lanes, gst_object_unref);
+
 	if (priv->uart) {
-		GST_DEBUG("%s: close", __func__);
 		fd.fd = priv->uart->fd;
 		gst_poll_remove_fd(priv->fdset_write, &fd);
 		gst_poll_remove_fd(priv->fdset_read, &fd);
-		uart_close(priv->uart);
-		priv->uart = NULL;
-
+		if (priv->keep_open) {
+			GST_DEBUG("%s: keeping \"%s\" open", __func__, priv->device);
+			priv->kept_device = g_strdup(priv->device);
+		}
+		else {
+			GST_DEBUG("%s: close", __func__);
+			GST_OBJECT_LOCK(uartsink);
+			uart = priv->uart;
+			priv->uart = NULL;
+			GST_OBJECT_UNLOCK(uartsink);
+			uart_close(uart);
+		}
+	}
+	/* the device may be gone while we wait for it to come back */
+	if (priv->fdset_wait) {
 		gst_poll_free(priv->fdset_write);
 		gst_poll_free(priv->fdset_read);
+		gst_poll_free(priv->fdset_wait);
 		priv->fdset_write = NULL;
 		priv->fdset_read = NULL;
+		priv->fdset_wait = NULL;
 	}
+	g_queue_clear_full(&priv->unacked, (GDestroyNotify)g_bytes_unref);
+	g_clear_pointer(&priv->packed, g_free);
+	g_clear_pointer(&priv->coded, g_free);
 
 	return TRUE;
 }
@@ -443,12 +2388,17 @@ static gboolean
 gst_uart_sink_unlock(GstBaseSink * basesink)
 {
 	GstUartSink *uartsink = GST_UART_SINK(basesink);
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
 
 	GST_LOG_OBJECT(uartsink, "Flushing");
 	GST_OBJECT_LOCK(uartsink);
-	/* uartsink->unlock = TRUE; */
-	/* gst_poll_set_flushing (uartsink->fdset_write, TRUE); */
+	if (priv->fdset_read)
+		gst_poll_set_flushing(priv->fdset_read, TRUE);
+	if (priv->fdset_wait)
+		gst_poll_set_flushing(priv->fdset_wait, TRUE);
 	GST_OBJECT_UNLOCK(uartsink);
+	gst_uart_sink_lane_set_flushing(uartsink, GST_UART_SINK_PAD(GST_BASE_SINK_PAD(basesink)), TRUE);
+	gst_uart_sink_queue_set_flushing(GST_UART_SINK_PAD(GST_BASE_SINK_PAD(basesink)), TRUE);
 
 	return TRUE;
 }
@@ -457,16 +2407,37 @@ static gboolean
 gst_uart_sink_unlock_stop(GstBaseSink * basesink)
 {
 	GstUartSink *uartsink = GST_UART_SINK(basesink);
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
 
 	GST_LOG_OBJECT(uartsink, "No longer flushing");
+	gst_uart_sink_queue_set_flushing(GST_UART_SINK_PAD(GST_BASE_SINK_PAD(basesink)), FALSE);
 	GST_OBJECT_LOCK(uartsink);
-	/* uartsink->unlock = FALSE; */
-	/* gst_poll_set_flushing (uartsink->fdset_write, FALSE); */
+	if (priv->fdset_read)
+		gst_poll_set_flushing(priv->fdset_read, FALSE);
+	if (priv->fdset_wait)
+		gst_poll_set_flushing(priv->fdset_wait, FALSE);
 	GST_OBJECT_UNLOCK(uartsink);
+	gst_uart_sink_lane_set_flushing(uartsink, GST_UART_SINK_PAD(GST_BASE_SINK_PAD(basesink)), FALSE);
 
 	return TRUE;
 }
 
+/* the paced output queue is latency the pipeline has to account for */
+static void
+gst_uart_sink_update_latency(GstUartSink * uartsink)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	GstClockTime delay;
+
+	delay = priv->pacing ? priv->pacing_latency * GST_USECOND : 0;
+	if (delay == gst_base_sink_get_render_delay(GST_BASE_SINK(uartsink)))
+		return;
+
+	gst_base_sink_set_render_delay(GST_BASE_SINK(uartsink), delay);
+	gst_element_post_message(GST_ELEMENT(uartsink),
+				 gst_message_new_latency(GST_OBJECT(uartsink)));
+}
+
 static void
 gst_uart_sink_set_property(GObject * object, guint prop_id, const GValue * value,
 			   GParamSpec * pspec)
@@ -484,19 +2455,21 @@ gst_uart_sink_set_property(GObject * object, guint prop_id, const GValue * value
 		break;
 
 	case ARG_BAUD_RATE:
+		GST_OBJECT_LOCK(uartsink);
 		priv->baud_rate = g_value_get_int(value);
+		priv->reconfigure = TRUE;
+		GST_OBJECT_UNLOCK(uartsink);
 		GST_DEBUG("baud rate: '%d'", priv->baud_rate);
 		break;
 
 	case ARG_PARITY:
 	{
 		const char *s = g_value_get_string(value);
-		if (g_str_equal(s, "no"))
-			priv->parity = UART_PARITY_NO;
-		else if (g_str_equal(s, "even"))
-			priv->parity = UART_PARITY_EVEN;
-		else if (g_str_equal(s, "odd"))
-			priv->parity = UART_PARITY_ODD;
+		GST_OBJECT_LOCK(uartsink);
+		if (!uart_parity_from_string(s, &priv->parity))
+			GST_WARNING_OBJECT(uartsink, "unknown parity \"%s\"", s);
+		priv->reconfigure = TRUE;
+		GST_OBJECT_UNLOCK(uartsink);
 
 		GST_DEBUG("parity: '%s'", s);
 		break;
@@ -516,6 +2489,174 @@ gst_uart_sink_set_property(GObject * object, guint prop_id, const GValue * value
 		GST_DEBUG("acknak-wait: '%u'", priv->acknak_wait);
 		break;
 
+	case ARG_ACKNAK_WINDOW:
+		priv->acknak_window = g_value_get_uint(value);
+		GST_DEBUG("acknak-window: '%u'", priv->acknak_window);
+		break;
+
+	case ARG_DTR:
+		GST_OBJECT_LOCK(uartsink);
+		priv->dtr = g_value_get_boolean(value);
+		gst_uart_sink_apply_lines(uartsink);
+		GST_OBJECT_UNLOCK(uartsink);
+		GST_DEBUG("dtr: '%d'", priv->dtr);
+		break;
+
+	case ARG_RTS:
+		GST_OBJECT_LOCK(uartsink);
+		priv->rts = g_value_get_boolean(value);
+		gst_uart_sink_apply_lines(uartsink);
+		GST_OBJECT_UNLOCK(uartsink);
+		GST_DEBUG("rts: '%d'", priv->rts);
+		break;
+
+	case ARG_RS485:
+		priv->rs485.enabled = g_value_get_boolean(value);
+		GST_DEBUG("rs485: '%d'", priv->rs485.enabled);
+		break;
+
+	case ARG_RS485_RTS_ON_SEND:
+		priv->rs485.rts_on_send = g_value_get_boolean(value);
+		GST_DEBUG("rs485-rts-on-send: '%d'", priv->rs485.rts_on_send);
+		break;
+
+	case ARG_RS485_DELAY_BEFORE:
+		priv->rs485.delay_before = g_value_get_uint(value);
+		GST_DEBUG("rs485-delay-before: '%u'", priv->rs485.delay_before);
+		break;
+
+	case ARG_RS485_DELAY_AFTER:
+		priv->rs485.delay_after = g_value_get_uint(value);
+		GST_DEBUG("rs485-delay-after: '%u'", priv->rs485.delay_after);
+		break;
+
+	case ARG_PACING:
+		priv->pacing = g_value_get_boolean(value);
+		GST_DEBUG("pacing: '%d'", priv->pacing);
+		gst_uart_sink_update_latency(uartsink);
+		break;
+
+	case ARG_PACING_LATENCY:
+		priv->pacing_latency = g_value_get_uint(value);
+		GST_DEBUG("pacing-latency: '%u'", priv->pacing_latency);
+		gst_uart_sink_update_latency(uartsink);
+		break;
+
+	case ARG_BULK_SHARE:
+		priv->bulk_share = g_value_get_uint(value);
+		GST_DEBUG("bulk-share: '%u'", priv->bulk_share);
+		break;
+
+	case ARG_BULK_FRAME_SIZE:
+		priv->bulk_frame_size = g_value_get_uint(value);
+		GST_DEBUG("bulk-frame-size: '%u'", priv->bulk_frame_size);
+		break;
+
+	case ARG_RECONNECT:
+		priv->reconnect = g_value_get_boolean(value);
+		GST_DEBUG("reconnect: '%d'", priv->reconnect);
+		break;
+
+	case ARG_RECONNECT_INTERVAL:
+		priv->reconnect_interval = g_value_get_uint(value);
+		GST_DEBUG("reconnect-interval: '%u'", priv->reconnect_interval);
+		break;
+
+	case ARG_FAULT_SEED:
+		priv->fault.seed = g_value_get_uint(value);
+		GST_DEBUG("fault-seed: '%u'", priv->fault.seed);
+		break;
+
+	case ARG_FAULT_LOSS:
+		priv->fault.loss = g_value_get_double(value);
+		GST_DEBUG("fault-loss: '%f'", priv->fault.loss);
+		break;
+
+	case ARG_FAULT_BURST:
+		priv->fault.burst = g_value_get_uint(value);
+		GST_DEBUG("fault-burst: '%u'", priv->fault.burst);
+		break;
+
+	case ARG_FAULT_CORRUPT:
+		priv->fault.corrupt = g_value_get_double(value);
+		GST_DEBUG("fault-corrupt: '%f'", priv->fault.corrupt);
+		break;
+
+	case ARG_FAULT_DELAY:
+		priv->fault.delay = g_value_get_uint(value);
+		GST_DEBUG("fault-delay: '%u'", priv->fault.delay);
+		break;
+
+	case ARG_COMPRESS:
+		priv->compress = g_value_get_boolean(value);
+		GST_DEBUG("compress: '%d'", priv->compress);
+		break;
+
+	case ARG_COMPRESS_BLOCK_SIZE:
+		priv->compress_block_size = g_value_get_uint(value);
+		GST_DEBUG("compress-block-size: '%u'", priv->compress_block_size);
+		break;
+
+	case ARG_COMPRESS_WINDOW:
+		priv->compress_window = g_value_get_uint(value);
+		GST_DEBUG("compress-window: '%u'", priv->compress_window);
+		break;
+
+	case ARG_COMPRESS_LOOKAHEAD:
+		priv->compress_lookahead = g_value_get_uint(value);
+		GST_DEBUG("compress-lookahead: '%u'", priv->compress_lookahead);
+		break;
+
+	case ARG_COMPRESS_RESET:
+		priv->compress_reset = g_value_get_uint(value);
+		GST_DEBUG("compress-reset: '%u'", priv->compress_reset);
+		break;
+
+	case ARG_FEC:
+		priv->fec = g_value_get_boolean(value);
+		GST_DEBUG("fec: '%d'", priv->fec);
+		break;
+
+	case ARG_FEC_PARITY:
+		priv->fec_parity = g_value_get_uint(value);
+		GST_DEBUG("fec-parity: '%u'", priv->fec_parity);
+		break;
+
+	case ARG_FEC_DEPTH:
+		priv->fec_depth = g_value_get_uint(value);
+		GST_DEBUG("fec-depth: '%u'", priv->fec_depth);
+		break;
+
+	case ARG_ASYNC:
+		priv->async = g_value_get_boolean(value);
+		GST_DEBUG("async: '%d'", priv->async);
+		break;
+
+	case ARG_ASYNC_QUEUE_SIZE:
+		priv->async_queue_size = g_value_get_uint(value);
+		GST_DEBUG("async-queue-size: '%u'", priv->async_queue_size);
+		break;
+
+	case ARG_TIMED:
+		priv->timed = g_value_get_boolean(value);
+		GST_DEBUG("timed: '%d'", priv->timed);
+		gst_element_post_message(GST_ELEMENT(uartsink),
+					 gst_message_new_latency(GST_OBJECT(uartsink)));
+		break;
+
+	case ARG_KEEP_OPEN:
+		priv->keep_open = g_value_get_boolean(value);
+		GST_DEBUG("keep-open: '%d'", priv->keep_open);
+		break;
+
+	case ARG_ADDRESS:
+		GST_OBJECT_LOCK(uartsink);
+		priv->address = g_value_get_int(value);
+		priv->reconfigure = TRUE;
+		GST_OBJECT_UNLOCK(uartsink);
+		GST_DEBUG("address: '%d'", priv->address);
+		break;
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 		break;
@@ -542,17 +2683,7 @@ gst_uart_sink_get_property(GObject * object, guint prop_id, GValue * value,
 		break;
 
 	case ARG_PARITY:
-		switch (priv->parity) {
-		default:
-			g_value_set_string(value, "no");
-			break;
-		case UART_PARITY_EVEN:
-			g_value_set_string(value, "even");
-			break;
-		case UART_PARITY_ODD:
-			g_value_set_string(value, "odd");
-			break;
-		}
+		g_value_set_string(value, uart_parity_to_string(priv->parity));
 		break;
 
 	case ARG_BITSWAP:
@@ -567,25 +2698,248 @@ gst_uart_sink_get_property(GObject * object, guint prop_id, GValue * value,
 		g_value_set_uint(value, priv->acknak_wait);
 		break;
 
+	case ARG_ACKNAK_WINDOW:
+		g_value_set_uint(value, priv->acknak_window);
+		break;
+
+	case ARG_DTR:
+		g_value_set_boolean(value, priv->dtr);
+		break;
+
+	case ARG_RTS:
+		g_value_set_boolean(value, priv->rts);
+		break;
+
+	case ARG_RS485:
+		g_value_set_boolean(value, priv->rs485.enabled);
+		break;
+
+	case ARG_RS485_RTS_ON_SEND:
+		g_value_set_boolean(value, priv->rs485.rts_on_send);
+		break;
+
+	case ARG_RS485_DELAY_BEFORE:
+		g_value_set_uint(value, priv->rs485.delay_before);
+		break;
+
+	case ARG_RS485_DELAY_AFTER:
+		g_value_set_uint(value, priv->rs485.delay_after);
+		break;
+
+	case ARG_PACING:
+		g_value_set_boolean(value, priv->pacing);
+		break;
+
+	case ARG_PACING_LATENCY:
+		g_value_set_uint(value, priv->pacing_latency);
+		break;
+
+	case ARG_BULK_SHARE:
+		g_value_set_uint(value, priv->bulk_share);
+		break;
+
+	case ARG_BULK_FRAME_SIZE:
+		g_value_set_uint(value, priv->bulk_frame_size);
+		break;
+
+	case ARG_RECONNECT:
+		g_value_set_boolean(value, priv->reconnect);
+		break;
+
+	case ARG_RECONNECT_INTERVAL:
+		g_value_set_uint(value, priv->reconnect_interval);
+		break;
+
+	case ARG_FAULT_SEED:
+		g_value_set_uint(value, priv->fault.seed);
+		break;
+
+	case ARG_FAULT_LOSS:
+		g_value_set_double(value, priv->fault.loss);
+		break;
+
+	case ARG_FAULT_BURST:
+		g_value_set_uint(value, priv->fault.burst);
+		break;
+
+	case ARG_FAULT_CORRUPT:
+		g_value_set_double(value, priv->fault.corrupt);
+		break;
+
+	case ARG_FAULT_DELAY:
+		g_value_set_uint(value, priv->fault.delay);
+		break;
+
+	case ARG_FAULT_STATS:
+		g_value_take_boxed(value, gst_structure_new("fault-stats",
+							    "dropped", G_TYPE_UINT64, priv->fault.dropped,
+							    "corrupted", G_TYPE_UINT64, priv->fault.corrupted,
+							    "delayed", G_TYPE_UINT64, priv->fault.delayed,
+							    NULL));
+		break;
+
+	case ARG_COMPRESS:
+		g_value_set_boolean(value, priv->compress);
+		break;
+
+	case ARG_COMPRESS_BLOCK_SIZE:
+		g_value_set_uint(value, priv->compress_block_size);
+		break;
+
+	case ARG_COMPRESS_WINDOW:
+		g_value_set_uint(value, priv->compress_window);
+		break;
+
+	case ARG_COMPRESS_LOOKAHEAD:
+		g_value_set_uint(value, priv->compress_lookahead);
+		break;
+
+	case ARG_COMPRESS_RESET:
+		g_value_set_uint(value, priv->compress_reset);
+		break;
+
+	case ARG_COMPRESS_STATS:
+		g_value_take_boxed(value, gst_structure_new("compress-stats",
+							    "blocks", G_TYPE_UINT64, priv->lzss.blocks,
+							    "stored", G_TYPE_UINT64, priv->lzss.stored,
+							    "raw-bytes", G_TYPE_UINT64, priv->lzss.raw,
+							    "wire-bytes", G_TYPE_UINT64, priv->lzss.wire,
+							    "ratio", G_TYPE_DOUBLE, priv->lzss.wire ?
+							    (gdouble)priv->lzss.raw / priv->lzss.wire : 0.0,
+							    NULL));
+		break;
+
+	case ARG_FEC:
+		g_value_set_boolean(value, priv->fec);
+		break;
+
+	case ARG_FEC_PARITY:
+		g_value_set_uint(value, priv->fec_parity);
+		break;
+
+	case ARG_FEC_DEPTH:
+		g_value_set_uint(value, priv->fec_depth);
+		break;
+
+	case ARG_FEC_STATS:
+		g_value_take_boxed(value, gst_structure_new("fec-stats",
+							    "frames", G_TYPE_UINT64, priv->fec_frame.frames,
+							    "raw-bytes", G_TYPE_UINT64, priv->fec_frame.raw,
+							    "wire-bytes", G_TYPE_UINT64, priv->fec_frame.wire,
+							    "rate", G_TYPE_DOUBLE, priv->fec_frame.wire ?
+							    (gdouble)priv->fec_frame.raw / priv->fec_frame.wire : 0.0,
+							    NULL));
+		break;
+
+	case ARG_ASYNC:
+		g_value_set_boolean(value, priv->async);
+		break;
+
+	case ARG_ASYNC_QUEUE_SIZE:
+		g_value_set_uint(value, priv->async_queue_size);
+		break;
+
+	case ARG_ASYNC_STATS:
+		GST_OBJECT_LOCK(uartsink);
+		g_value_take_boxed(value, gst_structure_new("async-stats",
+							    "buffers", G_TYPE_UINT64, priv->async_buffers,
+							    "stalls", G_TYPE_UINT64, priv->async_stalls,
+							    "discarded", G_TYPE_UINT64, priv->async_discarded,
+							    NULL));
+		GST_OBJECT_UNLOCK(uartsink);
+		break;
+
+	case ARG_TIMED:
+		g_value_set_boolean(value, priv->timed);
+		break;
+
+	case ARG_KEEP_OPEN:
+		g_value_set_boolean(value, priv->keep_open);
+		break;
+
+	case ARG_ADDRESS:
+		g_value_set_int(value, priv->address);
+		break;
+
+	case ARG_TIMED_STATS:
+		GST_OBJECT_LOCK(uartsink);
+		g_value_take_boxed(value, gst_structure_new("timed-stats",
+							    "buffers", G_TYPE_UINT64, priv->timed_buffers,
+							    "late", G_TYPE_UINT64, priv->timed_late,
+							    "mean-error", G_TYPE_INT64, priv->timed_buffers ?
+							    priv->timed_error_sum / (gint64)priv->timed_buffers : 0,
+							    "min-error", G_TYPE_INT64, priv->timed_error_min,
+							    "max-error", G_TYPE_INT64, priv->timed_error_max,
+							    NULL));
+		GST_OBJECT_UNLOCK(uartsink);
+		break;
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 		break;
 	}
 }
 
+/*
+ * A DTR / RTS change in the stream takes effect once the data before
+ * it left the wire.
+ */
+static void
+gst_uart_sink_lines_event(GstUartSink * uartsink, GstUartSinkPad * lane, GstEvent * event)
+{
+	GstUartSinkPrivate *priv = gst_uart_sink_get_instance_private(uartsink);
+	const GstStructure *s = gst_event_get_structure(event);
+	gboolean dtr, rts;
+
+	if (!gst_uart_sink_lane_acquire(uartsink, lane))
+		return;
+	if (priv->uart)
+		uart_flush(priv->uart);
+	GST_OBJECT_LOCK(uartsink);
+	if (gst_structure_get_boolean(s, "dtr", &dtr))
+		priv->dtr = dtr;
+	if (gst_structure_get_boolean(s, "rts", &rts))
+		priv->rts = rts;
+	GST_DEBUG_OBJECT(uartsink, "dtr %d, rts %d", priv->dtr, priv->rts);
+	gst_uart_sink_apply_lines(uartsink);
+	GST_OBJECT_UNLOCK(uartsink);
+	gst_uart_sink_lane_release(uartsink, lane, 0);
+}
+
 static gboolean
 gst_uart_sink_event(GstBaseSink * sink, GstEvent * event)
 {
 	GstUartSink *uartsink;
+	GstUartSinkPrivate *priv;
 	GstEventType type;
 
 	uartsink = GST_UART_SINK(sink);
+	priv = gst_uart_sink_get_instance_private(uartsink);
 	type = GST_EVENT_TYPE(event);
 
 	switch (type) {
 	case GST_EVENT_SEGMENT:
 		GST_DEBUG("segment");
 		break;
+	case GST_EVENT_EOS:
+		gst_uart_sink_queue_drain(GST_UART_SINK_PAD(GST_BASE_SINK_PAD(sink)));
+		/* the request lanes went through the same window */
+		if (!gst_uart_sink_lanes_wait_eos(uartsink))
+			break;
+		if (priv->acknak && priv->acknak_window &&
+		    gst_uart_sink_lane_acquire(uartsink, GST_UART_SINK_PAD(GST_BASE_SINK_PAD(sink)))) {
+			GST_DEBUG_OBJECT(uartsink, "draining %u unacked frames",
+					 g_queue_get_length(&priv->unacked));
+			gst_uart_sink_acknak_drain(uartsink);
+			gst_uart_sink_lane_release(uartsink, GST_UART_SINK_PAD(GST_BASE_SINK_PAD(sink)), 0);
+		}
+		break;
+	case GST_EVENT_CUSTOM_DOWNSTREAM:
+		if (gst_event_has_name(event, UART_MODEM_LINES_EVENT)) {
+			gst_uart_sink_queue_drain(GST_UART_SINK_PAD(GST_BASE_SINK_PAD(sink)));
+			gst_uart_sink_lines_event(uartsink, GST_UART_SINK_PAD(GST_BASE_SINK_PAD(sink)), event);
+		}
+		break;
 	default:
 		GST_DEBUG("%s", GST_EVENT_TYPE_NAME(event));
 		break;
@@ -34,4 +34,8 @@ struct _GstUartSinkClass {
 	GstBaseSinkClass parent_class;
 };
 
+#define GST_TYPE_UART_SINK_PAD gst_uart_sink_pad_get_type ()
+
+G_DECLARE_FINAL_TYPE (GstUartSinkPad, gst_uart_sink_pad, GST, UART_SINK_PAD, GstPad)
+
 G_END_DECLS
@@ -19,8 +19,11 @@
  * Boston, MA 02110-1301, USA.
  */
 
+#define _GNU_SOURCE	/* pipe2() for the line pipe, sched_setaffinity() */
+#include <sched.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/ioctl.h>
 #include <fcntl.h>
 #include <stdio.h>
 #include <unistd.h>
@@ -32,12 +35,68 @@
 #include "config.h"
 #include "gstuartsrc.h"
 #include "uart.h"
+#include "uartconn.h"
+#include "uartlines.h"
+#include "pps.h"
+#include "fault.h"
+#include "acknak.h"
 #include "bitswap.h"
+#include "lzss.h"
+#include "rs.h"
+#include "trigger.h"
+#include "multidrop.h"
+#include "parmrk.h"
+#include "gstuarterrormeta.h"
+
+#define UART_CAPS "application/x-uart, "				\
+	"baud = (int) [ 50, 4000000 ], "				\
+	"parity = (string) { no, even, odd, mark, space }, "		\
+	"framing = (string) { stream, idle, fixed }, "			\
+	"chunk-size = (int) [ 1, MAX ], "				\
+	"bitswap = (boolean) { false, true }"
 
 static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE("src",
 								  GST_PAD_SRC,
 								  GST_PAD_ALWAYS,
-								  GST_STATIC_CAPS_ANY);
+								  GST_STATIC_CAPS(UART_CAPS));
+
+#define AUTO_BAUD_DEFAULT_TIMEOUT (5000) /* 5 sec */
+#define AUTO_BAUD_SAMPLE (64) /* characters per trial */
+#define AUTO_BAUD_MIN_DWELL (20 * GST_MSECOND)
+#define SYNC_PATTERN_MAX (AUTO_BAUD_SAMPLE / 4)
+#define RECONNECT_DEFAULT_INTERVAL (500) /* 500 ms */
+#define ARRIVAL_MAX_JITTER (2 * GST_MSECOND)
+#define IDLE_CHARS (4)	/* silence that ends an idle framed buffer */
+#define IDLE_MIN (2 * GST_MSECOND)	/* USB adapters deliver in bursts */
+#define BUSY_POLL_DEFAULT_BUDGET (200) /* usec */
+#define BUSY_POLL_MIN_SPIN (5 * GST_USECOND)
+#define WAKE_BUCKETS (12)	/* under 1, 2, 4 ... 1024 usec, and the rest */
+#define TRIGGER_PATTERN_MAX (64)
+#define TRIGGER_WINDOW_MAX (1 << 20)
+#define TRIGGER_DEFAULT_PRE (64)
+#define TRIGGER_DEFAULT_POST (256)
+
+/* most likely first */
+static const int auto_baud_rates[] = {
+	115200, 9600, 19200, 38400, 57600, 230400, 460800, 921600, 4800, 2400,
+};
+
+static const enum UartParity auto_baud_parities[] = {
+	UART_PARITY_NO, UART_PARITY_EVEN, UART_PARITY_ODD,
+};
+
+/* how the stream is cut into buffers */
+enum Framing {
+	FRAMING_STREAM,		/* whatever a read gives */
+	FRAMING_IDLE,		/* up to where the line goes idle */
+	FRAMING_FIXED,		/* exactly chunk-size bytes */
+};
+
+static const char *framing_names[] = {
+	[FRAMING_STREAM] = "stream",
+	[FRAMING_IDLE] = "idle",
+	[FRAMING_FIXED] = "fixed",
+};
 
 GST_DEBUG_CATEGORY_STATIC(gst_uart_src_debug);
 #define GST_CAT_DEFAULT gst_uart_src_debug
@@ -50,18 +109,125 @@ enum {
 	ARG_BITSWAP,
 	ARG_ACKNAK,
 	ARG_NAK_PROBABILITY,
+	ARG_ACKNAK_WINDOW,
+	ARG_AUTO_BAUD,
+	ARG_AUTO_BAUD_TIMEOUT,
+	ARG_SYNC_PATTERN,
+	ARG_RECONNECT,
+	ARG_RECONNECT_INTERVAL,
+	ARG_FAULT_SEED,
+	ARG_FAULT_LOSS,
+	ARG_FAULT_BURST,
+	ARG_FAULT_CORRUPT,
+	ARG_FAULT_DELAY,
+	ARG_FAULT_STATS,
+	ARG_PPS_LINE,
+	ARG_PROVIDE_CLOCK,
+	ARG_PPS_STATS,
+	ARG_WATCH_LINES,
+	ARG_DECOMPRESS,
+	ARG_DECOMPRESS_STATS,
+	ARG_FEC,
+	ARG_FEC_STATS,
+	ARG_LOW_LATENCY,
+	ARG_LATENCY_SETTINGS,
+	ARG_BUSY_POLL,
+	ARG_BUSY_POLL_BUDGET,
+	ARG_BUSY_POLL_CPU,
+	ARG_BUSY_POLL_STATS,
+	ARG_KEEP_OPEN,
+	ARG_TRIGGER,
+	ARG_TRIGGER_PRE,
+	ARG_TRIGGER_POST,
+	ARG_TRIGGER_GATE,
+	ARG_TRIGGER_STATS,
+	ARG_MULTIDROP,
+	ARG_ADDRESS_FILTER,
+	ARG_MULTIDROP_STATS,
+	ARG_MARK_ERRORS,
+	ARG_MARK_ERRORS_STATS,
+};
+
+/* a match, until it is posted */
+struct trigger_hit {
+	guint pattern;
+	guint64 offset;
 };
 
 struct _GstUartSrcPrivate {
 	char *device;
 	int baud_rate;
 	enum UartParity parity;
+	gboolean reconfigure;
 	gboolean bitswap;
 	gboolean acknak;
 	guint nak_probability;
+	guint acknak_window;
+	gboolean auto_baud;
+	guint auto_baud_timeout;
+	GByteArray *sync_pattern;
+	gboolean auto_baud_done;
+	gboolean reconnect;
+	guint reconnect_interval;
+	struct fault fault;
+	gboolean count_overruns;	/* the driver counts them */
+	guint32 overruns;
+	gboolean started;	/* a buffer went out */
+	gboolean discont;
+	struct uart_conn conn;	/* of the device that went away */
+	GstClockTime lost_at;	/* running time */
 	struct uart *uart;
 	GstPoll *fdset_read;
 	GstPoll *fdset_write;
+	GstPoll *fdset_wait;
+	guint64 acknak_count;
+	int pps_line;		/* TIOCM_* bit the PPS comes on, 0 for none */
+	gboolean provide_clock;
+	struct uart_line_monitor *pps_monitor;
+	struct pps pps;		/* protected by the object lock */
+	GstClock *clock;
+	guint64 clock_epoch;	/* pps.index the clock (re)locked at */
+	GstClockTime clock_epoch_time;
+	GstClockTime arrival;	/* host time the last byte came in */
+	int watch_lines;	/* TIOCM_* bits reported downstream */
+	struct uart_line_monitor *line_monitor;
+	int line_pipe[2];	/* line changes, from the monitor to fill() */
+	int wake[2];		/* set_property, to get fill() out of its wait */
+	int lines;		/* as last reported, -1 before the first */
+	guint acknak_seq;	/* next frame a plain ack is for */
+	enum Framing framing;	/* as negotiated */
+	gboolean decompress;
+	struct lzss_unpacker unpacker;
+	gboolean fec;
+	struct rs_unpacker fec_unpacker;
+	GByteArray *corrected;	/* FEC output, on its way to decompression */
+	GByteArray *decoded;	/* decoded but not pushed yet */
+	gboolean low_latency;
+	gboolean busy_poll;
+	guint busy_poll_budget;	/* usec */
+	gint busy_poll_cpu;	/* to pin the streaming thread to, or -1 */
+	gboolean pinned;
+	gboolean unpin;		/* affinity has what the thread had before */
+	cpu_set_t affinity;
+	GstClockTime spin;	/* the budget as it adapted */
+	guint64 spin_hits;	/* data came while spinning */
+	guint64 spin_misses;	/* went to sleep */
+	guint64 wake_to_push[WAKE_BUCKETS];
+	gboolean keep_open;
+	char *kept_device;	/* priv->uart stayed open for this one */
+	char *trigger_patterns;	/* as set */
+	gboolean triggering;	/* there are patterns */
+	struct trigger trigger;	/* protected by the object lock */
+	GArray *trigger_hits;	/* struct trigger_hit, under the object lock */
+	GByteArray *scanned;	/* decoded, on its way through the gate */
+	gboolean multidrop;
+	struct multidrop multidrop_unpacker;	/* protected by the object lock */
+	char *address_filter;	/* as set */
+	GByteArray *held;	/* read, from where a frame for the next buffer begins */
+	gboolean mark_errors;
+	struct parmrk parmrk;	/* protected by the object lock */
+	GArray *error_offsets;	/* guint, in the buffer being filled */
+	guint64 error_buffers;
 };
 
 typedef struct _GstUartSrcPrivate GstUartSrcPrivate;
@@ -77,14 +243,26 @@ static void gst_uart_src_set_property(GObject * object, guint prop_id,
 static void gst_uart_src_get_property(GObject * object, guint prop_id, GValue * value,
 				      GParamSpec * pspec);
 static void gst_uart_src_dispose(GObject * obj);
+static void gst_uart_src_finalize(GObject * obj);
+static GstStateChangeReturn gst_uart_src_change_state(GstElement * element,
+						      GstStateChange transition);
 static gboolean gst_uart_src_start(GstBaseSrc *basesrc);
 static gboolean gst_uart_src_stop(GstBaseSrc *basesrc);
 static gboolean gst_uart_src_unlock(GstBaseSrc *basesrc);
 static gboolean gst_uart_src_unlock_stop(GstBaseSrc *basesrc);
 static GstFlowReturn gst_uart_src_fill(GstPushSrc * pushsrc, GstBuffer * buffer);
+static void gst_uart_src_reset_overruns(GstUartSrc * uartsrc);
+static void gst_uart_src_unpin(GstUartSrc * uartsrc);
+static void gst_uart_src_pps_start(GstUartSrc * uartsrc);
+static void gst_uart_src_pps_stop(GstUartSrc * uartsrc);
+static void gst_uart_src_lines_start(GstUartSrc * uartsrc);
+static void gst_uart_src_lines_stop(GstUartSrc * uartsrc);
 static gboolean gst_uart_src_event(GstBaseSrc *src, GstEvent *event);
-
-gboolean (*base_event) (GstBaseSrc *src, GstEvent *event);
+static GstClock *gst_uart_src_provide_clock(GstElement * element);
+static gboolean gst_uart_src_post_message(GstElement * element, GstMessage * message);
+static GstCaps *gst_uart_src_get_caps(GstBaseSrc * basesrc, GstCaps * filter);
+static GstCaps *gst_uart_src_fixate(GstBaseSrc * basesrc, GstCaps * caps);
+static gboolean gst_uart_src_set_caps(GstBaseSrc * basesrc, GstCaps * caps);
 
 static void
 gst_uart_src_class_init(GstUartSrcClass * klass)
@@ -102,18 +280,25 @@ gst_uart_src_class_init(GstUartSrcClass * klass)
 	gobject_class->set_property = gst_uart_src_set_property;
 	gobject_class->get_property = gst_uart_src_get_property;
 	gobject_class->dispose = gst_uart_src_dispose;
+	gobject_class->finalize = gst_uart_src_finalize;
 
 	gst_element_class_set_static_metadata(gstelement_class, "UART Source", "Src/UART",
 					      "Read data from a uart / tty",
 					      "Yasushi SHOJI <yashi@spacecubics.com>");
 	gst_element_class_add_static_pad_template(gstelement_class, &srctemplate);
 
+	gstelement_class->provide_clock = GST_DEBUG_FUNCPTR(gst_uart_src_provide_clock);
+	gstelement_class->change_state = GST_DEBUG_FUNCPTR(gst_uart_src_change_state);
+	gstelement_class->post_message = GST_DEBUG_FUNCPTR(gst_uart_src_post_message);
+
 	gstbasesrc_class->start = GST_DEBUG_FUNCPTR(gst_uart_src_start);
 	gstbasesrc_class->stop = GST_DEBUG_FUNCPTR(gst_uart_src_stop);
 	gstbasesrc_class->unlock = GST_DEBUG_FUNCPTR(gst_uart_src_unlock);
 	gstbasesrc_class->unlock_stop = GST_DEBUG_FUNCPTR(gst_uart_src_unlock_stop);
-	base_event = gstbasesrc_class->event;
 	gstbasesrc_class->event = GST_DEBUG_FUNCPTR(gst_uart_src_event);
+	gstbasesrc_class->get_caps = GST_DEBUG_FUNCPTR(gst_uart_src_get_caps);
+	gstbasesrc_class->fixate = GST_DEBUG_FUNCPTR(gst_uart_src_fixate);
+	gstbasesrc_class->set_caps = GST_DEBUG_FUNCPTR(gst_uart_src_set_caps);
 
 	gstpushsrc_class->fill = GST_DEBUG_FUNCPTR(gst_uart_src_fill);
 
@@ -125,13 +310,15 @@ gst_uart_src_class_init(GstUartSrcClass * klass)
 	g_object_class_install_property(gobject_class, ARG_BAUD_RATE,
 					g_param_spec_int("baud-rate", "Baud rate",
 							 "baud rate for the device",
-							 50, 460800, 115200,
-							 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+							 50, 4000000, 115200,
+							 G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							 G_PARAM_STATIC_STRINGS));
 	g_object_class_install_property(gobject_class, ARG_PARITY,
 					g_param_spec_string("parity", "Parity",
 							    "Parity checking for the device",
 							    "no",
-							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+							    G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							    G_PARAM_STATIC_STRINGS));
 	g_object_class_install_property(gobject_class, ARG_BITSWAP,
 					g_param_spec_boolean("bitswap", "Bit Swap",
 							     "Swap bits in a byte",
@@ -147,6 +334,199 @@ gst_uart_src_class_init(GstUartSrcClass * klass)
 							 "In number of packet, likelihood of returning NAK instead of ACK",
 							 0, G_MAXUINT, 0,
 							 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ACKNAK_WINDOW,
+					g_param_spec_uint("acknak-window", "Ack/Nak Window",
+							  "Frames the remote may send ahead; 0 for single byte stop and wait responses",
+							  0, 255, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_AUTO_BAUD,
+					g_param_spec_boolean("auto-baud", "Auto Baud",
+							     "Detect baud rate (and parity, if the driver counts line errors) at start",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_AUTO_BAUD_TIMEOUT,
+					g_param_spec_uint("auto-baud-timeout", "Auto Baud Timeout (msec)",
+							  "Give up detection and use baud-rate after this many milli sec",
+							  1, G_MAXUINT, AUTO_BAUD_DEFAULT_TIMEOUT,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_SYNC_PATTERN,
+					g_param_spec_string("sync-pattern", "Sync Pattern",
+							    "Bytes, in hex, the line must carry for auto-baud to lock (e.g. \"55aa\")",
+							    NULL,
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RECONNECT,
+					g_param_spec_boolean("reconnect", "Reconnect",
+							     "Wait for the device to come back instead of failing when it goes away",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RECONNECT_INTERVAL,
+					g_param_spec_uint("reconnect-interval", "Reconnect Interval (msec)",
+							  "Retry opening a device that went away at least this often",
+							  1, G_MAXUINT, RECONNECT_DEFAULT_INTERVAL,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_SEED,
+					g_param_spec_uint("fault-seed", "Fault Seed",
+							  "Seed for fault injection; the same seed gives the same faults",
+							  0, G_MAXUINT, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_LOSS,
+					g_param_spec_double("fault-loss", "Fault Loss",
+							    "Probability that a burst of lost buffers starts at a buffer",
+							    0.0, 1.0, 0.0,
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_BURST,
+					g_param_spec_uint("fault-burst", "Fault Burst",
+							  "Number of buffers lost in a row",
+							  1, G_MAXUINT, 1,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_CORRUPT,
+					g_param_spec_double("fault-corrupt", "Fault Corrupt",
+							    "Probability that a byte gets a bit flipped",
+							    0.0, 1.0, 0.0,
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_DELAY,
+					g_param_spec_uint("fault-delay", "Fault Delay (usec)",
+							  "Delay each buffer by a random time up to this many micro sec",
+							  0, 10000000, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FAULT_STATS,
+					g_param_spec_boxed("fault-stats", "Fault Stats",
+							   "Dropped buffers, corrupted bytes and delayed buffers so far",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_PPS_LINE,
+					g_param_spec_string("pps-line", "PPS Line",
+							    "Modem line carrying a pulse per second to recover the clock from (none, dcd or cts)",
+							    "none",
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_PROVIDE_CLOCK,
+					g_param_spec_boolean("provide-clock", "Provide Clock",
+							     "Offer the clock recovered from pps-line to the pipeline",
+							     TRUE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_PPS_STATS,
+					g_param_spec_boxed("pps-stats", "PPS Stats",
+							   "State of the clock recovery: locked, period and jitter (ns), pulses and rejected",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_WATCH_LINES,
+					g_param_spec_string("watch-lines", "Watch Lines",
+							    "Modem lines whose changes are sent downstream as events, comma separated (dcd, cts, dsr, ri)",
+							    "",
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_DECOMPRESS,
+					g_param_spec_boolean("decompress", "Decompress",
+							     "Take LZSS compressed blocks, from a uartsink with compress=true",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_DECOMPRESS_STATS,
+					g_param_spec_boxed("decompress-stats", "Decompress Stats",
+							   "Blocks, bytes out and on the wire, their ratio and blocks lost",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FEC,
+					g_param_spec_boolean("fec", "FEC",
+							     "Take Reed-Solomon coded frames, from a uartsink with fec=true",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FEC_STATS,
+					g_param_spec_boxed("fec-stats", "FEC Stats",
+							   "Frames, bytes corrected, frames beyond repair, bytes out and on the wire",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_LOW_LATENCY,
+					g_param_spec_boolean("low-latency", "Low Latency",
+							     "Have the driver hand over data as soon as it comes in "
+							     "(ASYNC_LOW_LATENCY, USB latency timer, FIFO trigger level)",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_LATENCY_SETTINGS,
+					g_param_spec_boxed("latency-settings", "Latency Settings",
+							   "Low latency flag, USB latency timer (msec) and FIFO trigger level "
+							   "(bytes) in effect; -1 where the device has none",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BUSY_POLL,
+					g_param_spec_boolean("busy-poll", "Busy Poll",
+							     "Spin waiting for data instead of sleeping, trading a core for latency",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BUSY_POLL_BUDGET,
+					g_param_spec_uint("busy-poll-budget", "Busy Poll Budget (usec)",
+							  "Longest spin before going to sleep; it shrinks while the line is quiet",
+							  1, 1000000, BUSY_POLL_DEFAULT_BUDGET,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BUSY_POLL_CPU,
+					g_param_spec_int("busy-poll-cpu", "Busy Poll CPU",
+							 "CPU to pin the streaming thread to while busy polling (-1 = don't)",
+							 -1, CPU_SETSIZE - 1, -1,
+							 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BUSY_POLL_STATS,
+					g_param_spec_boxed("busy-poll-stats", "Busy Poll Stats",
+							   "Spins that caught data, sleeps, the spin budget (usec) and a histogram "
+							   "of the time from wake up to push: under 1, 2, 4 ... 1024 usec and above",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_KEEP_OPEN,
+					g_param_spec_boolean("keep-open", "Keep Open",
+							     "Keep the device open and set up from PAUSED to READY, until NULL; "
+							     "what comes in meanwhile waits in the driver",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_TRIGGER,
+					g_param_spec_string("trigger", "Trigger",
+							    "Byte patterns, in hex and comma separated, to post a "
+							    "\"uart-trigger\" message for (e.g. \"55aa,deadbeef\")",
+							    NULL,
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_TRIGGER_PRE,
+					g_param_spec_uint("trigger-pre", "Trigger Pre",
+							  "Bytes before a match trigger-gate lets through",
+							  0, TRIGGER_WINDOW_MAX, TRIGGER_DEFAULT_PRE,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_TRIGGER_POST,
+					g_param_spec_uint("trigger-post", "Trigger Post",
+							  "Bytes after a match trigger-gate lets through",
+							  0, TRIGGER_WINDOW_MAX, TRIGGER_DEFAULT_POST,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_TRIGGER_GATE,
+					g_param_spec_boolean("trigger-gate", "Trigger Gate",
+							     "Push only the bytes around trigger matches and drop the rest",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_TRIGGER_STATS,
+					g_param_spec_boxed("trigger-stats", "Trigger Stats",
+							   "Matches, bytes scanned and bytes let through",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_MULTIDROP,
+					g_param_spec_boolean("multidrop", "Multidrop",
+							     "Take 9-bit multidrop traffic: receive with space parity and "
+							     "PARMRK, and start a buffer at every address byte",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_ADDRESS_FILTER,
+					g_param_spec_string("address-filter", "Address Filter",
+							    "With multidrop, node addresses in hex and comma separated "
+							    "whose frames are pushed (e.g. \"01,7f\"); all if empty",
+							    NULL,
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_MULTIDROP_STATS,
+					g_param_spec_boxed("multidrop-stats", "Multidrop Stats",
+							   "Frames seen, frames pushed and bytes dropped",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_MARK_ERRORS,
+					g_param_spec_boolean("mark-errors", "Mark Errors",
+							     "Have the driver mark bytes with a parity or framing error "
+							     "(PARMRK) and list them in a GstUartErrorMeta on the buffer",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_MARK_ERRORS_STATS,
+					g_param_spec_boxed("mark-errors-stats", "Mark Errors Stats",
+							   "Bytes with an error and buffers with any",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
 }
 
 static void
@@ -156,17 +536,103 @@ gst_uart_src_init(GstUartSrc * uartsrc)
 	priv->device = NULL;
 	priv->baud_rate = 115200;
 	priv->parity = UART_PARITY_NO;
+	priv->reconfigure = FALSE;
 	priv->bitswap = FALSE;
 	priv->acknak = FALSE;
 	priv->nak_probability = 0;
+	priv->acknak_window = 0;
+	priv->auto_baud = FALSE;
+	priv->auto_baud_timeout = AUTO_BAUD_DEFAULT_TIMEOUT;
+	priv->sync_pattern = NULL;
+	priv->auto_baud_done = FALSE;
+	priv->reconnect = FALSE;
+	fault_init(&priv->fault);
+	priv->reconnect_interval = RECONNECT_DEFAULT_INTERVAL;
+	priv->count_overruns = FALSE;
+	priv->overruns = 0;
+	priv->started = FALSE;
+	priv->discont = FALSE;
+	priv->lost_at = GST_CLOCK_TIME_NONE;
+	priv->conn.lost_since = 0;
 	priv->uart = NULL;
 	priv->fdset_read = NULL;
 	priv->fdset_write = NULL;
+	priv->fdset_wait = NULL;
+	priv->acknak_count = 1;
+	priv->acknak_seq = 0;
+	priv->framing = FRAMING_STREAM;
+	priv->pps_line = 0;
+	priv->provide_clock = TRUE;
+	priv->pps_monitor = NULL;
+	pps_reset(&priv->pps);
+	priv->clock = g_object_new(GST_TYPE_SYSTEM_CLOCK, "name", "uartclock",
+				   "clock-type", GST_CLOCK_TYPE_MONOTONIC, NULL);
+	gst_object_ref_sink(priv->clock);
+	priv->clock_epoch = 0;
+	priv->clock_epoch_time = 0;
+	priv->arrival = GST_CLOCK_TIME_NONE;
+	priv->watch_lines = 0;
+	priv->line_monitor = NULL;
+	priv->line_pipe[0] = -1;
+	priv->line_pipe[1] = -1;
+	priv->wake[0] = -1;
+	priv->wake[1] = -1;
+	priv->lines = -1;
+	priv->decompress = FALSE;
+	lzss_unpacker_init(&priv->unpacker);
+	priv->fec = FALSE;
+	rs_unpacker_init(&priv->fec_unpacker);
+	priv->corrected = g_byte_array_new();
+	priv->decoded = g_byte_array_new();
+	priv->low_latency = FALSE;
+	priv->busy_poll = FALSE;
+	priv->busy_poll_budget = BUSY_POLL_DEFAULT_BUDGET;
+	priv->busy_poll_cpu = -1;
+	priv->pinned = FALSE;
+	priv->unpin = FALSE;
+	priv->spin = BUSY_POLL_DEFAULT_BUDGET * GST_USECOND;
+	priv->spin_hits = 0;
+	priv->spin_misses = 0;
+	memset(priv->wake_to_push, 0, sizeof(priv->wake_to_push));
+	priv->keep_open = FALSE;
+	priv->kept_device = NULL;
+	priv->trigger_patterns = NULL;
+	priv->triggering = FALSE;
+	trigger_init(&priv->trigger);
+	priv->trigger.pre = TRIGGER_DEFAULT_PRE;
+	priv->trigger.post = TRIGGER_DEFAULT_POST;
+	ac_compile(&priv->trigger.ac);
+	priv->trigger_hits = g_array_new(FALSE, FALSE, sizeof(struct trigger_hit));
+	priv->scanned = g_byte_array_new();
+	priv->multidrop = FALSE;
+	multidrop_init(&priv->multidrop_unpacker);
+	priv->address_filter = NULL;
+	priv->held = g_byte_array_new();
+	priv->mark_errors = FALSE;
+	parmrk_init(&priv->parmrk);
+	priv->error_offsets = g_array_new(FALSE, FALSE, sizeof(guint));
+	priv->error_buffers = 0;
 
 	gst_base_src_set_live (GST_BASE_SRC (uartsrc), FALSE);
 	gst_base_src_set_do_timestamp (GST_BASE_SRC (uartsrc), TRUE);
 }
 
+/* the device keep-open left open; for good, or it is another one now */
+static void
+gst_uart_src_close_kept(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+
+	if (!priv->kept_device)
+		return;
+	GST_DEBUG_OBJECT(uartsrc, "closing \"%s\" kept open", priv->kept_device);
+	if (priv->uart) {
+		uart_close(priv->uart);
+		priv->uart = NULL;
+	}
+	g_clear_pointer(&priv->kept_device, g_free);
+}
+
 static void
 gst_uart_src_dispose(GObject * obj)
 {
@@ -176,18 +642,111 @@ gst_uart_src_dispose(GObject * obj)
 		g_free(priv->device);
 		priv->device = NULL;
 	}
+	if (priv->clock) {
+		gst_object_unref(priv->clock);
+		priv->clock = NULL;
+	}
+	gst_uart_src_close_kept(GST_UART_SRC(obj));
 
 	G_OBJECT_CLASS(gst_uart_src_parent_class)->dispose(obj);
 }
 
+static void
+gst_uart_src_finalize(GObject * obj)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(GST_UART_SRC(obj));
+
+	g_clear_pointer(&priv->sync_pattern, g_byte_array_unref);
+	fault_clear(&priv->fault);
+	lzss_unpacker_clear(&priv->unpacker);
+	rs_unpacker_clear(&priv->fec_unpacker);
+	g_clear_pointer(&priv->corrected, g_byte_array_unref);
+	g_clear_pointer(&priv->decoded, g_byte_array_unref);
+	g_clear_pointer(&priv->trigger_patterns, g_free);
+	trigger_clear(&priv->trigger);
+	g_clear_pointer(&priv->trigger_hits, g_array_unref);
+	g_clear_pointer(&priv->scanned, g_byte_array_unref);
+	g_clear_pointer(&priv->address_filter, g_free);
+	g_clear_pointer(&priv->held, g_byte_array_unref);
+	g_clear_pointer(&priv->error_offsets, g_array_unref);
+
+	G_OBJECT_CLASS(gst_uart_src_parent_class)->finalize(obj);
+}
+
+static GstStateChangeReturn
+gst_uart_src_change_state(GstElement * element, GstStateChange transition)
+{
+	GstStateChangeReturn ret;
+
+	ret = GST_ELEMENT_CLASS(gst_uart_src_parent_class)->change_state(element, transition);
+	if (transition == GST_STATE_CHANGE_READY_TO_NULL)
+		gst_uart_src_close_kept(GST_UART_SRC(element));
+
+	return ret;
+}
+
+/* low-latency: every knob the driver has all the way down */
+static void
+gst_uart_src_apply_latency(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	struct uart_latency latency;
+
+	if (!priv->low_latency)
+		return;
+	if (uart_set_low_latency(priv->uart, TRUE) < 0 && errno != ENOTTY)
+		GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+				    ("Could not lower the latency of \"%s\".", priv->device),
+				    GST_ERROR_SYSTEM);
+	if (uart_get_latency(priv->uart, &latency) == 0)
+		GST_INFO_OBJECT(uartsrc, "low latency %d, latency timer %d msec, rx trigger %d bytes",
+				latency.low_latency, latency.latency_timer, latency.rx_trig_bytes);
+}
+
+/* the port setup the properties ask for; called with the object lock */
+static void
+gst_uart_src_get_config(GstUartSrc * uartsrc, struct uart_config *config)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+
+	config->baud_rate = priv->baud_rate;
+	config->parity = priv->multidrop ? UART_PARITY_SPACE : priv->parity;
+	config->mark_errors = priv->multidrop || priv->mark_errors;
+}
+
+/* get fill() to look at the settings again; called with the object lock */
+static void
+gst_uart_src_wake(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	guint8 c = 0;
+
+	if (priv->wake[1] >= 0 && write(priv->wake[1], &c, 1) < 0 && errno != EAGAIN)
+		GST_WARNING_OBJECT(uartsrc, "cannot wake fill(): %s", g_strerror(errno));
+}
+
+/* TRUE if we were woken up since the last call */
+static gboolean
+gst_uart_src_woken(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	guint8 buf[16];
+	gboolean woken = FALSE;
+
+	while (read(priv->wake[0], buf, sizeof(buf)) > 0)
+		woken = TRUE;
+
+	return woken;
+}
+
 static gboolean
 gst_uart_src_start(GstBaseSrc *basesrc)
 {
 	GstUartSrc *uartsrc;
 	GstUartSrcPrivate *priv;
 	GstPollFD fd = GST_POLL_FD_INIT;
+	struct uart_config config;
 	GError *error = NULL;
-	int ret;
 
 	uartsrc = GST_UART_SRC(basesrc);
 	priv = gst_uart_src_get_instance_private(uartsrc);
@@ -195,9 +754,17 @@ gst_uart_src_start(GstBaseSrc *basesrc)
 	if (!priv->device || priv->device[0] == '\0')
 		goto no_device;
 
-	priv->uart = uart_open_raw(priv->device, O_RDWR);
-	if (!priv->uart)
-		goto open_failed;
+	if (g_strcmp0(priv->kept_device, priv->device))
+		gst_uart_src_close_kept(uartsrc);
+	if (priv->kept_device) {
+		GST_INFO_OBJECT(uartsrc, "\"%s\" is still open", priv->device);
+		g_clear_pointer(&priv->kept_device, g_free);
+	}
+	else {
+		priv->uart = uart_open(priv->device, O_RDWR);
+		if (!priv->uart)
+			goto open_failed;
+	}
 
 	GST_DEBUG_OBJECT(uartsrc, "opened %s as fd %d",
 			 priv->device,
@@ -218,13 +785,19 @@ gst_uart_src_start(GstBaseSrc *basesrc)
 	GST_DEBUG("ospeed: %d", priv->uart->current.c_ospeed);
 	GST_DEBUG("priv->baud_rate: %d", priv->baud_rate);
 
-	ret = uart_set_baud_rate(priv->uart, priv->baud_rate, &error);
-	if (error)
+	/* uart_open() flushed already; a kept one holds what came in since */
+	GST_OBJECT_LOCK(uartsrc);
+	gst_uart_src_get_config(uartsrc, &config);
+	GST_OBJECT_UNLOCK(uartsrc);
+	if (uart_configure(priv->uart, &config, TCSANOW, &error) < 0)
 		goto setting_failed;
-	GST_DEBUG("ret: %d", ret);
 	GST_DEBUG("baud rate: %d", priv->baud_rate);
 
-	uart_set_parity(priv->uart, priv->parity);
+	priv->reconfigure = FALSE;
+	priv->auto_baud_done = FALSE;
+	priv->started = FALSE;
+	priv->discont = FALSE;
+	gst_uart_src_reset_overruns(uartsrc);
 
 	GST_DEBUG("== after set parity ==");
 	GST_DEBUG("c_iflag: 0x%x", priv->uart->current.c_iflag);
@@ -253,6 +826,56 @@ gst_uart_src_start(GstBaseSrc *basesrc)
 	gst_poll_add_fd(priv->fdset_write, &fd);
 	gst_poll_fd_ctl_write(priv->fdset_write, &fd, TRUE);
 
+	/* no fd; used as a flushable sleep */
+	priv->fdset_wait = gst_poll_new(TRUE);
+	if (!priv->fdset_wait)
+		goto poll_failed;
+
+	/* settings changed while we wait for data */
+	if (pipe2(priv->wake, O_CLOEXEC | O_NONBLOCK) < 0)
+		goto poll_failed;
+	fd.fd = priv->wake[0];
+	gst_poll_add_fd(priv->fdset_read, &fd);
+	gst_poll_fd_ctl_read(priv->fdset_read, &fd, TRUE);
+
+	/* modem line changes from the monitor thread */
+	priv->lines = -1;
+	if (priv->watch_lines) {
+		if (pipe2(priv->line_pipe, O_CLOEXEC | O_NONBLOCK) < 0)
+			goto poll_failed;
+		fd.fd = priv->line_pipe[0];
+		gst_poll_add_fd(priv->fdset_read, &fd);
+		gst_poll_fd_ctl_read(priv->fdset_read, &fd, TRUE);
+	}
+
+	priv->acknak_count = 1;
+	priv->acknak_seq = 0;
+	fault_reset(&priv->fault);
+	GST_OBJECT_LOCK(uartsrc);
+	lzss_unpacker_reset(&priv->unpacker);
+	rs_unpacker_reset(&priv->fec_unpacker);
+	trigger_reset(&priv->trigger);
+	multidrop_reset(&priv->multidrop_unpacker);
+	parmrk_reset(&priv->parmrk);
+	priv->error_buffers = 0;
+	GST_OBJECT_UNLOCK(uartsrc);
+	g_byte_array_set_size(priv->decoded, 0);
+	g_byte_array_set_size(priv->held, 0);
+	g_array_set_size(priv->error_offsets, 0);
+
+	gst_uart_src_apply_latency(uartsrc);
+	priv->pinned = FALSE;
+	priv->spin = priv->busy_poll_budget * GST_USECOND;
+	priv->spin_hits = 0;
+	priv->spin_misses = 0;
+	memset(priv->wake_to_push, 0, sizeof(priv->wake_to_push));
+
+	/* with a PPS, we timestamp ourselves */
+	gst_base_src_set_do_timestamp(basesrc, !priv->pps_line);
+	priv->arrival = GST_CLOCK_TIME_NONE;
+	gst_uart_src_pps_start(uartsrc);
+	gst_uart_src_lines_start(uartsrc);
+
 	return TRUE;
 
 no_device:
@@ -272,14 +895,15 @@ setting_failed:
 	{
 		GST_ELEMENT_ERROR(uartsrc, RESOURCE, SETTINGS,
 				  ("%s", error->message), GST_ERROR_SYSTEM);
-		g_close(priv->uart->fd, NULL);
-		priv->uart->fd = -1;
+		g_clear_error(&error);
+		uart_close(priv->uart);
+		priv->uart = NULL;
 		return FALSE;
 	}
 poll_failed:
 	{
-		g_close(priv->uart->fd, NULL);
-		priv->uart->fd = -1;
+		uart_close(priv->uart);
+		priv->uart = NULL;
 		GST_ELEMENT_ERROR(uartsrc, RESOURCE, OPEN_READ_WRITE, (NULL),
 				  GST_ERROR_SYSTEM);
 		return FALSE;
@@ -298,20 +922,52 @@ gst_uart_src_stop(GstBaseSrc *basesrc)
 
 	GST_DEBUG_OBJECT(uartsrc, "%s", __func__);
 
+	gst_uart_src_pps_stop(uartsrc);
+	gst_uart_src_lines_stop(uartsrc);
 	if (priv->uart) {
-		GST_DEBUG("%s: close", __func__);
 		gst_poll_fd_init(&fd);
 		fd.fd = priv->uart->fd;
 		gst_poll_remove_fd(priv->fdset_read, &fd);
 		gst_poll_remove_fd(priv->fdset_write, &fd);
 
-		uart_close(priv->uart);
-		priv->uart = NULL;
-
+		if (priv->keep_open) {
+			GST_DEBUG("%s: keeping \"%s\" open", __func__, priv->device);
+			priv->kept_device = g_strdup(priv->device);
+		}
+		else {
+			GST_DEBUG("%s: close", __func__);
+			uart_close(priv->uart);
+			priv->uart = NULL;
+		}
+	}
+	if (priv->line_pipe[0] >= 0) {
+		gst_poll_fd_init(&fd);
+		fd.fd = priv->line_pipe[0];
+		gst_poll_remove_fd(priv->fdset_read, &fd);
+		close(priv->line_pipe[0]);
+		close(priv->line_pipe[1]);
+		priv->line_pipe[0] = -1;
+		priv->line_pipe[1] = -1;
+	}
+	if (priv->wake[0] >= 0) {
+		gst_poll_fd_init(&fd);
+		fd.fd = priv->wake[0];
+		gst_poll_remove_fd(priv->fdset_read, &fd);
+		GST_OBJECT_LOCK(uartsrc);
+		close(priv->wake[0]);
+		close(priv->wake[1]);
+		priv->wake[0] = -1;
+		priv->wake[1] = -1;
+		GST_OBJECT_UNLOCK(uartsrc);
+	}
+	/* the device may be gone while we wait for it to come back */
+	if (priv->fdset_read) {
 		gst_poll_free(priv->fdset_read);
 		gst_poll_free(priv->fdset_write);
+		gst_poll_free(priv->fdset_wait);
 		priv->fdset_read = NULL;
 		priv->fdset_write = NULL;
+		priv->fdset_wait = NULL;
 	}
 
 	return TRUE;
@@ -330,6 +986,7 @@ gst_uart_src_unlock(GstBaseSrc *basesrc)
 
 	gst_poll_set_flushing(priv->fdset_read, TRUE);
 	gst_poll_set_flushing(priv->fdset_write, TRUE);
+	gst_poll_set_flushing(priv->fdset_wait, TRUE);
 
 	return TRUE;
 }
@@ -347,167 +1004,1874 @@ gst_uart_src_unlock_stop(GstBaseSrc *basesrc)
 
 	gst_poll_set_flushing(priv->fdset_read, FALSE);
 	gst_poll_set_flushing(priv->fdset_write, FALSE);
+	gst_poll_set_flushing(priv->fdset_wait, FALSE);
 
 	return TRUE;
 }
 
-static GstFlowReturn
-gst_uart_src_fill(GstPushSrc * pushsrc, GstBuffer * buffer)
+/* "55aa" -> { 0x55, 0xaa }; NULL if malformed, empty or longer than max */
+static GByteArray *
+parse_hex(const char *s, gsize max)
 {
-	GstUartSrc *uartsrc;
-	GstUartSrcPrivate *priv;
-	GstMapInfo info;
-	gsize size;
-	ssize_t red;
-	gsize max;
+	GByteArray *bytes;
+	gsize len = strlen(s);
+	gsize i;
+
+	if (len % 2 || len == 0 || len / 2 > max)
+		return NULL;
+
+	bytes = g_byte_array_sized_new(len / 2);
+	for (i = 0; i < len; i += 2) {
+		int hi = g_ascii_xdigit_value(s[i]);
+		int lo = g_ascii_xdigit_value(s[i + 1]);
+		guint8 c;
+
+		if (hi < 0 || lo < 0) {
+			g_byte_array_unref(bytes);
+			return NULL;
+		}
+		c = hi << 4 | lo;
+		g_byte_array_append(bytes, &c, 1);
+	}
+
+	return bytes;
+}
+
+struct auto_baud_trial {
+	int baud_rate;
+	enum UartParity parity;
+	gsize bytes;
+	guint errors;
+	gboolean counted;	/* errors is meaningful */
+	gboolean synced;	/* sync pattern seen */
+};
+
+static gboolean
+contains(const guint8 * data, gsize size, const guint8 * pattern, gsize len)
+{
+	gsize i;
+
+	for (i = 0; i + len <= size; i++)
+		if (memcmp(data + i, pattern, len) == 0)
+			return TRUE;
+
+	return FALSE;
+}
+
+/*
+ * Listen to the line at one setting for about AUTO_BAUD_SAMPLE
+ * characters.  Returns FALSE if we got flushed meanwhile.
+ */
+static gboolean
+gst_uart_src_auto_baud_sample(GstUartSrc * uartsrc, GstClockTime deadline,
+			      struct auto_baud_trial *trial)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
 	GstPollFD fd = GST_POLL_FD_INIT;
+	struct uart_icount before, after;
+	guint8 sample[AUTO_BAUD_SAMPLE];
+	GstClockTime now, end;
+	gsize got = 0;
+	ssize_t red;
 	gint ret;
 
-	uartsrc = GST_UART_SRC(pushsrc);
-	priv = gst_uart_src_get_instance_private(uartsrc);
-
-	size = gst_buffer_get_sizes(buffer, NULL, &max);
+	trial->bytes = 0;
+	trial->errors = 0;
+	trial->counted = FALSE;
+	trial->synced = FALSE;
 
-	GST_DEBUG_OBJECT(uartsrc, "given buffer's size (%" G_GSIZE_FORMAT ") and max size (%" G_GSIZE_FORMAT ")",
-			 size, max);
+	/* TCSAFLUSH; what came in at the previous setting is garbage */
+	if (uart_set_baud_rate(priv->uart, trial->baud_rate, TCSAFLUSH, NULL) < 0 ||
+	    uart_set_parity(priv->uart, trial->parity, TCSAFLUSH) < 0)
+		return TRUE;
+	trial->counted = uart_get_icount(priv->uart, &before) == 0;
 
-	ret = gst_poll_wait(priv->fdset_read, GST_CLOCK_TIME_NONE);
-	GST_DEBUG_OBJECT(uartsrc, "gst_poll_wait() returned %d", ret);
-	if (ret < 0)
-		return GST_FLOW_FLUSHING;
+	now = g_get_monotonic_time() * GST_USECOND;
+	end = now + MAX(uart_wire_time(priv->uart, AUTO_BAUD_SAMPLE), AUTO_BAUD_MIN_DWELL);
+	end = MIN(end, deadline);
 
 	fd.fd = priv->uart->fd;
-	if (gst_poll_fd_can_read(priv->fdset_read, &fd)) {
-		gst_buffer_map(buffer, &info, GST_MAP_WRITE);
-		red = read(priv->uart->fd, info.data, size);
+	while (got < sizeof(sample) && now < end) {
+		ret = gst_poll_wait(priv->fdset_read, end - now);
+		if (ret < 0 && errno == EBUSY)
+			return FALSE;
+		if (ret < 0 && errno != EINTR && errno != EAGAIN)
+			break;
+		/* a new setting waits for the outcome */
+		if (ret > 0)
+			gst_uart_src_woken(uartsrc);
+		if (ret > 0 && gst_poll_fd_can_read(priv->fdset_read, &fd)) {
+			red = read(priv->uart->fd, sample + got, sizeof(sample) - got);
+			if (red > 0)
+				got += red;
+		}
+		now = g_get_monotonic_time() * GST_USECOND;
+	}
+
+	trial->bytes = got;
+	if (trial->counted && uart_get_icount(priv->uart, &after) == 0)
+		trial->errors = (after.frame - before.frame) + (after.parity - before.parity) +
+			(after.brk - before.brk);
+	else
+		trial->counted = FALSE;
+
+	if (priv->sync_pattern) {
 		if (priv->bitswap)
-			bitswap(info.data, size);
-		GST_DEBUG_OBJECT(uartsrc, "the first byte %x", *info.data);
-		gst_buffer_unmap(buffer, &info);
-		gst_buffer_set_size(buffer, red);
-		GST_DEBUG_OBJECT(uartsrc, "read %zu bytes from \"%s\" (%d)", red, priv->device, priv->uart->fd);
-		GST_DEBUG_OBJECT(uartsrc, "%" GST_PTR_FORMAT, buffer);
+			bitswap(sample, got);
+		trial->synced = contains(sample, got, priv->sync_pattern->data,
+					 priv->sync_pattern->len);
 	}
 
-	return GST_FLOW_OK;
+	GST_DEBUG_OBJECT(uartsrc, "%d baud, %s parity: %" G_GSIZE_FORMAT " bytes, %u errors%s",
+			 trial->baud_rate, uart_parity_to_string(trial->parity), trial->bytes, trial->errors,
+			 trial->synced ? ", synced" : "");
+
+	return TRUE;
 }
 
-static void
-gst_uart_src_set_property(GObject * object, guint prop_id, const GValue * value,
-			   GParamSpec * pspec)
+static gboolean
+gst_uart_src_auto_baud_accept(GstUartSrc * uartsrc, const struct auto_baud_trial *trial)
 {
-	GstUartSrc *uartsrc;
-	GstUartSrcPrivate *priv;
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
 
-	uartsrc = GST_UART_SRC(object);
-	priv = gst_uart_src_get_instance_private(uartsrc);
+	if (trial->bytes == 0)
+		return FALSE;
+	if (priv->sync_pattern && !trial->synced)
+		return FALSE;
+	/* a little noise is fine; a wrong rate breaks nearly every character */
+	if (trial->counted)
+		return trial->errors * 32 <= trial->bytes;
 
-	switch (prop_id) {
-	case ARG_DEVICE:
-		priv->device = g_value_dup_string(value);
-		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), priv->device);
-		break;
+	return priv->sync_pattern != NULL;
+}
 
-	case ARG_BAUD_RATE:
-		priv->baud_rate = g_value_get_int(value);
-		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->baud_rate);
-		break;
+/*
+ * Try the candidate settings in turn until one receives clean data (and
+ * the sync pattern, if set), or auto-baud-timeout runs out, in which
+ * case baud-rate and parity are used as configured.  Either way the
+ * outcome is posted as a "uart-auto-baud" element message.  Returns
+ * FALSE if we got flushed.
+ */
+static gboolean
+gst_uart_src_auto_baud(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	struct auto_baud_trial trial = { 0, };
+	struct uart_icount icount;
+	GstClockTime start, deadline;
+	GstStructure *s;
+	GError *error = NULL;
+	gboolean locked = FALSE;
+	guint n_parities;
+	guint i, j;
+
+	priv->auto_baud_done = TRUE;
+
+	/* without error counts, parity can't be told and only the pattern can tell the rate */
+	n_parities = uart_get_icount(priv->uart, &icount) == 0 ? G_N_ELEMENTS(auto_baud_parities) : 1;
+	if (n_parities == 1 && !priv->sync_pattern) {
+		GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+				    ("Can not detect the baud rate of \"%s\" without a sync-pattern.", priv->device),
+				    ("the driver does not count line errors"));
+		return TRUE;
+	}
 
-	case ARG_PARITY:
-	{
-		const char *s = g_value_get_string(value);
-		if (g_str_equal(s, "no"))
-			priv->parity = UART_PARITY_NO;
-		else if (g_str_equal(s, "even"))
-			priv->parity = UART_PARITY_EVEN;
-		else if (g_str_equal(s, "odd"))
-			priv->parity = UART_PARITY_ODD;
+	start = g_get_monotonic_time() * GST_USECOND;
+	deadline = start + priv->auto_baud_timeout * GST_MSECOND;
+
+	while (!locked && g_get_monotonic_time() * GST_USECOND < deadline) {
+		for (i = 0; !locked && i < G_N_ELEMENTS(auto_baud_rates); i++) {
+			for (j = 0; !locked && j < n_parities; j++) {
+				trial.baud_rate = auto_baud_rates[i];
+				trial.parity = n_parities == 1 ? priv->parity : auto_baud_parities[j];
+				if (!gst_uart_src_auto_baud_sample(uartsrc, deadline, &trial))
+					return FALSE;
+				locked = gst_uart_src_auto_baud_accept(uartsrc, &trial);
+			}
+		}
+	}
 
-		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
-		break;
+	if (locked) {
+		GST_INFO_OBJECT(uartsrc, "locked to %d baud, %s parity", trial.baud_rate,
+				uart_parity_to_string(trial.parity));
+		GST_OBJECT_LOCK(uartsrc);
+		priv->baud_rate = trial.baud_rate;
+		priv->parity = trial.parity;
+		GST_OBJECT_UNLOCK(uartsrc);
+		gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(uartsrc));
+		/* drop the sample and whatever came in after it */
+		if (uart_set_parity(priv->uart, trial.parity, TCSAFLUSH) < 0)
+			GST_WARNING_OBJECT(uartsrc, "could not flush the sample: %s", g_strerror(errno));
+	}
+	else {
+		GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+				    ("Could not detect the baud rate of \"%s\".", priv->device),
+				    ("falling back to %d baud, %s parity", priv->baud_rate,
+				     uart_parity_to_string(priv->parity)));
+		if (uart_set_baud_rate(priv->uart, priv->baud_rate, TCSAFLUSH, &error) < 0) {
+			GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS, ("%s", error->message), (NULL));
+			g_clear_error(&error);
+		}
+		else if (uart_set_parity(priv->uart, priv->parity, TCSAFLUSH) < 0) {
+			GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+					    ("Could not set parity: %s", g_strerror(errno)), (NULL));
+		}
 	}
-	case ARG_BITSWAP:
-		priv->bitswap = g_value_get_boolean(value);
-		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->bitswap);
-		break;
 
-	case ARG_ACKNAK:
-		priv->acknak = g_value_get_boolean(value);
-		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->acknak);
-		break;
+	s = gst_structure_new("uart-auto-baud",
+			      "locked", G_TYPE_BOOLEAN, locked,
+			      "baud-rate", G_TYPE_INT, uart_termios_baud_rate(&priv->uart->current),
+			      "parity", G_TYPE_STRING, uart_parity_to_string(uart_get_parity(priv->uart)),
+			      "bytes", G_TYPE_UINT, (guint)trial.bytes,
+			      "errors", G_TYPE_UINT, trial.errors,
+			      "elapsed", G_TYPE_UINT64, g_get_monotonic_time() * GST_USECOND - start,
+			      NULL);
+	gst_element_post_message(GST_ELEMENT(uartsrc),
+				 gst_message_new_element(GST_OBJECT(uartsrc), s));
 
-	case ARG_NAK_PROBABILITY:
-		priv->nak_probability = g_value_get_uint(value);
-		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->nak_probability);
-		break;
+	return TRUE;
+}
 
-	default:
-		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
-		break;
+static GstClockTime
+gst_uart_src_running_time(GstUartSrc * uartsrc)
+{
+	GstClockTime running_time = GST_CLOCK_TIME_NONE;
+	GstClock *clock;
+
+	clock = gst_element_get_clock(GST_ELEMENT(uartsrc));
+	if (clock) {
+		GstClockTime now = gst_clock_get_time(clock);
+		GstClockTime base_time = gst_element_get_base_time(GST_ELEMENT(uartsrc));
+
+		if (now >= base_time)
+			running_time = now - base_time;
+		gst_object_unref(clock);
 	}
+
+	return running_time;
 }
 
 static void
-gst_uart_src_get_property(GObject * object, guint prop_id, GValue * value,
-			   GParamSpec * pspec)
+gst_uart_src_post_pps(GstUartSrc * uartsrc, gboolean locked, gdouble period, gdouble jitter)
 {
-	GstUartSrc *uartsrc;
-	GstUartSrcPrivate *priv;
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstStructure *s;
+
+	s = gst_structure_new("uart-pps",
+			      "device", G_TYPE_STRING, priv->device,
+			      "locked", G_TYPE_BOOLEAN, locked,
+			      "period", G_TYPE_DOUBLE, period,
+			      "jitter", G_TYPE_DOUBLE, jitter,
+			      NULL);
+	gst_element_post_message(GST_ELEMENT(uartsrc),
+				 gst_message_new_element(GST_OBJECT(uartsrc), s));
+}
 
-	uartsrc = GST_UART_SRC(object);
-	priv = gst_uart_src_get_instance_private(uartsrc);
+static void
+gst_uart_src_update_clock_flag(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
 
-	switch (prop_id) {
-	case ARG_DEVICE:
-		g_value_set_string(value, priv->device);
-		break;
+	GST_OBJECT_LOCK(uartsrc);
+	if (priv->pps_line && priv->provide_clock)
+		GST_OBJECT_FLAG_SET(uartsrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
+	else
+		GST_OBJECT_FLAG_UNSET(uartsrc, GST_ELEMENT_FLAG_PROVIDE_CLOCK);
+	GST_OBJECT_UNLOCK(uartsrc);
+}
 
-	case ARG_BAUD_RATE:
-		g_value_set_int(value, priv->baud_rate);
-		break;
+static GstClock *
+gst_uart_src_provide_clock(GstElement * element)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(GST_UART_SRC(element));
 
-	case ARG_PARITY:
-		switch (priv->parity) {
-		default:
-			g_value_set_string(value, "no");
-			break;
-		case UART_PARITY_EVEN:
-			g_value_set_string(value, "even");
-			break;
-		case UART_PARITY_ODD:
-			g_value_set_string(value, "odd");
-			break;
-		}
-		break;
+	if (!priv->pps_line || !priv->provide_clock)
+		return NULL;
 
-	case ARG_BITSWAP:
-		g_value_set_boolean(value, priv->bitswap);
-		break;
+	return gst_object_ref(priv->clock);
+}
 
-	case ARG_ACKNAK:
-		g_value_set_boolean(value, priv->acknak);
-		break;
+/* the streaming thread posts its own leave; give back what we pinned */
+static gboolean
+gst_uart_src_post_message(GstElement * element, GstMessage * message)
+{
+	GstUartSrc *uartsrc = GST_UART_SRC(element);
 
-	case ARG_NAK_PROBABILITY:
-		g_value_set_uint(value, priv->nak_probability);
+	if (GST_MESSAGE_TYPE(message) == GST_MESSAGE_STREAM_STATUS) {
+		GstStreamStatusType type;
+		GstElement *owner;
+
+		gst_message_parse_stream_status(message, &type, &owner);
+		if (type == GST_STREAM_STATUS_TYPE_LEAVE &&
+		    GST_OBJECT(owner) == GST_OBJECT(GST_BASE_SRC_PAD(element)))
+			gst_uart_src_unpin(uartsrc);
+	}
+
+	return GST_ELEMENT_CLASS(gst_uart_src_parent_class)->post_message(element, message);
+}
+
+static GstCaps *
+gst_uart_src_get_caps(GstBaseSrc * basesrc, GstCaps * filter)
+{
+	GstUartSrc *uartsrc = GST_UART_SRC(basesrc);
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstCaps *caps;
+
+	/* the line settings are ours; framing and chunk-size are downstream's pick */
+	caps = gst_caps_make_writable(gst_pad_get_pad_template_caps(GST_BASE_SRC_PAD(basesrc)));
+	GST_OBJECT_LOCK(uartsrc);
+	gst_caps_set_simple(caps,
+			    "baud", G_TYPE_INT, priv->baud_rate,
+			    "parity", G_TYPE_STRING, uart_parity_to_string(priv->parity),
+			    "bitswap", G_TYPE_BOOLEAN, priv->bitswap, NULL);
+	GST_OBJECT_UNLOCK(uartsrc);
+
+	if (filter) {
+		GstCaps *intersection;
+
+		intersection = gst_caps_intersect_full(filter, caps, GST_CAPS_INTERSECT_FIRST);
+		gst_caps_unref(caps);
+		caps = intersection;
+	}
+	GST_DEBUG_OBJECT(uartsrc, "caps %" GST_PTR_FORMAT, caps);
+
+	return caps;
+}
+
+static GstCaps *
+gst_uart_src_fixate(GstBaseSrc * basesrc, GstCaps * caps)
+{
+	GstStructure *s;
+
+	caps = gst_caps_make_writable(caps);
+	s = gst_caps_get_structure(caps, 0);
+	gst_structure_fixate_field_string(s, "framing", framing_names[FRAMING_STREAM]);
+	gst_structure_fixate_field_nearest_int(s, "chunk-size", gst_base_src_get_blocksize(basesrc));
+
+	return GST_BASE_SRC_CLASS(gst_uart_src_parent_class)->fixate(basesrc, caps);
+}
+
+static gboolean
+gst_uart_src_set_caps(GstBaseSrc * basesrc, GstCaps * caps)
+{
+	GstUartSrc *uartsrc = GST_UART_SRC(basesrc);
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstStructure *s = gst_caps_get_structure(caps, 0);
+	const char *framing;
+	int chunk_size;
+	guint i;
+
+	framing = gst_structure_get_string(s, "framing");
+	if (!framing || !gst_structure_get_int(s, "chunk-size", &chunk_size))
+		return FALSE;
+	for (i = 0; i < G_N_ELEMENTS(framing_names); i++)
+		if (g_str_equal(framing, framing_names[i]))
+			break;
+	if (i == G_N_ELEMENTS(framing_names))
+		return FALSE;
+
+	priv->framing = i;
+	gst_base_src_set_blocksize(basesrc, chunk_size);
+	GST_INFO_OBJECT(uartsrc, "%s framing, %d byte chunks", framing, chunk_size);
+
+	return TRUE;
+}
+
+/*
+ * Slave our clock to the PPS: pulse n after the (re)lock is n seconds
+ * after where the clock was at the lock, and between pulses it runs at
+ * the rate the model measured.  The clock was free running up to the
+ * lock, so it does not jump.
+ */
+static void
+gst_uart_src_calibrate(GstUartSrc * uartsrc, GstClockTime edge, guint64 index, gdouble period,
+		       gboolean relock)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstClockTime internal, external, rate_num, rate_denom;
+
+	if (relock) {
+		gst_clock_get_calibration(priv->clock, &internal, &external, &rate_num, &rate_denom);
+		priv->clock_epoch = index;
+		priv->clock_epoch_time = gst_clock_adjust_with_calibration(priv->clock, edge, internal,
+									   external, rate_num, rate_denom);
+	}
+	external = priv->clock_epoch_time + (index - priv->clock_epoch) * GST_SECOND;
+	gst_clock_set_calibration(priv->clock, edge, external, GST_SECOND * 1000,
+				  (GstClockTime)(period * 1000));
+}
+
+/* from the line monitor thread */
+static void
+gst_uart_src_pps_pulse(int lines, guint64 when, gpointer user_data)
+{
+	GstUartSrc *uartsrc = GST_UART_SRC(user_data);
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	gboolean was_locked, locked;
+	GstClockTime edge;
+	guint64 index;
+	gdouble period, jitter;
+
+	if (lines < 0) {
+		GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+				    ("Can not watch the PPS line of \"%s\"; timestamps are not corrected.",
+				     priv->device),
+				    ("%s", g_strerror(-lines)));
+		return;
+	}
+	/* woken up for both edges; the pulse is the assert */
+	if (!(lines & priv->pps_line))
+		return;
+
+	GST_OBJECT_LOCK(uartsrc);
+	was_locked = priv->pps.locked;
+	locked = pps_pulse(&priv->pps, when);
+	edge = priv->pps.edge;
+	index = priv->pps.index;
+	period = priv->pps.period;
+	jitter = priv->pps.jitter;
+	GST_OBJECT_UNLOCK(uartsrc);
+
+	GST_LOG_OBJECT(uartsrc, "pulse at %" GST_TIME_FORMAT ", period %.1f ns, jitter %.1f ns%s",
+		       GST_TIME_ARGS(when), period, jitter, locked ? "" : " (not locked)");
+	if (locked)
+		gst_uart_src_calibrate(uartsrc, edge, index, period, !was_locked);
+	if (locked != was_locked) {
+		GST_INFO_OBJECT(uartsrc, "PPS %s", locked ? "locked" : "lost");
+		gst_uart_src_post_pps(uartsrc, locked, period, jitter);
+	}
+}
+
+static void
+gst_uart_src_pps_start(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+
+	if (!priv->pps_line || priv->pps_monitor)
+		return;
+
+	GST_OBJECT_LOCK(uartsrc);
+	pps_reset(&priv->pps);
+	GST_OBJECT_UNLOCK(uartsrc);
+	priv->pps_monitor = uart_line_monitor_new(priv->uart, priv->pps_line,
+						  gst_uart_src_pps_pulse, uartsrc);
+	if (!priv->pps_monitor)
+		GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+				    ("Can not watch the PPS line of \"%s\".", priv->device),
+				    GST_ERROR_SYSTEM);
+}
+
+static void
+gst_uart_src_pps_stop(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+
+	uart_line_monitor_free(priv->pps_monitor);
+	priv->pps_monitor = NULL;
+}
+
+/*
+ * Running time of a CLOCK_MONOTONIC host time in the past: its age, in
+ * reference time when the PPS is locked, taken off the pipeline clock,
+ * whichever clock that is.
+ */
+static GstClockTime
+gst_uart_src_host_to_running_time(GstUartSrc * uartsrc, GstClockTime host)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstClockTime now, host_now, ago, base_time;
+	GstClock *clock;
+
+	clock = gst_element_get_clock(GST_ELEMENT(uartsrc));
+	if (!clock)
+		return GST_CLOCK_TIME_NONE;
+	now = gst_clock_get_time(clock);
+	host_now = gst_util_get_timestamp();
+	gst_object_unref(clock);
+
+	GST_OBJECT_LOCK(uartsrc);
+	ago = pps_host_to_reference(&priv->pps, host_now > host ? host_now - host : 0);
+	GST_OBJECT_UNLOCK(uartsrc);
+	base_time = gst_element_get_base_time(GST_ELEMENT(uartsrc));
+	if (now < base_time + ago)
+		return GST_CLOCK_TIME_NONE;
+
+	return now - base_time - ago;
+}
+
+struct line_change {
+	int lines;		/* or -errno */
+	guint64 when;
+};
+
+/* from the line monitor thread; fill() picks it up */
+static void
+gst_uart_src_line_change(int lines, guint64 when, gpointer user_data)
+{
+	GstUartSrc *uartsrc = GST_UART_SRC(user_data);
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	struct line_change change = { lines, when };
+
+	if (write(priv->line_pipe[1], &change, sizeof(change)) < 0)
+		GST_WARNING_OBJECT(uartsrc, "line change 0x%x lost: %s", lines, g_strerror(errno));
+}
+
+static void
+gst_uart_src_lines_start(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	int lines;
+
+	if (!priv->watch_lines || priv->line_monitor)
+		return;
+
+	/* where the lines are now; downstream hears changes from there */
+	lines = uart_get_modem_lines(priv->uart);
+	gst_uart_src_line_change(lines < 0 ? -errno : lines, gst_util_get_timestamp(), uartsrc);
+	priv->line_monitor = uart_line_monitor_new(priv->uart, priv->watch_lines,
+						   gst_uart_src_line_change, uartsrc);
+	if (!priv->line_monitor)
+		GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+				    ("Can not watch the modem lines of \"%s\".", priv->device),
+				    GST_ERROR_SYSTEM);
+}
+
+static void
+gst_uart_src_lines_stop(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+
+	uart_line_monitor_free(priv->line_monitor);
+	priv->line_monitor = NULL;
+}
+
+/*
+ * Send the line changes the monitor saw downstream, each as a
+ * serialized custom event stamped with the running time it was seen at.
+ * Until the first buffer went out they wait for it in GstBaseSrc, so
+ * they come after the segment.
+ */
+static void
+gst_uart_src_push_lines(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	struct line_change change;
+
+	while (read(priv->line_pipe[0], &change, sizeof(change)) == sizeof(change)) {
+		GstStructure *s;
+		GstEvent *event;
+		int changed;
+
+		if (change.lines < 0) {
+			GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+					    ("Can not watch the modem lines of \"%s\".", priv->device),
+					    ("%s", g_strerror(-change.lines)));
+			continue;
+		}
+		changed = priv->lines < 0 ? priv->watch_lines : (change.lines ^ priv->lines) & priv->watch_lines;
+		if (!changed)
+			continue;
+		priv->lines = change.lines;
+
+		s = gst_structure_new(UART_MODEM_LINES_EVENT,
+				      "lines", G_TYPE_UINT, change.lines,
+				      "changed", G_TYPE_UINT, changed,
+				      "dcd", G_TYPE_BOOLEAN, !!(change.lines & TIOCM_CD),
+				      "cts", G_TYPE_BOOLEAN, !!(change.lines & TIOCM_CTS),
+				      "dsr", G_TYPE_BOOLEAN, !!(change.lines & TIOCM_DSR),
+				      "ri", G_TYPE_BOOLEAN, !!(change.lines & TIOCM_RI),
+				      "timestamp", G_TYPE_UINT64,
+				      gst_uart_src_host_to_running_time(uartsrc, change.when),
+				      NULL);
+		event = gst_event_new_custom(GST_EVENT_CUSTOM_DOWNSTREAM, s);
+		GST_DEBUG_OBJECT(uartsrc, "lines 0x%x: %" GST_PTR_FORMAT, change.lines, event);
+		if (priv->started)
+			gst_pad_push_event(GST_BASE_SRC_PAD(uartsrc), event);
+		else
+			gst_element_send_event(GST_ELEMENT(uartsrc), event);
+	}
+}
+
+/*
+ * Timestamp a buffer by when its first byte came in rather than by
+ * when we got around to read it.  While the line is busy, the last
+ * byte of a read arrives a wire time after that of the previous read;
+ * that is later than our wakeup only if the estimate drifted, and well
+ * before it (ARRIVAL_MAX_JITTER) only if the line idled, and in both
+ * cases the wakeup is all we have.
+ */
+static void
+gst_uart_src_timestamp(GstUartSrc * uartsrc, GstBuffer * buffer, GstClockTime wakeup,
+		       gsize offset, gsize size)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstClockTime wire = uart_wire_time(priv->uart, size);
+
+	if (GST_CLOCK_TIME_IS_VALID(priv->arrival)) {
+		GstClockTime expected = priv->arrival + wire;
+
+		if (expected <= wakeup && wakeup - expected <= ARRIVAL_MAX_JITTER)
+			wakeup = expected;
+	}
+	priv->arrival = wakeup;
+	/* a buffer filled by several reads starts where the first did */
+	if (offset == 0)
+		GST_BUFFER_PTS(buffer) = gst_uart_src_host_to_running_time(uartsrc, priv->arrival - wire);
+	GST_BUFFER_DURATION(buffer) = uart_wire_time(priv->uart, offset + size);
+}
+
+/* overruns so far, as counted by the driver */
+static guint32
+gst_uart_src_overruns(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	struct uart_icount icount;
+
+	if (uart_get_icount(priv->uart, &icount) < 0)
+		return priv->overruns;
+
+	return icount.overrun + icount.buf_overrun;
+}
+
+static void
+gst_uart_src_reset_overruns(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	struct uart_icount icount;
+
+	priv->count_overruns = uart_get_icount(priv->uart, &icount) == 0;
+	priv->overruns = priv->count_overruns ? icount.overrun + icount.buf_overrun : 0;
+}
+
+/* the device went away; close it and remember how it was set up */
+static void
+gst_uart_src_disconnect(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstPollFD fd = GST_POLL_FD_INIT;
+
+	GST_ELEMENT_WARNING(uartsrc, RESOURCE, READ,
+			    ("Device \"%s\" went away; waiting for it to come back.", priv->device),
+			    (NULL));
+	priv->lost_at = gst_uart_src_running_time(uartsrc);
+	gst_uart_src_pps_stop(uartsrc);
+	gst_uart_src_lines_stop(uartsrc);
+	/* what the monitor saw up to here */
+	if (priv->line_pipe[0] >= 0)
+		gst_uart_src_push_lines(uartsrc);
+
+	fd.fd = priv->uart->fd;
+	gst_poll_remove_fd(priv->fdset_read, &fd);
+	gst_poll_remove_fd(priv->fdset_write, &fd);
+	uart_conn_lost(&priv->conn, GST_ELEMENT(uartsrc), priv->device, &priv->uart);
+}
+
+/*
+ * Wait for the device to come back and reopen it, see
+ * uart_conn_wait(), and account for the downtime with a GAP event and
+ * DISCONT on the next buffer.  Returns FALSE if we got flushed
+ * meanwhile; we are called again on the next fill then.
+ */
+static gboolean
+gst_uart_src_reconnect(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstPollFD fd = GST_POLL_FD_INIT;
+	struct uart_config config;
+	struct uart *uart;
+	GstClockTime downtime;
+
+	GST_OBJECT_LOCK(uartsrc);
+	gst_uart_src_get_config(uartsrc, &config);
+	GST_OBJECT_UNLOCK(uartsrc);
+
+	/* not fdset_read; a setting changed meanwhile is applied once we are back */
+	uart = uart_conn_wait(&priv->conn, GST_ELEMENT(uartsrc), priv->device, &config,
+			      priv->fdset_wait, priv->reconnect_interval, &downtime);
+	if (!uart)
+		return FALSE;
+
+	fd.fd = uart->fd;
+	gst_poll_add_fd(priv->fdset_read, &fd);
+	gst_poll_fd_ctl_read(priv->fdset_read, &fd, TRUE);
+	gst_poll_add_fd(priv->fdset_write, &fd);
+	gst_poll_fd_ctl_write(priv->fdset_write, &fd, TRUE);
+	GST_OBJECT_LOCK(uartsrc);
+	priv->uart = uart;
+	GST_OBJECT_UNLOCK(uartsrc);
+	gst_uart_src_reset_overruns(uartsrc);
+	gst_uart_src_apply_latency(uartsrc);
+	gst_uart_src_pps_start(uartsrc);
+	gst_uart_src_lines_start(uartsrc);
+	priv->arrival = GST_CLOCK_TIME_NONE;
+
+	uart_conn_post(GST_ELEMENT(uartsrc), priv->device, TRUE, downtime);
+
+	if (priv->started && GST_CLOCK_TIME_IS_VALID(priv->lost_at))
+		gst_pad_push_event(GST_BASE_SRC_PAD(uartsrc),
+				   gst_event_new_gap(priv->lost_at, downtime));
+	priv->discont = TRUE;
+
+	return TRUE;
+}
+
+static void
+gst_uart_src_reconfigure(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	struct uart_config config;
+	GError *error = NULL;
+	int ret;
+
+	GST_OBJECT_LOCK(uartsrc);
+	if (!priv->reconfigure) {
+		GST_OBJECT_UNLOCK(uartsrc);
+		return;
+	}
+	priv->reconfigure = FALSE;
+	gst_uart_src_get_config(uartsrc, &config);
+	GST_OBJECT_UNLOCK(uartsrc);
+
+	ret = uart_reconfigure(priv->uart, &config, &error);
+	if (ret < 0) {
+		GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS, ("%s", error->message), (NULL));
+		g_clear_error(&error);
+	}
+	else if (ret > 0) {
+		GST_INFO_OBJECT(uartsrc, "now at %d baud, parity %d",
+				uart_termios_baud_rate(&priv->uart->current), uart_get_parity(priv->uart));
+	}
+}
+
+/*
+ * Strip the error marks from the len bytes read at data, at offset in
+ * the buffer, and note where the bad bytes are; returns how many bytes
+ * are left.  Once a decoding stage moves bytes around the offsets mean
+ * nothing, so then the bad bytes are only counted.
+ */
+static gsize
+gst_uart_src_unmark(GstUartSrc * uartsrc, guint8 * data, gsize len, gsize offset)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GArray *errors = priv->error_offsets;
+	gsize n;
+
+	if (priv->fec || priv->decompress || priv->triggering)
+		errors = NULL;
+	GST_OBJECT_LOCK(uartsrc);
+	n = parmrk_unpack(&priv->parmrk, data, len, errors, offset);
+	GST_OBJECT_UNLOCK(uartsrc);
+
+	return n;
+}
+
+/*
+ * Strip the multidrop marks from the len bytes read at data and drop
+ * frames for other nodes; returns how many bytes are left.  *cut says a
+ * frame for us begins in what was read: it waits in priv->held, for the
+ * next buffer.
+ */
+static gsize
+gst_uart_src_multidrop(GstUartSrc * uartsrc, guint8 * data, gsize len, gboolean started,
+		       gboolean * cut)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	gsize used;
+	gsize n;
+
+	GST_OBJECT_LOCK(uartsrc);
+	n = multidrop_unpack(&priv->multidrop_unpacker, data, len, started, &used);
+	GST_OBJECT_UNLOCK(uartsrc);
+	*cut = used < len;
+	if (*cut)
+		g_byte_array_prepend(priv->held, data + used, len - used);
+
+	return n;
+}
+
+/* a match; hits are only touched by the streaming thread */
+static void
+gst_uart_src_trigger_hit(guint pattern, guint64 offset, gpointer user_data)
+{
+	GArray *hits = user_data;
+	struct trigger_hit hit = { pattern, offset };
+
+	g_array_append_val(hits, hit);
+}
+
+/*
+ * Run what was just decoded, from had on, through the trigger; with
+ * trigger-gate only what gets through stays in priv->decoded.  Called
+ * with the object lock held.
+ */
+static void
+gst_uart_src_trigger(GstUartSrc * uartsrc, gsize had)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	struct trigger *trigger = &priv->trigger;
+	gsize len = priv->decoded->len - had;
+
+	if (trigger->gate || trigger->pending->len) {
+		g_byte_array_set_size(priv->scanned, 0);
+		g_byte_array_append(priv->scanned, priv->decoded->data + had, len);
+		g_byte_array_set_size(priv->decoded, had);
+	}
+	if (trigger->gate) {
+		trigger_feed(trigger, priv->scanned->data, len, priv->decoded,
+			     gst_uart_src_trigger_hit, priv->trigger_hits);
+		return;
+	}
+	/* the gate just opened; what it held back goes first */
+	if (trigger->pending->len) {
+		trigger_flush(trigger, priv->decoded);
+		g_byte_array_append(priv->decoded, priv->scanned->data, len);
+	}
+	trigger_feed(trigger, priv->decoded->data + priv->decoded->len - len, len, NULL,
+		     gst_uart_src_trigger_hit, priv->trigger_hits);
+}
+
+static void
+gst_uart_src_post_triggers(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstClockTime running_time = gst_uart_src_running_time(uartsrc);
+	guint i;
+
+	for (i = 0; i < priv->trigger_hits->len; i++) {
+		struct trigger_hit *hit = &g_array_index(priv->trigger_hits, struct trigger_hit, i);
+		GstStructure *s;
+
+		s = gst_structure_new("uart-trigger",
+				      "device", G_TYPE_STRING, priv->device,
+				      "pattern", G_TYPE_UINT, hit->pattern,
+				      "offset", G_TYPE_UINT64, hit->offset,
+				      "running-time", G_TYPE_UINT64, running_time,
+				      NULL);
+		gst_element_post_message(GST_ELEMENT(uartsrc),
+					 gst_message_new_element(GST_OBJECT(uartsrc), s));
+	}
+	g_array_set_size(priv->trigger_hits, 0);
+}
+
+/*
+ * Replace the len bytes just read at data, which has room for max, by
+ * what they decode to, FEC first, then decompression and the trigger; the rest
+ * waits in priv->decoded for the next buffer.  Returns how many bytes
+ * are at data now.
+ */
+static gsize
+gst_uart_src_decode(GstUartSrc * uartsrc, guint8 * data, gsize len, gsize max)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	guint64 errors = priv->unpacker.lzss.errors;
+	guint64 failed = priv->fec_unpacker.frame.failed;
+	const guint8 *in = data;
+	gsize had = priv->decoded->len;
+	gsize n;
+
+	GST_OBJECT_LOCK(uartsrc);
+	if (priv->fec) {
+		g_byte_array_set_size(priv->corrected, 0);
+		rs_unpack(&priv->fec_unpacker, in, len, priv->corrected);
+		in = priv->corrected->data;
+		len = priv->corrected->len;
+	}
+	if (priv->decompress)
+		lzss_unpack(&priv->unpacker, in, len, priv->decoded);
+	else
+		g_byte_array_append(priv->decoded, in, len);
+	if (priv->triggering)
+		gst_uart_src_trigger(uartsrc, had);
+	GST_OBJECT_UNLOCK(uartsrc);
+	if (priv->trigger_hits->len)
+		gst_uart_src_post_triggers(uartsrc);
+	if (priv->fec_unpacker.frame.failed != failed) {
+		GST_WARNING_OBJECT(uartsrc, "%" G_GUINT64_FORMAT " frames beyond repair",
+				   priv->fec_unpacker.frame.failed - failed);
+		priv->discont = TRUE;
+	}
+	if (priv->unpacker.lzss.errors != errors) {
+		GST_WARNING_OBJECT(uartsrc, "lost %" G_GUINT64_FORMAT " compressed blocks",
+				   priv->unpacker.lzss.errors - errors);
+		priv->discont = TRUE;
+	}
+
+	n = MIN(priv->decoded->len, max);
+	memcpy(data, priv->decoded->data, n);
+	g_byte_array_remove_range(priv->decoded, 0, n);
+
+	return n;
+}
+
+/* busy-poll-cpu, once we run in the streaming thread */
+static void
+gst_uart_src_pin(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	cpu_set_t set;
+
+	if (priv->pinned || priv->busy_poll_cpu < 0)
+		return;
+	priv->pinned = TRUE;
+	/* the thread goes back to the pool; it gets this back when it leaves */
+	if (!priv->unpin && sched_getaffinity(0, sizeof(priv->affinity), &priv->affinity) == 0)
+		priv->unpin = TRUE;
+	CPU_ZERO(&set);
+	CPU_SET(priv->busy_poll_cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set) < 0)
+		GST_ELEMENT_WARNING(uartsrc, RESOURCE, SETTINGS,
+				    ("Could not pin to CPU %d.", priv->busy_poll_cpu), GST_ERROR_SYSTEM);
+	else
+		GST_INFO_OBJECT(uartsrc, "pinned to CPU %d", priv->busy_poll_cpu);
+}
+
+/* undo gst_uart_src_pin(); in the streaming thread, as it leaves */
+static void
+gst_uart_src_unpin(GstUartSrc * uartsrc)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+
+	if (!priv->unpin)
+		return;
+	priv->unpin = FALSE;
+	priv->pinned = FALSE;
+	if (sched_setaffinity(0, sizeof(priv->affinity), &priv->affinity) < 0)
+		GST_WARNING_OBJECT(uartsrc, "could not unpin: %s", g_strerror(errno));
+	else
+		GST_INFO_OBJECT(uartsrc, "unpinned");
+}
+
+/*
+ * gst_poll_wait() on fdset_read; with busy-poll, spin on a zero
+ * timeout for up to the spin budget first.  The budget doubles, up to
+ * busy-poll-budget, whenever data comes in while we spin and halves
+ * whenever we end up sleeping, so a quiet line costs little CPU.
+ */
+static gint
+gst_uart_src_wait(GstUartSrc * uartsrc, GstClockTime timeout)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	GstClockTime budget = priv->busy_poll_budget * GST_USECOND;
+	GstClockTime start, spent, spin;
+	gint ret;
+
+	if (!priv->busy_poll)
+		return gst_poll_wait(priv->fdset_read, timeout);
+
+	gst_uart_src_pin(uartsrc);
+	spin = MIN(priv->spin, budget);
+	if (GST_CLOCK_TIME_IS_VALID(timeout))
+		spin = MIN(spin, timeout);
+	start = gst_util_get_timestamp();
+	do {
+		ret = gst_poll_wait(priv->fdset_read, 0);
+		if (ret > 0) {
+			priv->spin = MIN(priv->spin * 2, budget);
+			priv->spin_hits++;
+		}
+		if (ret != 0)
+			return ret;
+		spent = gst_util_get_timestamp() - start;
+	} while (spent < spin);
+
+	priv->spin = MAX(priv->spin / 2, BUSY_POLL_MIN_SPIN);
+	priv->spin_misses++;
+	if (GST_CLOCK_TIME_IS_VALID(timeout))
+		timeout -= MIN(timeout, spent);
+	return gst_poll_wait(priv->fdset_read, timeout);
+}
+
+static GstFlowReturn
+gst_uart_src_fill(GstPushSrc * pushsrc, GstBuffer * buffer)
+{
+	GstUartSrc *uartsrc;
+	GstUartSrcPrivate *priv;
+	GstMapInfo info;
+	gsize size;
+	ssize_t red;
+	gsize max;
+	GstPollFD fd = GST_POLL_FD_INIT;
+	GstPollFD linefd = GST_POLL_FD_INIT;
+	GstClockTime delay;
+	GstClockTime wakeup = GST_CLOCK_TIME_NONE;
+	GstClockTime timeout;
+	gsize offset = 0;
+	gboolean cut = FALSE;
+	gint ret;
+
+	uartsrc = GST_UART_SRC(pushsrc);
+	priv = gst_uart_src_get_instance_private(uartsrc);
+
+	size = gst_buffer_get_sizes(buffer, NULL, &max);
+	g_array_set_size(priv->error_offsets, 0);
+
+	GST_DEBUG_OBJECT(uartsrc, "given buffer's size (%" G_GSIZE_FORMAT ") and max size (%" G_GSIZE_FORMAT ")",
+			 size, max);
+
+	if (!priv->uart && !gst_uart_src_reconnect(uartsrc))
+		return GST_FLOW_FLUSHING;
+	if (priv->auto_baud && !priv->auto_baud_done &&
+	    !gst_uart_src_auto_baud(uartsrc))
+		return GST_FLOW_FLUSHING;
+	gst_uart_src_reconfigure(uartsrc);
+
+	/* a block decodes to more than a buffer takes */
+	if (priv->decoded->len) {
+		offset = MIN(priv->decoded->len, size);
+		gst_buffer_fill(buffer, 0, priv->decoded->data, offset);
+		g_byte_array_remove_range(priv->decoded, 0, offset);
+		if (priv->framing == FRAMING_STREAM || offset == size)
+			goto done;
+	}
+
+again:
+	/* the next frame, from the last read */
+	if (priv->held->len) {
+		gst_buffer_map(buffer, &info, GST_MAP_WRITE);
+		red = MIN(priv->held->len, size - offset);
+		memcpy(info.data + offset, priv->held->data, red);
+		g_byte_array_remove_range(priv->held, 0, red);
+		wakeup = GST_CLOCK_TIME_IS_VALID(priv->arrival) ? priv->arrival : gst_util_get_timestamp();
+		goto unpack;
+	}
+
+	timeout = GST_CLOCK_TIME_NONE;
+	if (offset && priv->framing == FRAMING_IDLE)
+		timeout = MAX(uart_wire_time(priv->uart, IDLE_CHARS), IDLE_MIN);
+	ret = gst_uart_src_wait(uartsrc, timeout);
+	wakeup = gst_util_get_timestamp();
+	GST_DEBUG_OBJECT(uartsrc, "gst_poll_wait() returned %d", ret);
+	if (ret < 0) {
+		if (errno == EBUSY)
+			return GST_FLOW_FLUSHING;
+		if (errno == EINTR || errno == EAGAIN)
+			goto again;
+		goto poll_error;
+	}
+	/* the line went idle */
+	if (ret == 0)
+		goto done;
+
+	linefd.fd = priv->line_pipe[0];
+	if (linefd.fd >= 0 && gst_poll_fd_can_read(priv->fdset_read, &linefd))
+		gst_uart_src_push_lines(uartsrc);
+	if (gst_uart_src_woken(uartsrc))
+		gst_uart_src_reconfigure(uartsrc);
+
+	fd.fd = priv->uart->fd;
+	if (gst_poll_fd_has_closed(priv->fdset_read, &fd) ||
+	    gst_poll_fd_has_error(priv->fdset_read, &fd))
+		goto hangup;
+	/* woken up with nothing to read; don't push an empty buffer */
+	if (!gst_poll_fd_can_read(priv->fdset_read, &fd))
+		goto again;
+
+	gst_buffer_map(buffer, &info, GST_MAP_WRITE);
+	red = read(priv->uart->fd, info.data + offset, size - offset);
+	if (red <= 0) {
+		int err = errno;
+
+		gst_buffer_unmap(buffer, &info);
+		errno = err;
+		if (red < 0 && (err == EAGAIN || err == EINTR))
+			goto again;
+		if (red == 0 || uart_error_is_hangup(err))
+			goto hangup;
+		goto read_error;
+	}
+	if (priv->mark_errors && !priv->multidrop) {
+		red = gst_uart_src_unmark(uartsrc, info.data + offset, red, offset);
+		if (!red) {
+			gst_buffer_unmap(buffer, &info);
+			goto again;
+		}
+	}
+	if (priv->bitswap)
+		bitswap(info.data + offset, red);
+	if (fault_drop(&priv->fault)) {
+		GST_LOG_OBJECT(uartsrc, "fault: dropping %zd bytes", red);
+		gst_buffer_unmap(buffer, &info);
+		/* and the bad bytes noted in them */
+		while (priv->error_offsets->len &&
+		       g_array_index(priv->error_offsets, guint, priv->error_offsets->len - 1) >= offset)
+			g_array_set_size(priv->error_offsets, priv->error_offsets->len - 1);
+		goto again;
+	}
+	fault_corrupt(&priv->fault, info.data + offset, red);
+unpack:
+	if (priv->multidrop) {
+		red = gst_uart_src_multidrop(uartsrc, info.data + offset, red, offset > 0, &cut);
+		if (!red) {
+			gst_buffer_unmap(buffer, &info);
+			if (cut)
+				goto done;
+			goto again;
+		}
+	}
+	if (priv->fec || priv->decompress || priv->triggering) {
+		red = gst_uart_src_decode(uartsrc, info.data + offset, red, size - offset);
+		if (!red) {
+			gst_buffer_unmap(buffer, &info);
+			goto again;
+		}
+	}
+	GST_DEBUG_OBJECT(uartsrc, "the first byte %x", info.data[offset]);
+	gst_buffer_unmap(buffer, &info);
+	if (priv->pps_line)
+		gst_uart_src_timestamp(uartsrc, buffer, wakeup, offset, red);
+	GST_DEBUG_OBJECT(uartsrc, "read %zd bytes from \"%s\" (%d)", red, priv->device, priv->uart->fd);
+	offset += red;
+	if (!cut && priv->framing != FRAMING_STREAM && offset < size)
+		goto again;
+
+done:
+	gst_buffer_set_size(buffer, offset);
+	if (priv->error_offsets->len) {
+		GstUartErrorMeta *meta = gst_buffer_add_uart_error_meta(buffer);
+
+		g_array_append_vals(meta->offsets, priv->error_offsets->data, priv->error_offsets->len);
+		g_array_set_size(priv->error_offsets, 0);
+		GST_OBJECT_LOCK(uartsrc);
+		priv->error_buffers++;
+		GST_OBJECT_UNLOCK(uartsrc);
+	}
+
+	if (priv->count_overruns) {
+		guint32 overruns = gst_uart_src_overruns(uartsrc);
+
+		if (overruns != priv->overruns) {
+			GST_WARNING_OBJECT(uartsrc, "%u overruns; data lost", overruns - priv->overruns);
+			priv->overruns = overruns;
+			priv->discont = TRUE;
+		}
+	}
+	delay = fault_delay(&priv->fault);
+	if (delay && gst_poll_wait(priv->fdset_wait, delay) < 0 && errno == EBUSY)
+		return GST_FLOW_FLUSHING;
+
+	if (priv->discont) {
+		GST_BUFFER_FLAG_SET(buffer, GST_BUFFER_FLAG_DISCONT);
+		priv->discont = FALSE;
+	}
+	priv->started = TRUE;
+	GST_DEBUG_OBJECT(uartsrc, "%" GST_PTR_FORMAT, buffer);
+
+	if (GST_CLOCK_TIME_IS_VALID(wakeup)) {
+		guint64 usec = (gst_util_get_timestamp() - wakeup) / GST_USECOND;
+
+		priv->wake_to_push[usec ? MIN(g_bit_storage(usec), WAKE_BUCKETS - 1) : 0]++;
+	}
+
+	return GST_FLOW_OK;
+
+poll_error:
+	{
+		GST_ELEMENT_ERROR(uartsrc, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+		return GST_FLOW_ERROR;
+	}
+read_error:
+	{
+		GST_ELEMENT_ERROR(uartsrc, RESOURCE, READ,
+				  ("Could not read from device \"%s\".", priv->device),
+				  GST_ERROR_SYSTEM);
+		return GST_FLOW_ERROR;
+	}
+
+hangup:
+	if (!priv->reconnect) {
+		GST_ELEMENT_ERROR(uartsrc, RESOURCE, READ,
+				  ("Device \"%s\" went away.", priv->device), GST_ERROR_SYSTEM);
+		return GST_FLOW_ERROR;
+	}
+	gst_uart_src_disconnect(uartsrc);
+	if (!gst_uart_src_reconnect(uartsrc))
+		return GST_FLOW_FLUSHING;
+	/* what we had belongs to the device that went away */
+	offset = 0;
+	GST_OBJECT_LOCK(uartsrc);
+	lzss_unpacker_reset(&priv->unpacker);
+	rs_unpacker_reset(&priv->fec_unpacker);
+	trigger_reset(&priv->trigger);
+	multidrop_reset(&priv->multidrop_unpacker);
+	parmrk_reset(&priv->parmrk);
+	priv->error_buffers = 0;
+	GST_OBJECT_UNLOCK(uartsrc);
+	g_byte_array_set_size(priv->decoded, 0);
+	g_byte_array_set_size(priv->held, 0);
+	g_array_set_size(priv->error_offsets, 0);
+	goto again;
+}
+
+static void
+gst_uart_src_set_property(GObject * object, guint prop_id, const GValue * value,
+			   GParamSpec * pspec)
+{
+	GstUartSrc *uartsrc;
+	GstUartSrcPrivate *priv;
+
+	uartsrc = GST_UART_SRC(object);
+	priv = gst_uart_src_get_instance_private(uartsrc);
+
+	switch (prop_id) {
+	case ARG_DEVICE:
+		priv->device = g_value_dup_string(value);
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), priv->device);
+		break;
+
+	case ARG_BAUD_RATE:
+		GST_OBJECT_LOCK(uartsrc);
+		priv->baud_rate = g_value_get_int(value);
+		priv->reconfigure = TRUE;
+		gst_uart_src_wake(uartsrc);
+		GST_OBJECT_UNLOCK(uartsrc);
+		gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(uartsrc));
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->baud_rate);
 		break;
 
+	case ARG_PARITY:
+	{
+		const char *s = g_value_get_string(value);
+		GST_OBJECT_LOCK(uartsrc);
+		if (!uart_parity_from_string(s, &priv->parity))
+			GST_WARNING_OBJECT(uartsrc, "unknown parity \"%s\"", s);
+		priv->reconfigure = TRUE;
+		gst_uart_src_wake(uartsrc);
+		GST_OBJECT_UNLOCK(uartsrc);
+		gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(uartsrc));
+
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
+		break;
+	}
+	case ARG_BITSWAP:
+		GST_OBJECT_LOCK(uartsrc);
+		priv->bitswap = g_value_get_boolean(value);
+		GST_OBJECT_UNLOCK(uartsrc);
+		gst_pad_mark_reconfigure(GST_BASE_SRC_PAD(uartsrc));
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->bitswap);
+		break;
+
+	case ARG_ACKNAK:
+		priv->acknak = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->acknak);
+		break;
+
+	case ARG_NAK_PROBABILITY:
+		priv->nak_probability = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->nak_probability);
+		break;
+
+	case ARG_ACKNAK_WINDOW:
+		priv->acknak_window = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->acknak_window);
+		break;
+
+	case ARG_AUTO_BAUD:
+		priv->auto_baud = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->auto_baud);
+		break;
+
+	case ARG_AUTO_BAUD_TIMEOUT:
+		priv->auto_baud_timeout = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->auto_baud_timeout);
+		break;
+
+	case ARG_SYNC_PATTERN:
+	{
+		const char *s = g_value_get_string(value);
+
+		if (priv->sync_pattern) {
+			g_byte_array_unref(priv->sync_pattern);
+			priv->sync_pattern = NULL;
+		}
+		if (s && s[0] != '\0') {
+			priv->sync_pattern = parse_hex(s, SYNC_PATTERN_MAX);
+			if (!priv->sync_pattern)
+				GST_WARNING_OBJECT(uartsrc, "invalid sync-pattern \"%s\", expected up to %d hex bytes",
+						   s, SYNC_PATTERN_MAX);
+		}
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
+		break;
+	}
+
+	case ARG_RECONNECT:
+		priv->reconnect = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->reconnect);
+		break;
+
+	case ARG_RECONNECT_INTERVAL:
+		priv->reconnect_interval = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->reconnect_interval);
+		break;
+
+	case ARG_FAULT_SEED:
+		priv->fault.seed = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->fault.seed);
+		break;
+
+	case ARG_FAULT_LOSS:
+		priv->fault.loss = g_value_get_double(value);
+		GST_INFO("setting property \'%s\' to %f", g_param_spec_get_name(pspec), priv->fault.loss);
+		break;
+
+	case ARG_FAULT_BURST:
+		priv->fault.burst = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->fault.burst);
+		break;
+
+	case ARG_FAULT_CORRUPT:
+		priv->fault.corrupt = g_value_get_double(value);
+		GST_INFO("setting property \'%s\' to %f", g_param_spec_get_name(pspec), priv->fault.corrupt);
+		break;
+
+	case ARG_FAULT_DELAY:
+		priv->fault.delay = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->fault.delay);
+		break;
+
+	case ARG_PPS_LINE:
+	{
+		const char *s = g_value_get_string(value);
+
+		if (!g_strcmp0(s, "dcd"))
+			priv->pps_line = TIOCM_CD;
+		else if (!g_strcmp0(s, "cts"))
+			priv->pps_line = TIOCM_CTS;
+		else
+			priv->pps_line = 0;
+		gst_uart_src_update_clock_flag(uartsrc);
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
+		break;
+	}
+	case ARG_WATCH_LINES:
+	{
+		const char *s = g_value_get_string(value);
+		char **names = g_strsplit(s ? s : "", ",", -1);
+		char **name;
+
+		priv->watch_lines = 0;
+		for (name = names; *name; name++) {
+			g_strstrip(*name);
+			if (g_str_equal(*name, "dcd"))
+				priv->watch_lines |= TIOCM_CD;
+			else if (g_str_equal(*name, "cts"))
+				priv->watch_lines |= TIOCM_CTS;
+			else if (g_str_equal(*name, "dsr"))
+				priv->watch_lines |= TIOCM_DSR;
+			else if (g_str_equal(*name, "ri"))
+				priv->watch_lines |= TIOCM_RI;
+			else if (**name)
+				GST_WARNING_OBJECT(uartsrc, "unknown modem line \"%s\"", *name);
+		}
+		g_strfreev(names);
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
+		break;
+	}
+	case ARG_PROVIDE_CLOCK:
+		priv->provide_clock = g_value_get_boolean(value);
+		gst_uart_src_update_clock_flag(uartsrc);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->provide_clock);
+		break;
+
+	case ARG_DECOMPRESS:
+		priv->decompress = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->decompress);
+		break;
+
+	case ARG_FEC:
+		priv->fec = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->fec);
+		break;
+
+	case ARG_LOW_LATENCY:
+		priv->low_latency = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->low_latency);
+		break;
+
+	case ARG_BUSY_POLL:
+		priv->busy_poll = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->busy_poll);
+		break;
+
+	case ARG_BUSY_POLL_BUDGET:
+		priv->busy_poll_budget = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->busy_poll_budget);
+		break;
+
+	case ARG_BUSY_POLL_CPU:
+		priv->busy_poll_cpu = g_value_get_int(value);
+		priv->pinned = FALSE;
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->busy_poll_cpu);
+		break;
+
+	case ARG_KEEP_OPEN:
+		priv->keep_open = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->keep_open);
+		break;
+
+	case ARG_TRIGGER:
+	{
+		const char *s = g_value_get_string(value);
+		gchar **patterns = g_strsplit(s ? s : "", ",", -1);
+		struct trigger trigger;
+		guint i;
+
+		trigger_init(&trigger);
+		for (i = 0; patterns[i]; i++) {
+			GByteArray *pattern;
+
+			if (g_strstrip(patterns[i])[0] == '\0')
+				continue;
+			pattern = parse_hex(patterns[i], TRIGGER_PATTERN_MAX);
+			if (!pattern) {
+				GST_WARNING_OBJECT(uartsrc, "invalid trigger pattern \"%s\", expected up to %d hex bytes",
+						   patterns[i], TRIGGER_PATTERN_MAX);
+				continue;
+			}
+			ac_add(&trigger.ac, pattern->data, pattern->len);
+			g_byte_array_unref(pattern);
+		}
+		g_strfreev(patterns);
+		ac_compile(&trigger.ac);
+
+		/* the stream goes on; so do the offsets, the stats and what the gate holds */
+		GST_OBJECT_LOCK(uartsrc);
+		trigger.gate = priv->trigger.gate;
+		trigger.pre = priv->trigger.pre;
+		trigger.post = priv->trigger.post;
+		trigger.offset = priv->trigger.offset;
+		trigger.emit_until = priv->trigger.emit_until;
+		trigger.matches = priv->trigger.matches;
+		trigger.in = priv->trigger.in;
+		trigger.passed = priv->trigger.passed;
+		g_byte_array_unref(trigger.pending);
+		g_byte_array_unref(trigger.mask);
+		trigger.pending = g_steal_pointer(&priv->trigger.pending);
+		trigger.mask = g_steal_pointer(&priv->trigger.mask);
+		trigger_clear(&priv->trigger);
+		priv->trigger = trigger;
+		priv->triggering = trigger.ac.max_len > 0;
+		g_free(priv->trigger_patterns);
+		priv->trigger_patterns = g_strdup(s);
+		GST_OBJECT_UNLOCK(uartsrc);
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
+		break;
+	}
+
+	case ARG_MULTIDROP:
+		GST_OBJECT_LOCK(uartsrc);
+		priv->multidrop = g_value_get_boolean(value);
+		priv->reconfigure = TRUE;
+		gst_uart_src_wake(uartsrc);
+		GST_OBJECT_UNLOCK(uartsrc);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->multidrop);
+		break;
+
+	case ARG_ADDRESS_FILTER:
+	{
+		const char *s = g_value_get_string(value);
+		gchar **addresses = g_strsplit(s ? s : "", ",", -1);
+		struct multidrop *md = &priv->multidrop_unpacker;
+		guint i;
+
+		GST_OBJECT_LOCK(uartsrc);
+		multidrop_clear_filter(md);
+		for (i = 0; addresses[i]; i++) {
+			GByteArray *address;
+
+			if (g_strstrip(addresses[i])[0] == '\0')
+				continue;
+			address = parse_hex(addresses[i], 1);
+			if (!address) {
+				GST_WARNING_OBJECT(uartsrc, "invalid address \"%s\", expected one hex byte",
+						   addresses[i]);
+				continue;
+			}
+			multidrop_add_address(md, address->data[0]);
+			g_byte_array_unref(address);
+		}
+		g_free(priv->address_filter);
+		priv->address_filter = g_strdup(s);
+		GST_OBJECT_UNLOCK(uartsrc);
+		g_strfreev(addresses);
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
+		break;
+	}
+
+	case ARG_MARK_ERRORS:
+		GST_OBJECT_LOCK(uartsrc);
+		priv->mark_errors = g_value_get_boolean(value);
+		priv->reconfigure = TRUE;
+		gst_uart_src_wake(uartsrc);
+		GST_OBJECT_UNLOCK(uartsrc);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->mark_errors);
+		break;
+
+	case ARG_TRIGGER_PRE:
+		GST_OBJECT_LOCK(uartsrc);
+		priv->trigger.pre = g_value_get_uint(value);
+		GST_OBJECT_UNLOCK(uartsrc);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->trigger.pre);
+		break;
+
+	case ARG_TRIGGER_POST:
+		GST_OBJECT_LOCK(uartsrc);
+		priv->trigger.post = g_value_get_uint(value);
+		GST_OBJECT_UNLOCK(uartsrc);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->trigger.post);
+		break;
+
+	case ARG_TRIGGER_GATE:
+		GST_OBJECT_LOCK(uartsrc);
+		priv->trigger.gate = g_value_get_boolean(value);
+		GST_OBJECT_UNLOCK(uartsrc);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->trigger.gate);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gst_uart_src_get_property(GObject * object, guint prop_id, GValue * value,
+			   GParamSpec * pspec)
+{
+	GstUartSrc *uartsrc;
+	GstUartSrcPrivate *priv;
+
+	uartsrc = GST_UART_SRC(object);
+	priv = gst_uart_src_get_instance_private(uartsrc);
+
+	switch (prop_id) {
+	case ARG_DEVICE:
+		g_value_set_string(value, priv->device);
+		break;
+
+	case ARG_BAUD_RATE:
+		g_value_set_int(value, priv->baud_rate);
+		break;
+
+	case ARG_PARITY:
+		g_value_set_string(value, uart_parity_to_string(priv->parity));
+		break;
+
+	case ARG_BITSWAP:
+		g_value_set_boolean(value, priv->bitswap);
+		break;
+
+	case ARG_ACKNAK:
+		g_value_set_boolean(value, priv->acknak);
+		break;
+
+	case ARG_NAK_PROBABILITY:
+		g_value_set_uint(value, priv->nak_probability);
+		break;
+
+	case ARG_ACKNAK_WINDOW:
+		g_value_set_uint(value, priv->acknak_window);
+		break;
+
+	case ARG_AUTO_BAUD:
+		g_value_set_boolean(value, priv->auto_baud);
+		break;
+
+	case ARG_AUTO_BAUD_TIMEOUT:
+		g_value_set_uint(value, priv->auto_baud_timeout);
+		break;
+
+	case ARG_SYNC_PATTERN:
+		if (priv->sync_pattern) {
+			GString *hex = g_string_new(NULL);
+			guint i;
+
+			for (i = 0; i < priv->sync_pattern->len; i++)
+				g_string_append_printf(hex, "%02x", priv->sync_pattern->data[i]);
+			g_value_take_string(value, g_string_free(hex, FALSE));
+		}
+		else
+			g_value_set_string(value, NULL);
+		break;
+
+	case ARG_RECONNECT:
+		g_value_set_boolean(value, priv->reconnect);
+		break;
+
+	case ARG_RECONNECT_INTERVAL:
+		g_value_set_uint(value, priv->reconnect_interval);
+		break;
+
+	case ARG_FAULT_SEED:
+		g_value_set_uint(value, priv->fault.seed);
+		break;
+
+	case ARG_FAULT_LOSS:
+		g_value_set_double(value, priv->fault.loss);
+		break;
+
+	case ARG_FAULT_BURST:
+		g_value_set_uint(value, priv->fault.burst);
+		break;
+
+	case ARG_FAULT_CORRUPT:
+		g_value_set_double(value, priv->fault.corrupt);
+		break;
+
+	case ARG_FAULT_DELAY:
+		g_value_set_uint(value, priv->fault.delay);
+		break;
+
+	case ARG_FAULT_STATS:
+		g_value_take_boxed(value, gst_structure_new("fault-stats",
+							    "dropped", G_TYPE_UINT64, priv->fault.dropped,
+							    "corrupted", G_TYPE_UINT64, priv->fault.corrupted,
+							    "delayed", G_TYPE_UINT64, priv->fault.delayed,
+							    NULL));
+		break;
+
+	case ARG_PPS_LINE:
+		switch (priv->pps_line) {
+		default:
+			g_value_set_string(value, "none");
+			break;
+		case TIOCM_CD:
+			g_value_set_string(value, "dcd");
+			break;
+		case TIOCM_CTS:
+			g_value_set_string(value, "cts");
+			break;
+		}
+		break;
+
+	case ARG_PROVIDE_CLOCK:
+		g_value_set_boolean(value, priv->provide_clock);
+		break;
+
+	case ARG_WATCH_LINES:
+	{
+		GPtrArray *names = g_ptr_array_new();
+
+		if (priv->watch_lines & TIOCM_CD)
+			g_ptr_array_add(names, "dcd");
+		if (priv->watch_lines & TIOCM_CTS)
+			g_ptr_array_add(names, "cts");
+		if (priv->watch_lines & TIOCM_DSR)
+			g_ptr_array_add(names, "dsr");
+		if (priv->watch_lines & TIOCM_RI)
+			g_ptr_array_add(names, "ri");
+		g_ptr_array_add(names, NULL);
+		g_value_take_string(value, g_strjoinv(",", (char **)names->pdata));
+		g_ptr_array_free(names, TRUE);
+		break;
+	}
+
+	case ARG_PPS_STATS:
+		GST_OBJECT_LOCK(uartsrc);
+		g_value_take_boxed(value, gst_structure_new("pps-stats",
+							    "locked", G_TYPE_BOOLEAN, priv->pps.locked,
+							    "period", G_TYPE_DOUBLE, priv->pps.period,
+							    "jitter", G_TYPE_DOUBLE, priv->pps.jitter,
+							    "pulses", G_TYPE_UINT64, priv->pps.index,
+							    "rejected", G_TYPE_UINT64, priv->pps.rejected,
+							    NULL));
+		GST_OBJECT_UNLOCK(uartsrc);
+		break;
+
+	case ARG_DECOMPRESS:
+		g_value_set_boolean(value, priv->decompress);
+		break;
+
+	case ARG_DECOMPRESS_STATS:
+	{
+		struct lzss *lzss = &priv->unpacker.lzss;
+
+		GST_OBJECT_LOCK(uartsrc);
+		g_value_take_boxed(value, gst_structure_new("decompress-stats",
+							    "blocks", G_TYPE_UINT64, lzss->blocks,
+							    "stored", G_TYPE_UINT64, lzss->stored,
+							    "raw-bytes", G_TYPE_UINT64, lzss->raw,
+							    "wire-bytes", G_TYPE_UINT64, lzss->wire,
+							    "errors", G_TYPE_UINT64, lzss->errors,
+							    "ratio", G_TYPE_DOUBLE, lzss->wire ?
+							    (gdouble)lzss->raw / lzss->wire : 0.0,
+							    NULL));
+		GST_OBJECT_UNLOCK(uartsrc);
+		break;
+	}
+
+	case ARG_FEC:
+		g_value_set_boolean(value, priv->fec);
+		break;
+
+	case ARG_FEC_STATS:
+	{
+		struct rs_frame *frame = &priv->fec_unpacker.frame;
+
+		GST_OBJECT_LOCK(uartsrc);
+		g_value_take_boxed(value, gst_structure_new("fec-stats",
+							    "frames", G_TYPE_UINT64, frame->frames,
+							    "corrected", G_TYPE_UINT64, frame->corrected,
+							    "failed", G_TYPE_UINT64, frame->failed,
+							    "raw-bytes", G_TYPE_UINT64, frame->raw,
+							    "wire-bytes", G_TYPE_UINT64, frame->wire,
+							    NULL));
+		GST_OBJECT_UNLOCK(uartsrc);
+		break;
+	}
+
+	case ARG_LOW_LATENCY:
+		g_value_set_boolean(value, priv->low_latency);
+		break;
+
+	case ARG_LATENCY_SETTINGS:
+	{
+		struct uart_latency latency = { -1, -1, -1 };
+
+		GST_OBJECT_LOCK(uartsrc);
+		if (priv->uart)
+			uart_get_latency(priv->uart, &latency);
+		GST_OBJECT_UNLOCK(uartsrc);
+		g_value_take_boxed(value, gst_structure_new("latency-settings",
+							    "low-latency", G_TYPE_INT, latency.low_latency,
+							    "latency-timer", G_TYPE_INT, latency.latency_timer,
+							    "rx-trig-bytes", G_TYPE_INT, latency.rx_trig_bytes,
+							    NULL));
+		break;
+	}
+
+	case ARG_BUSY_POLL:
+		g_value_set_boolean(value, priv->busy_poll);
+		break;
+
+	case ARG_BUSY_POLL_BUDGET:
+		g_value_set_uint(value, priv->busy_poll_budget);
+		break;
+
+	case ARG_BUSY_POLL_CPU:
+		g_value_set_int(value, priv->busy_poll_cpu);
+		break;
+
+	case ARG_KEEP_OPEN:
+		g_value_set_boolean(value, priv->keep_open);
+		break;
+
+	case ARG_TRIGGER:
+		GST_OBJECT_LOCK(uartsrc);
+		g_value_set_string(value, priv->trigger_patterns);
+		GST_OBJECT_UNLOCK(uartsrc);
+		break;
+
+	case ARG_TRIGGER_PRE:
+		g_value_set_uint(value, priv->trigger.pre);
+		break;
+
+	case ARG_TRIGGER_POST:
+		g_value_set_uint(value, priv->trigger.post);
+		break;
+
+	case ARG_TRIGGER_GATE:
+		g_value_set_boolean(value, priv->trigger.gate);
+		break;
+
+	case ARG_MULTIDROP:
+		g_value_set_boolean(value, priv->multidrop);
+		break;
+
+	case ARG_ADDRESS_FILTER:
+		GST_OBJECT_LOCK(uartsrc);
+		g_value_set_string(value, priv->address_filter);
+		GST_OBJECT_UNLOCK(uartsrc);
+		break;
+
+	case ARG_MULTIDROP_STATS:
+	{
+		struct multidrop *md = &priv->multidrop_unpacker;
+
+		GST_OBJECT_LOCK(uartsrc);
+		g_value_take_boxed(value, gst_structure_new("multidrop-stats",
+							    "frames", G_TYPE_UINT64, md->frames,
+							    "passed", G_TYPE_UINT64, md->passed,
+							    "dropped-bytes", G_TYPE_UINT64, md->dropped,
+							    NULL));
+		GST_OBJECT_UNLOCK(uartsrc);
+		break;
+	}
+
+	case ARG_MARK_ERRORS:
+		g_value_set_boolean(value, priv->mark_errors);
+		break;
+
+	case ARG_MARK_ERRORS_STATS:
+		GST_OBJECT_LOCK(uartsrc);
+		g_value_take_boxed(value, gst_structure_new("mark-errors-stats",
+							    "errors", G_TYPE_UINT64, priv->parmrk.errors,
+							    "buffers", G_TYPE_UINT64, priv->error_buffers,
+							    NULL));
+		GST_OBJECT_UNLOCK(uartsrc);
+		break;
+
+	case ARG_TRIGGER_STATS:
+		GST_OBJECT_LOCK(uartsrc);
+		g_value_take_boxed(value, gst_structure_new("trigger-stats",
+							    "matches", G_TYPE_UINT64, priv->trigger.matches,
+							    "bytes-in", G_TYPE_UINT64, priv->trigger.in,
+							    "bytes-out", G_TYPE_UINT64, priv->trigger.passed,
+							    NULL));
+		GST_OBJECT_UNLOCK(uartsrc);
+		break;
+
+	case ARG_BUSY_POLL_STATS:
+	{
+		GstStructure *stats;
+		GValue histogram = G_VALUE_INIT;
+		GValue count = G_VALUE_INIT;
+		int i;
+
+		g_value_init(&histogram, GST_TYPE_ARRAY);
+		g_value_init(&count, G_TYPE_UINT64);
+		for (i = 0; i < WAKE_BUCKETS; i++) {
+			g_value_set_uint64(&count, priv->wake_to_push[i]);
+			gst_value_array_append_value(&histogram, &count);
+		}
+		stats = gst_structure_new("busy-poll-stats",
+					  "hits", G_TYPE_UINT64, priv->spin_hits,
+					  "sleeps", G_TYPE_UINT64, priv->spin_misses,
+					  "spin", G_TYPE_UINT64, priv->spin / GST_USECOND,
+					  NULL);
+		gst_structure_take_value(stats, "wake-to-push", &histogram);
+		g_value_unset(&count);
+		g_value_take_boxed(value, stats);
+		break;
+	}
+
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
 		break;
 	}
 }
 
+/* put an ack/nak response on the wire; see acknak.h for the format */
+static void
+gst_uart_src_respond(GstUartSrc * uartsrc, guint8 code, guint8 arg)
+{
+	GstUartSrcPrivate *priv = gst_uart_src_get_instance_private(uartsrc);
+	guint8 response[2] = { code, arg };
+
+	GST_OBJECT_LOCK(uartsrc);
+	if (priv->uart && write(priv->uart->fd, response, priv->acknak_window ? 2 : 1) < 0)
+		GST_WARNING_OBJECT(uartsrc, "could not send 0x%02x: %s", code, g_strerror(errno));
+	GST_OBJECT_UNLOCK(uartsrc);
+}
+
 static gboolean
 gst_uart_src_event(GstBaseSrc *src, GstEvent *event)
 {
 	GstUartSrc *uartsrc;
 	GstUartSrcPrivate *priv;
-	guint8 ack = 0x6;
-	guint8 nak = 0x15;
-	guint8 response;
+	enum AcknakType type;
+	guint sequence;
+	guint window;
 	gboolean result;
-	static guint64 count = 1;
 
 	uartsrc = GST_UART_SRC(src);
 	priv = gst_uart_src_get_instance_private(uartsrc);
@@ -515,28 +2879,42 @@ gst_uart_src_event(GstBaseSrc *src, GstEvent *event)
 
 	switch (GST_EVENT_TYPE (event)) {
 	case GST_EVENT_CUSTOM_UPSTREAM:
-		count++;
+		priv->acknak_count++;
 		GST_DEBUG_OBJECT(src, "got a custom event %" GST_PTR_FORMAT, event);
-		GST_DEBUG_OBJECT(src, "=== count %" G_GUINT64_FORMAT, count);
-		if (priv->acknak) {
-			if (priv->nak_probability && ((count % priv->nak_probability) == 0)) {
-				response = nak;
-				GST_WARNING_OBJECT(src, "Sending nak");
-			}
-			else {
-				response = ack;
-				GST_DEBUG_OBJECT(src, "Sending ack");
-			}
-			write(priv->uart->fd, &response, 1);
-
+		GST_DEBUG_OBJECT(src, "=== count %" G_GUINT64_FORMAT, priv->acknak_count);
+		/* anything but ours is a plain ack of the next frame */
+		if (!acknak_event_parse(event, &type, &sequence, &window)) {
+			type = ACKNAK_TYPE_ACK;
+			sequence = priv->acknak_seq;
+			window = 0;
 		}
-		else
+		if (!priv->acknak) {
 			GST_INFO_OBJECT(src, "but not sending it since ack/nak is not enabled");
+		}
+		else if (type == ACKNAK_TYPE_CREDIT) {
+			if (priv->acknak_window) {
+				GST_DEBUG_OBJECT(src, "Sending credit for %u frames", window);
+				gst_uart_src_respond(uartsrc, ACKNAK_CREDIT, MIN(window, 255));
+			}
+			else
+				GST_INFO_OBJECT(src, "credit needs acknak-window; dropped");
+		}
+		else if (type == ACKNAK_TYPE_NAK ||
+			 (priv->nak_probability && ((priv->acknak_count % priv->nak_probability) == 0))) {
+			GST_WARNING_OBJECT(src, "Sending nak for frame %u", sequence);
+			gst_uart_src_respond(uartsrc, ACKNAK_NAK, sequence & 0xff);
+			priv->acknak_seq = sequence;
+		}
+		else {
+			GST_DEBUG_OBJECT(src, "Sending ack for frame %u", sequence);
+			gst_uart_src_respond(uartsrc, ACKNAK_ACK, sequence & 0xff);
+			priv->acknak_seq = sequence + 1;
+		}
 
 		result = TRUE;
 		break;
 	default:
-		result = base_event(src, event);
+		result = GST_BASE_SRC_CLASS(gst_uart_src_parent_class)->event(src, event);
 		break;
 	}
 	return result;
@@ -0,0 +1,866 @@
+/* GStreamer
+ * Copyright (C) 2025 Yasushi SHOJI <yashi@spacecubics.com>
+ *
+ * gstuarttransaction.c:
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Library General Public
+ * License as published by the Free Software Foundation; either
+ * version 2 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.	 See the GNU
+ * Library General Public License for more details.
+ *
+ * You should have received a copy of the GNU Library General Public
+ * License along with this library; if not, write to the
+ * Free Software Foundation, Inc., 51 Franklin St, Fifth Floor,
+ * Boston, MA 02110-1301, USA.
+ */
+
+/*
+ * uarttransaction talks to devices that answer polls, Modbus RTU
+ * style.  Each buffer on the sink pad is a request; it is written to
+ * the device and the answer is read back on the same thread, so the
+ * turnaround does not bounce between streaming threads.  An answer
+ * ends at frame-gap of silence and leaves the src pad with the
+ * request's timestamps and its sequence number as offset.
+ *
+ * With max-outstanding above 1, that many requests go out before we
+ * wait for the first answer.  Answers are matched to requests in
+ * order; a device that stays silent shifts the rest, so only pipeline
+ * where the answers say who they are from.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <glib/gstdio.h>
+#include <glib-object.h>
+
+#include "config.h"
+#include "gstuarttransaction.h"
+#include "uart.h"
+
+#define DEFAULT_TIMEOUT (1000) /* 1 sec */
+#define DEFAULT_BLOCKSIZE (256) /* a Modbus RTU frame at most */
+#define FRAME_GAP_CHARS_X2 (7) /* 3.5 characters of silence end a frame */
+#define FRAME_GAP_FAST (1750) /* usec; fixed above 19200 baud */
+
+static GstStaticPadTemplate sinktemplate = GST_STATIC_PAD_TEMPLATE("sink",
+								   GST_PAD_SINK,
+								   GST_PAD_ALWAYS,
+								   GST_STATIC_CAPS_ANY);
+
+static GstStaticPadTemplate srctemplate = GST_STATIC_PAD_TEMPLATE("src",
+								  GST_PAD_SRC,
+								  GST_PAD_ALWAYS,
+								  GST_STATIC_CAPS_ANY);
+
+GST_DEBUG_CATEGORY_STATIC(gst_uart_transaction_debug);
+#define GST_CAT_DEFAULT gst_uart_transaction_debug
+
+enum {
+	ARG_0,
+	ARG_DEVICE,
+	ARG_BAUD_RATE,
+	ARG_PARITY,
+	ARG_TIMEOUT,
+	ARG_FRAME_GAP,
+	ARG_MAX_OUTSTANDING,
+	ARG_BLOCKSIZE,
+	ARG_RS485,
+	ARG_RS485_RTS_ON_SEND,
+	ARG_RS485_DELAY_BEFORE,
+	ARG_RS485_DELAY_AFTER,
+	ARG_STATS,
+	ARG_LOW_LATENCY,
+};
+
+/* a request on the wire, waiting for its answer */
+struct request {
+	guint64 seq;
+	GstClockTime pts;
+	GstClockTime dts;
+	GstClockTime sent;	/* monotonic, when its last bit left */
+};
+
+struct _GstUartTransactionPrivate {
+	GstPad *sinkpad;
+	GstPad *srcpad;
+
+	char *device;
+	int baud_rate;
+	enum UartParity parity;
+	guint timeout;
+	guint frame_gap;
+	guint max_outstanding;
+	guint blocksize;
+	struct uart_rs485 rs485;
+	gboolean low_latency;
+
+	struct uart *uart;
+	GstPoll *fdset;
+	GstPollFD pollfd;
+	GQueue pending;		/* struct request, oldest first */
+	guint64 seq;
+	GstClockTime rx_end;	/* monotonic, when the last answer ended */
+
+	/* protected by the object lock */
+	guint64 requests;
+	guint64 responses;
+	guint64 timeouts;
+	GstClockTime latency_min;
+	GstClockTime latency_max;
+	GstClockTime latency_total;
+};
+
+typedef struct _GstUartTransactionPrivate GstUartTransactionPrivate;
+
+#define _do_init							\
+	GST_DEBUG_CATEGORY_INIT (gst_uart_transaction_debug, "uarttransaction", GST_DEBUG_FG_YELLOW | GST_DEBUG_BOLD, "uarttransaction element"); \
+	G_ADD_PRIVATE(GstUartTransaction);
+
+G_DEFINE_TYPE_WITH_CODE(GstUartTransaction, gst_uart_transaction, GST_TYPE_ELEMENT, _do_init);
+
+static void gst_uart_transaction_set_property(GObject * object, guint prop_id,
+					      const GValue * value, GParamSpec * pspec);
+static void gst_uart_transaction_get_property(GObject * object, guint prop_id, GValue * value,
+					      GParamSpec * pspec);
+static void gst_uart_transaction_dispose(GObject * obj);
+static GstStateChangeReturn gst_uart_transaction_change_state(GstElement * element,
+							      GstStateChange transition);
+static GstFlowReturn gst_uart_transaction_chain(GstPad * pad, GstObject * parent,
+						GstBuffer * buffer);
+static gboolean gst_uart_transaction_sink_event(GstPad * pad, GstObject * parent,
+						GstEvent * event);
+static gboolean gst_uart_transaction_sink_activate_mode(GstPad * pad, GstObject * parent,
+							GstPadMode mode, gboolean active);
+
+static void
+gst_uart_transaction_class_init(GstUartTransactionClass * klass)
+{
+	GObjectClass *gobject_class = G_OBJECT_CLASS(klass);
+	GstElementClass *gstelement_class = GST_ELEMENT_CLASS(klass);
+
+	gobject_class->set_property = gst_uart_transaction_set_property;
+	gobject_class->get_property = gst_uart_transaction_get_property;
+	gobject_class->dispose = gst_uart_transaction_dispose;
+
+	gst_element_class_set_static_metadata(gstelement_class, "UART Transaction", "Filter/UART",
+					      "Write requests to a uart / tty and read back the answers",
+					      "Yasushi SHOJI <yashi@spacecubics.com>");
+	gst_element_class_add_static_pad_template(gstelement_class, &sinktemplate);
+	gst_element_class_add_static_pad_template(gstelement_class, &srctemplate);
+
+	gstelement_class->change_state = GST_DEBUG_FUNCPTR(gst_uart_transaction_change_state);
+
+	g_object_class_install_property(gobject_class, ARG_DEVICE,
+					g_param_spec_string("device", "Device",
+							    "UART / tty device to talk to",
+							    "ttyS0",
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BAUD_RATE,
+					g_param_spec_int("baud-rate", "Baud rate",
+							 "baud rate for the device",
+							 50, 4000000, 115200,
+							 G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_PARITY,
+					g_param_spec_string("parity", "Parity",
+							    "Parity checking for the device",
+							    "no",
+							    G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_TIMEOUT,
+					g_param_spec_uint("timeout", "Timeout (msec)",
+							  "Give up on an answer that has not started this many milli sec after its request",
+							  1, G_MAXUINT, DEFAULT_TIMEOUT,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_FRAME_GAP,
+					g_param_spec_uint("frame-gap", "Frame Gap (usec)",
+							  "Silence that ends an answer; 0 for 3.5 characters (1750 usec above 19200 baud)",
+							  0, G_MAXUINT, 0,
+							  G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							  G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_MAX_OUTSTANDING,
+					g_param_spec_uint("max-outstanding", "Max Outstanding",
+							  "Requests sent ahead of their answers",
+							  1, 255, 1,
+							  G_PARAM_READWRITE | GST_PARAM_MUTABLE_PLAYING |
+							  G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_BLOCKSIZE,
+					g_param_spec_uint("blocksize", "Block size",
+							  "Largest answer in bytes",
+							  1, G_MAXUINT, DEFAULT_BLOCKSIZE,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485,
+					g_param_spec_boolean("rs485", "RS-485",
+							     "Half duplex on an RS-485 bus; RTS enables the transmitter",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_RTS_ON_SEND,
+					g_param_spec_boolean("rs485-rts-on-send", "RS-485 RTS On Send",
+							     "RTS is high while sending (and low after), or the other way around",
+							     TRUE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_DELAY_BEFORE,
+					g_param_spec_uint("rs485-delay-before", "RS-485 Delay Before Send (msec)",
+							  "Time from enabling the transmitter to the first bit",
+							  0, 1000, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_RS485_DELAY_AFTER,
+					g_param_spec_uint("rs485-delay-after", "RS-485 Delay After Send (msec)",
+							  "Time from the last bit to disabling the transmitter",
+							  0, 1000, 0,
+							  G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_STATS,
+					g_param_spec_boxed("stats", "Stats",
+							   "Requests, answers and timeouts so far, and the latency (ns) from the end of a request to its answer",
+							   GST_TYPE_STRUCTURE,
+							   G_PARAM_READABLE | G_PARAM_STATIC_STRINGS));
+	g_object_class_install_property(gobject_class, ARG_LOW_LATENCY,
+					g_param_spec_boolean("low-latency", "Low Latency",
+							     "Have the driver hand over data as soon as it comes in "
+							     "(ASYNC_LOW_LATENCY, USB latency timer, FIFO trigger level)",
+							     FALSE,
+							     G_PARAM_READWRITE | G_PARAM_STATIC_STRINGS));
+}
+
+static void
+gst_uart_transaction_init(GstUartTransaction * trans)
+{
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+
+	priv->sinkpad = gst_pad_new_from_static_template(&sinktemplate, "sink");
+	gst_pad_set_chain_function(priv->sinkpad, GST_DEBUG_FUNCPTR(gst_uart_transaction_chain));
+	gst_pad_set_event_function(priv->sinkpad,
+				   GST_DEBUG_FUNCPTR(gst_uart_transaction_sink_event));
+	gst_pad_set_activatemode_function(priv->sinkpad,
+					  GST_DEBUG_FUNCPTR(gst_uart_transaction_sink_activate_mode));
+	GST_PAD_SET_PROXY_CAPS(priv->sinkpad);
+	gst_element_add_pad(GST_ELEMENT(trans), priv->sinkpad);
+
+	priv->srcpad = gst_pad_new_from_static_template(&srctemplate, "src");
+	GST_PAD_SET_PROXY_CAPS(priv->srcpad);
+	gst_element_add_pad(GST_ELEMENT(trans), priv->srcpad);
+
+	priv->device = NULL;
+	priv->baud_rate = 115200;
+	priv->parity = UART_PARITY_NO;
+	priv->timeout = DEFAULT_TIMEOUT;
+	priv->frame_gap = 0;
+	priv->max_outstanding = 1;
+	priv->blocksize = DEFAULT_BLOCKSIZE;
+	priv->rs485.enabled = FALSE;
+	priv->rs485.rts_on_send = TRUE;
+	priv->rs485.delay_before = 0;
+	priv->rs485.delay_after = 0;
+	priv->rs485.rx_during_tx = FALSE;
+	priv->low_latency = FALSE;
+	priv->uart = NULL;
+	priv->fdset = NULL;
+	g_queue_init(&priv->pending);
+	priv->seq = 0;
+	priv->rx_end = 0;
+}
+
+static void
+gst_uart_transaction_dispose(GObject * obj)
+{
+	GstUartTransactionPrivate *priv =
+		gst_uart_transaction_get_instance_private(GST_UART_TRANSACTION(obj));
+
+	if (priv->device) {
+		g_free(priv->device);
+		priv->device = NULL;
+	}
+
+	G_OBJECT_CLASS(gst_uart_transaction_parent_class)->dispose(obj);
+}
+
+static gboolean
+gst_uart_transaction_open(GstUartTransaction * trans)
+{
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+	struct uart_config config;
+	GError *error = NULL;
+
+	if (!priv->device || priv->device[0] == '\0')
+		goto no_device;
+
+	priv->uart = uart_open(priv->device, O_RDWR | O_NONBLOCK);
+	if (!priv->uart)
+		goto open_failed;
+
+	GST_DEBUG_OBJECT(trans, "opened %s as fd %d", priv->device, priv->uart->fd);
+
+	/* uart_open() flushed already */
+	config.baud_rate = priv->baud_rate;
+	config.parity = priv->parity;
+	config.mark_errors = FALSE;
+	if (uart_configure(priv->uart, &config, TCSANOW, &error) < 0)
+		goto setting_failed;
+
+	if (priv->rs485.enabled) {
+		int ret = uart_set_rs485(priv->uart, &priv->rs485);
+
+		if (ret < 0)
+			GST_ELEMENT_WARNING(trans, RESOURCE, SETTINGS,
+					    ("Could not set up RS-485 on \"%s\".", priv->device),
+					    GST_ERROR_SYSTEM);
+		else if (ret > 0)
+			GST_INFO_OBJECT(trans, "no RS-485 in the driver; switching RTS ourselves");
+	}
+	if (priv->low_latency) {
+		struct uart_latency latency;
+
+		if (uart_set_low_latency(priv->uart, TRUE) < 0 && errno != ENOTTY)
+			GST_ELEMENT_WARNING(trans, RESOURCE, SETTINGS,
+					    ("Could not lower the latency of \"%s\".", priv->device),
+					    GST_ERROR_SYSTEM);
+		if (uart_get_latency(priv->uart, &latency) == 0)
+			GST_INFO_OBJECT(trans, "low latency %d, latency timer %d msec, rx trigger %d bytes",
+					latency.low_latency, latency.latency_timer,
+					latency.rx_trig_bytes);
+	}
+
+	priv->fdset = gst_poll_new(TRUE);
+	if (!priv->fdset)
+		goto poll_failed;
+
+	gst_poll_fd_init(&priv->pollfd);
+	priv->pollfd.fd = priv->uart->fd;
+	gst_poll_add_fd(priv->fdset, &priv->pollfd);
+	gst_poll_fd_ctl_read(priv->fdset, &priv->pollfd, TRUE);
+
+	priv->seq = 0;
+	priv->rx_end = 0;
+	GST_OBJECT_LOCK(trans);
+	priv->requests = 0;
+	priv->responses = 0;
+	priv->timeouts = 0;
+	priv->latency_min = GST_CLOCK_TIME_NONE;
+	priv->latency_max = 0;
+	priv->latency_total = 0;
+	GST_OBJECT_UNLOCK(trans);
+
+	return TRUE;
+
+no_device:
+	{
+		GST_ELEMENT_ERROR(trans, RESOURCE, NOT_FOUND,
+				  ("No device name specified for data communication."), (NULL));
+		return FALSE;
+	}
+open_failed:
+	{
+		GST_ELEMENT_ERROR(trans, RESOURCE, OPEN_READ_WRITE,
+				  ("Could not open device \"%s\" for data communication.", priv->device),
+				  GST_ERROR_SYSTEM);
+		return FALSE;
+	}
+setting_failed:
+	{
+		GST_ELEMENT_ERROR(trans, RESOURCE, SETTINGS,
+				  ("%s", error->message), GST_ERROR_SYSTEM);
+		g_clear_error(&error);
+		uart_close(priv->uart);
+		priv->uart = NULL;
+		return FALSE;
+	}
+poll_failed:
+	{
+		GST_ELEMENT_ERROR(trans, RESOURCE, OPEN_READ_WRITE, (NULL),
+				  GST_ERROR_SYSTEM);
+		uart_close(priv->uart);
+		priv->uart = NULL;
+		return FALSE;
+	}
+}
+
+static void
+gst_uart_transaction_close(GstUartTransaction * trans)
+{
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+
+	if (!priv->uart)
+		return;
+
+	g_queue_clear_full(&priv->pending, g_free);
+	gst_poll_free(priv->fdset);
+	priv->fdset = NULL;
+	uart_close(priv->uart);
+	priv->uart = NULL;
+}
+
+static GstStateChangeReturn
+gst_uart_transaction_change_state(GstElement * element, GstStateChange transition)
+{
+	GstUartTransaction *trans = GST_UART_TRANSACTION(element);
+	GstStateChangeReturn ret;
+
+	switch (transition) {
+	case GST_STATE_CHANGE_READY_TO_PAUSED:
+		if (!gst_uart_transaction_open(trans))
+			return GST_STATE_CHANGE_FAILURE;
+		break;
+	default:
+		break;
+	}
+
+	ret = GST_ELEMENT_CLASS(gst_uart_transaction_parent_class)->change_state(element, transition);
+	if (ret == GST_STATE_CHANGE_FAILURE)
+		return ret;
+
+	switch (transition) {
+	case GST_STATE_CHANGE_PAUSED_TO_READY:
+		gst_uart_transaction_close(trans);
+		break;
+	default:
+		break;
+	}
+
+	return ret;
+}
+
+static gboolean
+gst_uart_transaction_sink_activate_mode(GstPad * pad, GstObject * parent, GstPadMode mode,
+					gboolean active)
+{
+	GstUartTransactionPrivate *priv =
+		gst_uart_transaction_get_instance_private(GST_UART_TRANSACTION(parent));
+
+	if (mode != GST_PAD_MODE_PUSH)
+		return FALSE;
+
+	if (priv->fdset)
+		gst_poll_set_flushing(priv->fdset, !active);
+
+	return TRUE;
+}
+
+/* silence that ends an answer */
+static GstClockTime
+gst_uart_transaction_frame_gap(GstUartTransaction * trans)
+{
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+
+	if (priv->frame_gap)
+		return priv->frame_gap * GST_USECOND;
+	if (uart_termios_baud_rate(&priv->uart->current) > 19200)
+		return FRAME_GAP_FAST * GST_USECOND;
+
+	return uart_wire_time(priv->uart, FRAME_GAP_CHARS_X2) / 2;
+}
+
+static GstFlowReturn
+gst_uart_transaction_send(GstUartTransaction * trans, GstBuffer * buffer)
+{
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+	struct request *request;
+	GstFlowReturn flow = GST_FLOW_OK;
+	GstMapInfo info;
+	gsize offset = 0;
+	gsize size;
+	int queued;
+
+	/* nothing is expected; whatever came in is stale */
+	if (g_queue_is_empty(&priv->pending))
+		uart_flush_input(priv->uart);
+
+	gst_buffer_map(buffer, &info, GST_MAP_READ);
+	size = info.size;
+	uart_rs485_begin(priv->uart);
+	while (offset < size) {
+		gssize written = write(priv->uart->fd, info.data + offset, size - offset);
+
+		if (written >= 0) {
+			offset += written;
+			continue;
+		}
+		if (errno == EINTR)
+			continue;
+		if (errno == EAGAIN) {
+			gint ret;
+
+			/* answers to earlier requests may be coming in; not now */
+			gst_poll_fd_ctl_read(priv->fdset, &priv->pollfd, FALSE);
+			gst_poll_fd_ctl_write(priv->fdset, &priv->pollfd, TRUE);
+			ret = gst_poll_wait(priv->fdset, GST_CLOCK_TIME_NONE);
+			gst_poll_fd_ctl_write(priv->fdset, &priv->pollfd, FALSE);
+			gst_poll_fd_ctl_read(priv->fdset, &priv->pollfd, TRUE);
+			if (ret < 0 && errno == EBUSY) {
+				flow = GST_FLOW_FLUSHING;
+				break;
+			}
+			continue;
+		}
+		GST_ELEMENT_ERROR(trans, RESOURCE, WRITE,
+				  ("Could not write to device \"%s\".", priv->device),
+				  GST_ERROR_SYSTEM);
+		flow = GST_FLOW_ERROR;
+		break;
+	}
+	gst_buffer_unmap(buffer, &info);
+	/* turn the bus around as soon as the last bit is out, or give it up */
+	uart_rs485_end(priv->uart);
+	if (flow != GST_FLOW_OK)
+		return flow;
+
+	queued = MAX(uart_get_output_queue(priv->uart), 0);
+	request = g_new(struct request, 1);
+	request->seq = priv->seq++;
+	request->pts = GST_BUFFER_PTS(buffer);
+	request->dts = GST_BUFFER_DTS(buffer);
+	request->sent = g_get_monotonic_time() * GST_USECOND + uart_wire_time(priv->uart, queued);
+	g_queue_push_tail(&priv->pending, request);
+	GST_OBJECT_LOCK(trans);
+	priv->requests++;
+	GST_OBJECT_UNLOCK(trans);
+
+	GST_LOG_OBJECT(trans, "request %" G_GUINT64_FORMAT ": %" G_GSIZE_FORMAT " bytes",
+		       request->seq, size);
+
+	return GST_FLOW_OK;
+}
+
+/* the oldest request got no answer */
+static void
+gst_uart_transaction_timeout(GstUartTransaction * trans)
+{
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+	struct request *request = g_queue_pop_head(&priv->pending);
+
+	GST_WARNING_OBJECT(trans, "no answer to request %" G_GUINT64_FORMAT, request->seq);
+	GST_OBJECT_LOCK(trans);
+	priv->timeouts++;
+	GST_OBJECT_UNLOCK(trans);
+	gst_element_post_message(GST_ELEMENT(trans),
+				 gst_message_new_element(GST_OBJECT(trans),
+							 gst_structure_new("uart-transaction-timeout",
+									   "seq", G_TYPE_UINT64, request->seq,
+									   NULL)));
+	priv->rx_end = g_get_monotonic_time() * GST_USECOND;
+	g_free(request);
+}
+
+/*
+ * Read the answer to the oldest request and push it.  It ends at
+ * frame-gap of silence; nothing within timeout of the request leaving
+ * (or of the answer before, if it came later) times the request out.
+ * Without block, only an answer already coming in is read.
+ */
+static GstFlowReturn
+gst_uart_transaction_receive(GstUartTransaction * trans, gboolean block)
+{
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+	struct request *request = g_queue_peek_head(&priv->pending);
+	GstClockTime gap, deadline, latency;
+	GstClockTime first = GST_CLOCK_TIME_NONE;
+	GstBuffer *buffer;
+	GstMapInfo info;
+	gsize offset = 0;
+
+	if (!request)
+		return GST_FLOW_OK;
+
+	gap = gst_uart_transaction_frame_gap(trans);
+	deadline = MAX(request->sent, priv->rx_end) + priv->timeout * GST_MSECOND;
+	buffer = gst_buffer_new_allocate(NULL, priv->blocksize, NULL);
+	gst_buffer_map(buffer, &info, GST_MAP_WRITE);
+
+	while (offset < info.size) {
+		GstClockTime now = g_get_monotonic_time() * GST_USECOND;
+		GstClockTime wait;
+		gssize red;
+		gint ret;
+
+		if (offset)
+			wait = gap;
+		else if (!block)
+			wait = 0;
+		else
+			wait = deadline > now ? deadline - now : 0;
+
+		ret = gst_poll_wait(priv->fdset, wait);
+		if (ret < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			gst_buffer_unmap(buffer, &info);
+			gst_buffer_unref(buffer);
+			if (errno == EBUSY)
+				return GST_FLOW_FLUSHING;
+			GST_ELEMENT_ERROR(trans, RESOURCE, READ, (NULL), GST_ERROR_SYSTEM);
+			return GST_FLOW_ERROR;
+		}
+		if (ret == 0)
+			break;
+
+		red = read(priv->uart->fd, info.data + offset, info.size - offset);
+		if (red < 0 && (errno == EAGAIN || errno == EINTR))
+			continue;
+		if (red <= 0) {
+			gst_buffer_unmap(buffer, &info);
+			gst_buffer_unref(buffer);
+			GST_ELEMENT_ERROR(trans, RESOURCE, READ,
+					  ("Could not read from device \"%s\".", priv->device),
+					  GST_ERROR_SYSTEM);
+			return GST_FLOW_ERROR;
+		}
+		if (!offset)
+			first = g_get_monotonic_time() * GST_USECOND - uart_wire_time(priv->uart, red);
+		offset += red;
+	}
+	gst_buffer_unmap(buffer, &info);
+
+	if (!offset) {
+		gst_buffer_unref(buffer);
+		if (block)
+			gst_uart_transaction_timeout(trans);
+		return GST_FLOW_OK;
+	}
+
+	priv->rx_end = g_get_monotonic_time() * GST_USECOND;
+	latency = first > request->sent ? first - request->sent : 0;
+	GST_OBJECT_LOCK(trans);
+	priv->responses++;
+	priv->latency_total += latency;
+	if (!GST_CLOCK_TIME_IS_VALID(priv->latency_min) || latency < priv->latency_min)
+		priv->latency_min = latency;
+	if (latency > priv->latency_max)
+		priv->latency_max = latency;
+	GST_OBJECT_UNLOCK(trans);
+
+	gst_buffer_set_size(buffer, offset);
+	GST_BUFFER_PTS(buffer) = request->pts;
+	GST_BUFFER_DTS(buffer) = request->dts;
+	GST_BUFFER_OFFSET(buffer) = request->seq;
+	GST_DEBUG_OBJECT(trans, "answer to %" G_GUINT64_FORMAT ": %" G_GSIZE_FORMAT
+			 " bytes, %" GST_TIME_FORMAT " after the request",
+			 request->seq, offset, GST_TIME_ARGS(latency));
+	g_free(g_queue_pop_head(&priv->pending));
+
+	return gst_pad_push(priv->srcpad, buffer);
+}
+
+static GstFlowReturn
+gst_uart_transaction_chain(GstPad * pad, GstObject * parent, GstBuffer * buffer)
+{
+	GstUartTransaction *trans = GST_UART_TRANSACTION(parent);
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+	GstFlowReturn flow;
+	guint n;
+
+	flow = gst_uart_transaction_send(trans, buffer);
+	gst_buffer_unref(buffer);
+
+	while (flow == GST_FLOW_OK && g_queue_get_length(&priv->pending) >= priv->max_outstanding)
+		flow = gst_uart_transaction_receive(trans, TRUE);
+
+	/* answers already coming in go now, not with the next request */
+	do {
+		n = g_queue_get_length(&priv->pending);
+		if (flow == GST_FLOW_OK)
+			flow = gst_uart_transaction_receive(trans, FALSE);
+	} while (flow == GST_FLOW_OK && n && g_queue_get_length(&priv->pending) < n);
+
+	return flow;
+}
+
+static gboolean
+gst_uart_transaction_sink_event(GstPad * pad, GstObject * parent, GstEvent * event)
+{
+	GstUartTransaction *trans = GST_UART_TRANSACTION(parent);
+	GstUartTransactionPrivate *priv = gst_uart_transaction_get_instance_private(trans);
+
+	GST_DEBUG_OBJECT(pad, "%s", GST_EVENT_TYPE_NAME(event));
+
+	switch (GST_EVENT_TYPE(event)) {
+	case GST_EVENT_FLUSH_START:
+		gst_poll_set_flushing(priv->fdset, TRUE);
+		break;
+	case GST_EVENT_FLUSH_STOP:
+		g_queue_clear_full(&priv->pending, g_free);
+		uart_flush_input(priv->uart);
+		gst_poll_set_flushing(priv->fdset, FALSE);
+		break;
+	case GST_EVENT_EOS:
+		/* the last answers before EOS */
+		while (!g_queue_is_empty(&priv->pending) &&
+		       gst_uart_transaction_receive(trans, TRUE) == GST_FLOW_OK)
+			;
+		break;
+	default:
+		break;
+	}
+
+	return gst_pad_event_default(pad, parent, event);
+}
+
+static void
+gst_uart_transaction_set_property(GObject * object, guint prop_id, const GValue * value,
+				  GParamSpec * pspec)
+{
+	GstUartTransaction *trans;
+	GstUartTransactionPrivate *priv;
+
+	trans = GST_UART_TRANSACTION(object);
+	priv = gst_uart_transaction_get_instance_private(trans);
+
+	switch (prop_id) {
+	case ARG_DEVICE:
+		g_free(priv->device);
+		priv->device = g_value_dup_string(value);
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), priv->device);
+		break;
+
+	case ARG_BAUD_RATE:
+		priv->baud_rate = g_value_get_int(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->baud_rate);
+		break;
+
+	case ARG_PARITY:
+	{
+		const char *s = g_value_get_string(value);
+		if (!uart_parity_from_string(s, &priv->parity))
+			GST_WARNING_OBJECT(trans, "unknown parity \"%s\"", s);
+
+		GST_INFO("setting property \'%s\' to \"%s\"", g_param_spec_get_name(pspec), s);
+		break;
+	}
+	case ARG_TIMEOUT:
+		priv->timeout = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->timeout);
+		break;
+
+	case ARG_FRAME_GAP:
+		priv->frame_gap = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->frame_gap);
+		break;
+
+	case ARG_MAX_OUTSTANDING:
+		priv->max_outstanding = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->max_outstanding);
+		break;
+
+	case ARG_BLOCKSIZE:
+		priv->blocksize = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->blocksize);
+		break;
+
+	case ARG_RS485:
+		priv->rs485.enabled = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->rs485.enabled);
+		break;
+
+	case ARG_RS485_RTS_ON_SEND:
+		priv->rs485.rts_on_send = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->rs485.rts_on_send);
+		break;
+
+	case ARG_RS485_DELAY_BEFORE:
+		priv->rs485.delay_before = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->rs485.delay_before);
+		break;
+
+	case ARG_RS485_DELAY_AFTER:
+		priv->rs485.delay_after = g_value_get_uint(value);
+		GST_INFO("setting property \'%s\' to %u", g_param_spec_get_name(pspec), priv->rs485.delay_after);
+		break;
+
+	case ARG_LOW_LATENCY:
+		priv->low_latency = g_value_get_boolean(value);
+		GST_INFO("setting property \'%s\' to %d", g_param_spec_get_name(pspec), priv->low_latency);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		break;
+	}
+}
+
+static void
+gst_uart_transaction_get_property(GObject * object, guint prop_id, GValue * value,
+				  GParamSpec * pspec)
+{
+	GstUartTransaction *trans;
+	GstUartTransactionPrivate *priv;
+
+	trans = GST_UART_TRANSACTION(object);
+	priv = gst_uart_transaction_get_instance_private(trans);
+
+	switch (prop_id) {
+	case ARG_DEVICE:
+		g_value_set_string(value, priv->device);
+		break;
+
+	case ARG_BAUD_RATE:
+		g_value_set_int(value, priv->baud_rate);
+		break;
+
+	case ARG_PARITY:
+		g_value_set_string(value, uart_parity_to_string(priv->parity));
+		break;
+
+	case ARG_TIMEOUT:
+		g_value_set_uint(value, priv->timeout);
+		break;
+
+	case ARG_FRAME_GAP:
+		g_value_set_uint(value, priv->frame_gap);
+		break;
+
+	case ARG_MAX_OUTSTANDING:
+		g_value_set_uint(value, priv->max_outstanding);
+		break;
+
+	case ARG_BLOCKSIZE:
+		g_value_set_uint(value, priv->blocksize);
+		break;
+
+	case ARG_RS485:
+		g_value_set_boolean(value, priv->rs485.enabled);
+		break;
+
+	case ARG_RS485_RTS_ON_SEND:
+		g_value_set_boolean(value, priv->rs485.rts_on_send);
+		break;
+
+	case ARG_RS485_DELAY_BEFORE:
+		g_value_set_uint(value, priv->rs485.delay_before);
+		break;
+
+	case ARG_RS485_DELAY_AFTER:
+		g_value_set_uint(value, priv->rs485.delay_after);
+		break;
+
+	case ARG_LOW_LATENCY:
+		g_value_set_boolean(value, priv->low_latency);
+		break;
+
+	case ARG_STATS:
+		GST_OBJECT_LOCK(trans);
+		g_value_take_boxed(value,
+				   gst_structure_new("uart-transaction-stats",
+						     "requests", G_TYPE_UINT64, priv->requests,
+						     "responses", G_TYPE_UINT64, priv->responses,
+						     "timeouts", G_TYPE_UINT64, priv->timeouts,
+						     "latency-min", G_TYPE_UINT64,
+						     GST_CLOCK_TIME_IS_VALID(priv->latency_min) ?
+						     priv->latency_min : 0,
+						     "latency-max", G_TYPE_UINT64, priv->latency_max,
+						     "latency-avg", G_TYPE_UINT64,
+						     priv->responses ? priv->latency_total / priv->responses : 0,
+						     NULL));
+		GST_OBJECT_UNLOCK(trans);
+		break;
+
+	default:
+		G_OBJECT_WARN_INVALID_PROPERTY_ID(object, prop_id, pspec);
+		break;
+	}
+}
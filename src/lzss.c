@@ -0,0 +1,391 @@
+#include <string.h>
+#include <glib.h>
+#include "lzss.h"
+
+struct bit_writer {
+	guint8 *out;
+	gsize max;
+	gsize pos;
+	guint32 acc;
+	guint n;
+	gboolean overflow;
+};
+
+struct bit_reader {
+	const guint8 *in;
+	gsize len;
+	gsize pos;
+	guint32 acc;
+	guint n;
+};
+
+static void put_bits(struct bit_writer *bw, guint32 value, guint bits)
+{
+	bw->acc = (bw->acc << bits) | value;
+	bw->n += bits;
+	while (bw->n >= 8) {
+		bw->n -= 8;
+		if (bw->pos < bw->max)
+			bw->out[bw->pos++] = bw->acc >> bw->n;
+		else
+			bw->overflow = TRUE;
+	}
+	bw->acc &= (1 << bw->n) - 1;
+}
+
+static void flush_bits(struct bit_writer *bw)
+{
+	if (bw->n)
+		put_bits(bw, 0, 8 - bw->n);
+}
+
+static gboolean get_bits(struct bit_reader *br, guint bits, guint32 *value)
+{
+	while (br->n < bits) {
+		if (br->pos == br->len)
+			return FALSE;
+		br->acc = (br->acc << 8) | br->in[br->pos++];
+		br->n += 8;
+	}
+	br->n -= bits;
+	*value = (br->acc >> br->n) & ((1 << bits) - 1);
+	br->acc &= (1 << br->n) - 1;
+	return TRUE;
+}
+
+/* a back reference shorter than this costs more than the literals */
+static guint min_match(const struct lzss *lzss)
+{
+	return (1 + lzss->window_bits + lzss->lookahead_bits) / 9 + 1;
+}
+
+static guint16 crc16(const guint8 *data, gsize len)
+{
+	guint16 crc = 0xffff;
+	gsize i;
+	int bit;
+
+	for (i = 0; i < len; i++) {
+		crc ^= data[i] << 8;
+		for (bit = 0; bit < 8; bit++)
+			crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+void lzss_init(struct lzss *lzss, guint window_bits, guint lookahead_bits)
+{
+	lzss->window_bits = CLAMP(window_bits, LZSS_WINDOW_BITS_MIN, LZSS_WINDOW_BITS_MAX);
+	lzss->lookahead_bits = CLAMP(lookahead_bits, LZSS_LOOKAHEAD_BITS_MIN, LZSS_LOOKAHEAD_BITS_MAX);
+	lzss->history = g_malloc(1 << LZSS_WINDOW_BITS_MAX);
+	lzss->fill = 0;
+	lzss->blocks = 0;
+	lzss->stored = 0;
+	lzss->raw = 0;
+	lzss->wire = 0;
+	lzss->errors = 0;
+}
+
+void lzss_clear(struct lzss *lzss)
+{
+	g_clear_pointer(&lzss->history, g_free);
+}
+
+/* forget the dictionary */
+void lzss_reset(struct lzss *lzss)
+{
+	lzss->fill = 0;
+}
+
+/* buf holds fill bytes of history and then the block; keep its tail */
+static void lzss_remember(struct lzss *lzss, const guint8 *buf, gsize len)
+{
+	gsize window = 1 << lzss->window_bits;
+	gsize keep = MIN(len, window);
+
+	memcpy(lzss->history, buf + len - keep, keep);
+	lzss->fill = keep;
+}
+
+/* add len bytes to the dictionary */
+static void lzss_append(struct lzss *lzss, const guint8 *data, gsize len)
+{
+	gsize window = 1 << lzss->window_bits;
+	gsize keep;
+
+	if (len >= window) {
+		memcpy(lzss->history, data + len - window, window);
+		lzss->fill = window;
+		return;
+	}
+	keep = MIN(lzss->fill, window - len);
+	memmove(lzss->history, lzss->history + lzss->fill - keep, keep);
+	memcpy(lzss->history + keep, data, len);
+	lzss->fill = keep + len;
+}
+
+/*
+ * Compress len bytes into at most max; 0 if they do not fit.  The
+ * bytes go into the dictionary either way, as the receiver puts a
+ * stored block there too.
+ */
+gsize lzss_compress(struct lzss *lzss, const guint8 *in, gsize len, guint8 *out, gsize max)
+{
+	struct bit_writer bw = { out, max, 0, 0, 0, FALSE };
+	gsize window = 1 << lzss->window_bits;
+	gsize longest = (1 << lzss->lookahead_bits) - 1 + min_match(lzss);
+	gsize pos, end;
+	guint8 *buf;
+
+	buf = g_malloc(lzss->fill + len);
+	memcpy(buf, lzss->history, lzss->fill);
+	memcpy(buf + lzss->fill, in, len);
+	pos = lzss->fill;
+	end = lzss->fill + len;
+
+	while (pos < end && !bw.overflow) {
+		gsize start = pos > window ? pos - window : 0;
+		gsize limit = MIN(longest, end - pos);
+		gsize best_len = 0;
+		gsize best_off = 0;
+		gsize i;
+
+		/* nearest first; a match may run into the bytes it copies */
+		for (i = pos; i-- > start;) {
+			gsize n = 0;
+
+			while (n < limit && buf[i + n] == buf[pos + n])
+				n++;
+			if (n > best_len) {
+				best_len = n;
+				best_off = pos - i;
+				if (n == limit)
+					break;
+			}
+		}
+
+		if (best_len >= min_match(lzss)) {
+			put_bits(&bw, 0, 1);
+			put_bits(&bw, best_off - 1, lzss->window_bits);
+			put_bits(&bw, best_len - min_match(lzss), lzss->lookahead_bits);
+			pos += best_len;
+		}
+		else {
+			put_bits(&bw, 1, 1);
+			put_bits(&bw, buf[pos], 8);
+			pos++;
+		}
+	}
+	flush_bits(&bw);
+
+	lzss_remember(lzss, buf, end);
+	g_free(buf);
+
+	return bw.overflow ? 0 : bw.pos;
+}
+
+/* Expand in to exactly raw bytes; -1 if it does not make sense. */
+gssize lzss_decompress(struct lzss *lzss, const guint8 *in, gsize len, guint8 *out, gsize raw)
+{
+	struct bit_reader br = { in, len, 0, 0, 0 };
+	gsize pos, end;
+	guint8 *buf;
+
+	buf = g_malloc(lzss->fill + raw);
+	memcpy(buf, lzss->history, lzss->fill);
+	pos = lzss->fill;
+	end = lzss->fill + raw;
+
+	while (pos < end) {
+		guint32 literal, off, n;
+
+		if (!get_bits(&br, 1, &literal))
+			goto corrupt;
+		if (literal) {
+			if (!get_bits(&br, 8, &literal))
+				goto corrupt;
+			buf[pos++] = literal;
+			continue;
+		}
+		if (!get_bits(&br, lzss->window_bits, &off) ||
+		    !get_bits(&br, lzss->lookahead_bits, &n))
+			goto corrupt;
+		off += 1;
+		n += min_match(lzss);
+		if (off > pos || n > end - pos)
+			goto corrupt;
+		for (; n; n--, pos++)
+			buf[pos] = buf[pos - off];
+	}
+
+	memcpy(out, buf + lzss->fill, raw);
+	lzss_remember(lzss, buf, end);
+	g_free(buf);
+
+	return raw;
+
+corrupt:
+	g_free(buf);
+	return -1;
+}
+
+/*
+ * Put len (up to LZSS_BLOCK_MAX) bytes into a block in out, which has
+ * room for LZSS_BLOCK_BOUND(len).  Returns the size of the block.
+ */
+gsize lzss_block_pack(struct lzss *lzss, const guint8 *in, gsize len, gboolean reset,
+		      guint8 *out)
+{
+	guint8 flags = reset ? LZSS_FLAG_RESET : 0;
+	gsize size;
+	guint16 crc;
+
+	g_return_val_if_fail(len <= LZSS_BLOCK_MAX, 0);
+
+	if (reset)
+		lzss_reset(lzss);
+	/* only worth it if it comes out smaller */
+	size = lzss_compress(lzss, in, len, out + LZSS_BLOCK_HEADER, len ? len - 1 : 0);
+	if (size)
+		flags |= LZSS_FLAG_COMPRESSED;
+	else {
+		memcpy(out + LZSS_BLOCK_HEADER, in, len);
+		size = len;
+		lzss->stored++;
+	}
+
+	out[0] = LZSS_SYNC;
+	out[1] = flags;
+	out[2] = lzss->window_bits << 4 | lzss->lookahead_bits;
+	out[3] = len >> 8;
+	out[4] = len;
+	out[5] = size >> 8;
+	out[6] = size;
+	crc = crc16(out + 1, LZSS_BLOCK_HEADER - 1 + size);
+	out[LZSS_BLOCK_HEADER + size] = crc >> 8;
+	out[LZSS_BLOCK_HEADER + size + 1] = crc;
+	size += LZSS_BLOCK_HEADER + LZSS_BLOCK_TRAILER;
+
+	lzss->blocks++;
+	lzss->raw += len;
+	lzss->wire += size;
+
+	return size;
+}
+
+void lzss_unpacker_init(struct lzss_unpacker *unpacker)
+{
+	lzss_init(&unpacker->lzss, LZSS_WINDOW_BITS_MIN, LZSS_LOOKAHEAD_BITS_MIN);
+	unpacker->in = g_byte_array_new();
+	unpacker->synced = FALSE;
+}
+
+void lzss_unpacker_clear(struct lzss_unpacker *unpacker)
+{
+	lzss_clear(&unpacker->lzss);
+	g_clear_pointer(&unpacker->in, g_byte_array_unref);
+}
+
+/* start over; call when the stream (re)starts */
+void lzss_unpacker_reset(struct lzss_unpacker *unpacker)
+{
+	lzss_reset(&unpacker->lzss);
+	g_byte_array_set_size(unpacker->in, 0);
+	unpacker->synced = FALSE;
+	unpacker->lzss.blocks = 0;
+	unpacker->lzss.stored = 0;
+	unpacker->lzss.raw = 0;
+	unpacker->lzss.wire = 0;
+	unpacker->lzss.errors = 0;
+}
+
+/* hunt for the next block after a bad one */
+static void lzss_unpacker_skip(struct lzss_unpacker *unpacker)
+{
+	g_byte_array_remove_range(unpacker->in, 0, 1);
+	if (unpacker->synced)
+		unpacker->lzss.errors++;
+	unpacker->synced = FALSE;
+}
+
+/* Take len bytes off the wire and append what they decode to out. */
+void lzss_unpack(struct lzss_unpacker *unpacker, const guint8 *data, gsize len, GByteArray *out)
+{
+	struct lzss *lzss = &unpacker->lzss;
+	GByteArray *in = unpacker->in;
+
+	g_byte_array_append(in, data, len);
+
+	while (in->len) {
+		guint window_bits, lookahead_bits;
+		gsize raw, size, total;
+		guint8 flags;
+		guint16 crc;
+		guint8 *sync;
+
+		sync = memchr(in->data, LZSS_SYNC, in->len);
+		if (!sync) {
+			g_byte_array_set_size(in, 0);
+			break;
+		}
+		g_byte_array_remove_range(in, 0, sync - in->data);
+		if (in->len < LZSS_BLOCK_HEADER)
+			break;
+
+		flags = in->data[1];
+		window_bits = in->data[2] >> 4;
+		lookahead_bits = in->data[2] & 0xf;
+		raw = in->data[3] << 8 | in->data[4];
+		size = in->data[5] << 8 | in->data[6];
+		if ((flags & ~(LZSS_FLAG_COMPRESSED | LZSS_FLAG_RESET)) ||
+		    window_bits < LZSS_WINDOW_BITS_MIN || window_bits > LZSS_WINDOW_BITS_MAX ||
+		    lookahead_bits < LZSS_LOOKAHEAD_BITS_MIN ||
+		    lookahead_bits > LZSS_LOOKAHEAD_BITS_MAX ||
+		    (!(flags & LZSS_FLAG_COMPRESSED) && size != raw)) {
+			lzss_unpacker_skip(unpacker);
+			continue;
+		}
+		total = LZSS_BLOCK_HEADER + size + LZSS_BLOCK_TRAILER;
+		if (in->len < total)
+			break;
+		crc = in->data[total - 2] << 8 | in->data[total - 1];
+		if (crc != crc16(in->data + 1, LZSS_BLOCK_HEADER - 1 + size)) {
+			lzss_unpacker_skip(unpacker);
+			continue;
+		}
+
+		if (flags & LZSS_FLAG_RESET) {
+			lzss->window_bits = window_bits;
+			lzss->lookahead_bits = lookahead_bits;
+			lzss_reset(lzss);
+			unpacker->synced = TRUE;
+		}
+		else if (window_bits != lzss->window_bits || lookahead_bits != lzss->lookahead_bits)
+			unpacker->synced = FALSE;
+
+		if (!(flags & LZSS_FLAG_COMPRESSED)) {
+			/* good data either way; the dictionary only if synced */
+			g_byte_array_append(out, in->data + LZSS_BLOCK_HEADER, raw);
+			lzss_append(lzss, in->data + LZSS_BLOCK_HEADER, raw);
+			lzss->stored++;
+		}
+		else if (unpacker->synced) {
+			gsize at = out->len;
+
+			g_byte_array_set_size(out, at + raw);
+			if (lzss_decompress(lzss, in->data + LZSS_BLOCK_HEADER, size,
+					    out->data + at, raw) < 0) {
+				g_byte_array_set_size(out, at);
+				unpacker->synced = FALSE;
+				lzss->errors++;
+			}
+		}
+		else
+			lzss->errors++;
+
+		lzss->blocks++;
+		lzss->raw += raw;
+		lzss->wire += total;
+		g_byte_array_remove_range(in, 0, total);
+	}
+}
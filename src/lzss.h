@@ -0,0 +1,71 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+ * LZSS link compression, heatshrink style so a small MCU can take the
+ * other end: a literal is a 1 bit and the byte, a back reference a 0
+ * bit, the distance (window_bits) and the length (lookahead_bits).
+ *
+ * On the wire data goes in blocks:
+ *
+ *   0     LZSS_SYNC
+ *   1     flags, LZSS_FLAG_*
+ *   2     window_bits << 4 | lookahead_bits
+ *   3-4   length before compression, big endian
+ *   5-6   payload length, big endian
+ *   7-    payload
+ *   last  CRC-16/CCITT of bytes 1 to the end of the payload, big endian
+ *
+ * The dictionary carries over from block to block until one comes with
+ * LZSS_FLAG_RESET.  A receiver that lost a block waits for the next
+ * reset; the header tells it the parameters.
+ */
+#define LZSS_SYNC (0xa5)
+#define LZSS_FLAG_COMPRESSED (0x80)	/* otherwise stored as is */
+#define LZSS_FLAG_RESET (0x40)		/* forget the dictionary first */
+#define LZSS_BLOCK_HEADER (7)
+#define LZSS_BLOCK_TRAILER (2)
+#define LZSS_BLOCK_MAX (65535)
+#define LZSS_WINDOW_BITS_MIN (8)
+#define LZSS_WINDOW_BITS_MAX (12)
+#define LZSS_LOOKAHEAD_BITS_MIN (3)
+#define LZSS_LOOKAHEAD_BITS_MAX (8)
+
+/* worst case size of a block for len bytes */
+#define LZSS_BLOCK_BOUND(len) (LZSS_BLOCK_HEADER + (len) + LZSS_BLOCK_TRAILER)
+
+struct lzss {
+	guint window_bits;
+	guint lookahead_bits;
+	guint8 *history;	/* the last 1 << window_bits bytes */
+	gsize fill;
+
+	guint64 blocks;
+	guint64 stored;		/* blocks that did not compress */
+	guint64 raw;		/* bytes */
+	guint64 wire;		/* bytes, headers included */
+	guint64 errors;		/* blocks lost, on the receiving side */
+};
+
+/* receiving side: blocks come in pieces */
+struct lzss_unpacker {
+	struct lzss lzss;
+	GByteArray *in;
+	gboolean synced;	/* our dictionary is the sender's */
+};
+
+void lzss_init(struct lzss *lzss, guint window_bits, guint lookahead_bits);
+void lzss_clear(struct lzss *lzss);
+void lzss_reset(struct lzss *lzss);
+
+gsize lzss_compress(struct lzss *lzss, const guint8 *in, gsize len, guint8 *out, gsize max);
+gssize lzss_decompress(struct lzss *lzss, const guint8 *in, gsize len, guint8 *out, gsize raw);
+
+gsize lzss_block_pack(struct lzss *lzss, const guint8 *in, gsize len, gboolean reset,
+		      guint8 *out);
+
+void lzss_unpacker_init(struct lzss_unpacker *unpacker);
+void lzss_unpacker_clear(struct lzss_unpacker *unpacker);
+void lzss_unpacker_reset(struct lzss_unpacker *unpacker);
+void lzss_unpack(struct lzss_unpacker *unpacker, const guint8 *data, gsize len, GByteArray *out);
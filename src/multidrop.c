@@ -0,0 +1,82 @@
+#include <string.h>
+#include <glib.h>
+#include "multidrop.h"
+
+void multidrop_init(struct multidrop *md)
+{
+	multidrop_clear_filter(md);
+	multidrop_reset(md);
+}
+
+/* start over, e.g. on a new connection; the filter stays */
+void multidrop_reset(struct multidrop *md)
+{
+	parmrk_escape_reset(&md->esc);
+	/* whose the data before the first address is, we can't tell */
+	md->passing = !md->filtering;
+	md->frames = 0;
+	md->passed = 0;
+	md->dropped = 0;
+}
+
+void multidrop_clear_filter(struct multidrop *md)
+{
+	memset(md->filter, 0, sizeof(md->filter));
+	md->filtering = FALSE;
+}
+
+void multidrop_add_address(struct multidrop *md, guint8 address)
+{
+	md->filter[address / 32] |= 1u << (address % 32);
+	md->filtering = TRUE;
+}
+
+static gboolean multidrop_wanted(const struct multidrop *md, guint8 address)
+{
+	return !md->filtering || md->filter[address / 32] & 1u << (address % 32);
+}
+
+static void multidrop_put(struct multidrop *md, guint8 *data, gsize *n, guint8 c)
+{
+	if (md->passing)
+		data[(*n)++] = c;
+	else
+		md->dropped++;
+}
+
+/*
+ * Decode the len bytes at data in place, marks stripped and frames for
+ * other nodes dropped; returns how many bytes are left.  A frame for us
+ * ends what we have so far (started says there is some from before):
+ * we stop at its address and *used tells how far we got.  Hand the rest
+ * in again for the next buffer.
+ */
+gsize multidrop_unpack(struct multidrop *md, guint8 *data, gsize len, gboolean started, gsize *used)
+{
+	gsize n = 0;
+	gsize i;
+	int out;
+
+	for (i = 0; i < len; i++) {
+		guint8 c = data[i];
+
+		if (md->esc.state == PARMRK_MARK && multidrop_wanted(md, c) && (n || started))
+			break;
+
+		out = parmrk_escape_next(&md->esc, c);
+		if (out < 0)
+			continue;
+		if (out & PARMRK_MARKED) {
+			md->passing = multidrop_wanted(md, c);
+			md->frames++;
+			if (md->passing)
+				md->passed++;
+		}
+		multidrop_put(md, data, &n, out);
+	}
+	if (n < i && (out = parmrk_escape_release(&md->esc)) >= 0)
+		multidrop_put(md, data, &n, out);
+	*used = i;
+
+	return n;
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glib.h>
+#include "parmrk.h"
+
+/*
+ * 9-bit multidrop receive.  Received with space parity and PARMRK, the
+ * 9th bit of an address byte is a parity error, so the driver hands it
+ * over as 0xff 0x00 address; a 0xff data byte comes as 0xff 0xff.  A
+ * frame is an address byte and the data up to the next one.
+ */
+struct multidrop {
+	guint32 filter[256 / 32];	/* addresses to pass, a bit each */
+	gboolean filtering;	/* FALSE passes every frame */
+	struct parmrk_escape esc;	/* a mark is an address */
+	gboolean passing;	/* the frame we are in goes out */
+
+	guint64 frames;
+	guint64 passed;		/* frames */
+	guint64 dropped;	/* bytes */
+};
+
+void multidrop_init(struct multidrop *md);
+void multidrop_reset(struct multidrop *md);
+void multidrop_clear_filter(struct multidrop *md);
+void multidrop_add_address(struct multidrop *md, guint8 address);
+gsize multidrop_unpack(struct multidrop *md, guint8 *data, gsize len, gboolean started, gsize *used);
@@ -0,0 +1,155 @@
+#include <string.h>
+#include <glib.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "parmrk.h"
+
+void parmrk_init(struct parmrk *parmrk)
+{
+	parmrk_reset(parmrk);
+}
+
+void parmrk_reset(struct parmrk *parmrk)
+{
+	parmrk_escape_reset(&parmrk->esc);
+	parmrk->errors = 0;
+}
+
+void parmrk_escape_reset(struct parmrk_escape *esc)
+{
+	esc->state = PARMRK_DATA;
+	esc->holding = FALSE;
+}
+
+/*
+ * Feed the next byte, c, and get the next one out, or'ed with
+ * PARMRK_MARKED after a mark, or -1 if there is none yet.  Never more
+ * out than in, so the output can overwrite the input.
+ */
+int parmrk_escape_next(struct parmrk_escape *esc, guint8 c)
+{
+	int out = -1;
+
+	switch (esc->state) {
+	case PARMRK_ESCAPE:
+		esc->state = PARMRK_DATA;
+		if (c == 0x00) {
+			esc->state = PARMRK_MARK;
+			break;
+		}
+		if (c == 0xff) {
+			out = 0xff;
+			break;
+		}
+		/* without PARMRK a lone 0xff is just data; c comes next time */
+		esc->holding = TRUE;
+		esc->held = c;
+		return 0xff;
+	case PARMRK_MARK:
+		esc->state = PARMRK_DATA;
+		out = c | PARMRK_MARKED;
+		break;
+	case PARMRK_DATA:
+	default:
+		if (c == 0xff)
+			esc->state = PARMRK_ESCAPE;
+		else
+			out = c;
+		break;
+	}
+
+	if (esc->holding) {
+		int held = esc->held;
+
+		/* a 0xff lets it go; anything else takes its place */
+		if (out < 0)
+			esc->holding = FALSE;
+		else
+			esc->held = out;
+		return held;
+	}
+
+	return out;
+}
+
+/*
+ * The byte held back, or -1.  Only take it when the input has made
+ * room for it: more bytes in than out.
+ */
+int parmrk_escape_release(struct parmrk_escape *esc)
+{
+	if (!esc->holding)
+		return -1;
+	esc->holding = FALSE;
+
+	return esc->held;
+}
+
+/* bytes up to the next 0xff; on a clean line, all of them */
+static gsize parmrk_span(const guint8 *data, gsize len)
+{
+	gsize i = 0;
+
+#ifdef __SSE2__
+	const __m128i ff = _mm_set1_epi8((char)0xff);
+
+	for (; i + 16 <= len; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+		int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, ff));
+
+		if (mask)
+			return i + g_bit_nth_lsf(mask, -1);
+	}
+#endif
+	for (; i < len; i++)
+		if (data[i] == 0xff)
+			break;
+
+	return i;
+}
+
+/*
+ * Strip the marks from the len bytes at data, in place, and return how
+ * many are left.  The offset of each bad byte that is left, plus base,
+ * goes to errors, a GArray of guint, unless that is NULL.  A mark cut
+ * by the end of data is picked up by the next call.
+ */
+gsize parmrk_unpack(struct parmrk *parmrk, guint8 *data, gsize len, GArray *errors, guint base)
+{
+	struct parmrk_escape *esc = &parmrk->esc;
+	gsize n = 0;
+	gsize i = 0;
+	int out;
+
+	while (i < len) {
+		if (esc->state == PARMRK_DATA && !esc->holding) {
+			gsize run = parmrk_span(data + i, len - i);
+
+			/* nothing to move until the first mark */
+			if (n != i)
+				memmove(data + n, data + i, run);
+			n += run;
+			i += run;
+			if (i == len)
+				break;
+		}
+
+		out = parmrk_escape_next(esc, data[i++]);
+		if (out < 0)
+			continue;
+		if (out & PARMRK_MARKED) {
+			if (errors) {
+				guint offset = base + n;
+
+				g_array_append_val(errors, offset);
+			}
+			parmrk->errors++;
+		}
+		data[n++] = out;
+	}
+	if (n < i && (out = parmrk_escape_release(esc)) >= 0)
+		data[n++] = out;
+
+	return n;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+ * Line errors marked in band.  With INPCK | PARMRK and neither IGNPAR
+ * nor ISTRIP, the driver hands over a byte with a parity or framing
+ * error as 0xff 0x00 byte, a break as 0xff 0x00 0x00 and a real 0xff
+ * as 0xff 0xff.
+ */
+enum ParmrkState {
+	PARMRK_DATA,
+	PARMRK_ESCAPE,		/* after a 0xff */
+	PARMRK_MARK,		/* after 0xff 0x00; a bad byte is next */
+};
+
+/*
+ * The escapes, a byte at a time; parmrk_unpack() and multidrop_unpack()
+ * both decode with this.  A lone 0xff, seen without PARMRK, is plain
+ * data and gives two bytes for the one after it.  Decoding in place,
+ * the second of those has nowhere to go yet and is held until the
+ * input has made room for it.
+ */
+struct parmrk_escape {
+	enum ParmrkState state;
+	gboolean holding;
+	guint8 held;
+};
+
+#define PARMRK_MARKED (0x100)	/* or'ed to a byte that came after 0xff 0x00 */
+
+void parmrk_escape_reset(struct parmrk_escape *esc);
+int parmrk_escape_next(struct parmrk_escape *esc, guint8 c);
+int parmrk_escape_release(struct parmrk_escape *esc);
+
+struct parmrk {
+	struct parmrk_escape esc;
+	guint64 errors;
+};
+
+void parmrk_init(struct parmrk *parmrk);
+void parmrk_reset(struct parmrk *parmrk);
+gsize parmrk_unpack(struct parmrk *parmrk, guint8 *data, gsize len, GArray *errors, guint base);
@@ -0,0 +1,81 @@
+#include <math.h>
+#include <string.h>
+#include <glib.h>
+#include "pps.h"
+
+#define PPS_NOMINAL (1000000000.0)
+#define PPS_TOLERANCE (0.01)	/* of a second */
+
+void pps_reset(struct pps *pps)
+{
+	memset(pps, 0, sizeof(*pps));
+	pps->period = PPS_NOMINAL;
+}
+
+static void fit(struct pps *pps)
+{
+	gdouble sx = 0, sy = 0, sxx = 0, sxy = 0;
+	gdouble a, b, low = 0, err = 0;
+	guint i;
+
+	for (i = 0; i < pps->n; i++) {
+		gdouble y = pps->pulse[i] - pps->pulse[0];
+
+		sx += i;
+		sy += y;
+		sxx += (gdouble)i * i;
+		sxy += i * y;
+	}
+	b = (pps->n * sxy - sx * sy) / (pps->n * sxx - sx * sx);
+	a = (sy - b * sx) / pps->n;
+
+	for (i = 0; i < pps->n; i++) {
+		gdouble r = (gdouble)(pps->pulse[i] - pps->pulse[0]) - (a + b * i);
+
+		low = MIN(low, r);
+		err += r * r;
+	}
+
+	pps->period = b;
+	pps->jitter = sqrt(err / pps->n);
+	pps->edge = pps->pulse[0] + (guint64)(a + low + b * (pps->n - 1));
+}
+
+/* feed the host time of a pulse; returns whether the model is locked */
+gboolean pps_pulse(struct pps *pps, guint64 host)
+{
+	if (pps->n > 0) {
+		gdouble since = host - pps->pulse[pps->n - 1];
+
+		if (host <= pps->pulse[pps->n - 1] ||
+		    fabs(since - PPS_NOMINAL) > PPS_NOMINAL * PPS_TOLERANCE) {
+			/* a glitch, or pulses went missing; start over */
+			pps->rejected++;
+			pps->n = 0;
+			pps->locked = FALSE;
+		}
+	}
+
+	if (pps->n == PPS_FIT) {
+		memmove(pps->pulse, pps->pulse + 1, sizeof(pps->pulse[0]) * (PPS_FIT - 1));
+		pps->n--;
+	}
+	pps->pulse[pps->n++] = host;
+	pps->index++;
+
+	if (pps->n >= 2)
+		fit(pps);
+	if (pps->n >= PPS_LOCK)
+		pps->locked = TRUE;
+
+	return pps->locked;
+}
+
+/* a duration measured on the host, in reference ns */
+guint64 pps_host_to_reference(const struct pps *pps, guint64 duration)
+{
+	if (!pps->locked || pps->period <= 0)
+		return duration;
+
+	return (guint64)(duration * (PPS_NOMINAL / pps->period));
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+ * Clock recovery from a pulse per second.  Pulses are host times (ns,
+ * CLOCK_MONOTONIC) of the assert edge, stamped by whoever woke up for
+ * it and so late by a varying scheduling latency.  A line fitted over
+ * the last PPS_FIT pulses gives the length of a reference second in
+ * host ns; it is then moved down to the earliest pulse, since latency
+ * only ever adds.  The model is locked once PPS_LOCK pulses in a row
+ * came about a second apart.
+ */
+#define PPS_FIT (16)
+#define PPS_LOCK (4)
+
+struct pps {
+	guint64 pulse[PPS_FIT];	/* oldest first */
+	guint n;
+	gboolean locked;
+	guint64 index;		/* pulses accepted since start */
+	guint64 edge;		/* fitted host time of the last pulse */
+	gdouble period;		/* host ns per reference second */
+	gdouble jitter;		/* rms distance of the pulses from the fit, ns */
+	guint64 rejected;
+};
+
+void pps_reset(struct pps *pps);
+gboolean pps_pulse(struct pps *pps, guint64 host);
+guint64 pps_host_to_reference(const struct pps *pps, guint64 duration);
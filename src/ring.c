@@ -0,0 +1,59 @@
+#include <glib.h>
+#include "ring.h"
+
+void ring_init(struct ring *ring, guint size)
+{
+	guint n = 1;
+
+	while (n < size)
+		n <<= 1;
+	ring->slots = g_new0(gpointer, n);
+	ring->mask = n - 1;
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+void ring_clear(struct ring *ring)
+{
+	g_clear_pointer(&ring->slots, g_free);
+	ring->mask = 0;
+	ring->head = 0;
+	ring->tail = 0;
+}
+
+/* producer only; FALSE when full */
+gboolean ring_push(struct ring *ring, gpointer data)
+{
+	guint tail = ring->tail;
+
+	if (tail - (guint)g_atomic_int_get(&ring->head) > ring->mask)
+		return FALSE;
+	ring->slots[tail & ring->mask] = data;
+	/* the slot is written before the consumer sees it */
+	g_atomic_int_set(&ring->tail, tail + 1);
+	return TRUE;
+}
+
+/* consumer only; NULL when empty */
+gpointer ring_pop(struct ring *ring)
+{
+	guint head = ring->head;
+	gpointer data;
+
+	if (head == (guint)g_atomic_int_get(&ring->tail))
+		return NULL;
+	data = ring->slots[head & ring->mask];
+	g_atomic_int_set(&ring->head, head + 1);
+	return data;
+}
+
+/* either side; a snapshot */
+guint ring_count(struct ring *ring)
+{
+	return (guint)g_atomic_int_get(&ring->tail) - (guint)g_atomic_int_get(&ring->head);
+}
+
+guint ring_size(struct ring *ring)
+{
+	return ring->mask + 1;
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+ * A bounded ring of pointers for one producer and one consumer thread,
+ * lock free: each side only moves its own index.  The size is rounded
+ * up to a power of two.
+ */
+struct ring {
+	gpointer *slots;
+	guint mask;
+	gint head;	/* next to pop, moved by the consumer */
+	gint tail;	/* next to push, moved by the producer */
+};
+
+void ring_init(struct ring *ring, guint size);
+void ring_clear(struct ring *ring);
+
+gboolean ring_push(struct ring *ring, gpointer data);
+gpointer ring_pop(struct ring *ring);
+guint ring_count(struct ring *ring);
+guint ring_size(struct ring *ring);
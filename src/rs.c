@@ -0,0 +1,342 @@
+#include <string.h>
+#include <glib.h>
+#include "rs.h"
+
+#define GF_POLY (0x11d)
+
+static guint8 gf_exp[2 * RS_SYMBOLS];
+static guint8 gf_log[256];
+/* a full product table: one lookup per byte in the hot loops */
+static guint8 gf_mul_table[256][256];
+
+static void gf_init(void)
+{
+	static gsize done = 0;
+	guint x = 1;
+	guint a, b;
+	int i;
+
+	if (!g_once_init_enter(&done))
+		return;
+
+	for (i = 0; i < RS_SYMBOLS; i++) {
+		gf_exp[i] = x;
+		gf_exp[i + RS_SYMBOLS] = x;
+		gf_log[x] = i;
+		x <<= 1;
+		if (x & 0x100)
+			x ^= GF_POLY;
+	}
+	for (a = 1; a < 256; a++)
+		for (b = 1; b < 256; b++)
+			gf_mul_table[a][b] = gf_exp[gf_log[a] + gf_log[b]];
+
+	g_once_init_leave(&done, 1);
+}
+
+static inline guint8 gf_mul(guint8 a, guint8 b)
+{
+	return gf_mul_table[a][b];
+}
+
+static inline guint8 gf_div(guint8 a, guint8 b)
+{
+	if (!a)
+		return 0;
+	return gf_exp[gf_log[a] + RS_SYMBOLS - gf_log[b]];
+}
+
+/* alpha^n, n may be negative */
+static inline guint8 gf_pow(int n)
+{
+	n %= RS_SYMBOLS;
+	return gf_exp[n < 0 ? n + RS_SYMBOLS : n];
+}
+
+void rs_init(struct rs *rs, guint nroots)
+{
+	guint i, j;
+
+	gf_init();
+
+	rs->nroots = CLAMP(nroots, RS_PARITY_MIN, RS_PARITY_MAX);
+	/* the product of (x - alpha^i) for every root */
+	memset(rs->genpoly, 0, sizeof(rs->genpoly));
+	rs->genpoly[0] = 1;
+	for (i = 0; i < rs->nroots; i++)
+		for (j = i + 1; j > 0; j--)
+			rs->genpoly[j] ^= gf_mul(rs->genpoly[j - 1], gf_pow(i));
+}
+
+/* parity gets the nroots bytes that follow len (+ nroots <= 255) data bytes */
+void rs_encode(const struct rs *rs, const guint8 *data, gsize len, guint8 *parity)
+{
+	guint n = rs->nroots;
+	gsize i;
+	guint j;
+
+	memset(parity, 0, n);
+	for (i = 0; i < len; i++) {
+		const guint8 *mul = gf_mul_table[data[i] ^ parity[0]];
+
+		for (j = 0; j < n - 1; j++)
+			parity[j] = parity[j + 1] ^ mul[rs->genpoly[j + 1]];
+		parity[n - 1] = mul[rs->genpoly[n]];
+	}
+}
+
+/*
+ * Correct a codeword of len bytes, parity included, in place.  Returns
+ * the number of bytes corrected, or -1 if there are too many errors.
+ * Berlekamp-Massey, Chien search and Forney.
+ */
+int rs_decode(const struct rs *rs, guint8 *codeword, gsize len)
+{
+	guint8 syndromes[RS_PARITY_MAX];
+	guint8 lambda[RS_PARITY_MAX + 1] = { 1 };
+	guint8 prev[RS_PARITY_MAX + 1] = { 1 };
+	guint8 omega[RS_PARITY_MAX];
+	guint8 t[RS_PARITY_MAX + 1];
+	guint n = rs->nroots;
+	guint8 b = 1;
+	guint l = 0;
+	guint m = 1;
+	gboolean clean = TRUE;
+	int found = 0;
+	guint i, j;
+	gsize p;
+
+	if (len <= n || len > RS_SYMBOLS)
+		return -1;
+
+	/* the received word at each root; all zero means no error */
+	for (i = 0; i < n; i++) {
+		const guint8 *mul = gf_mul_table[gf_pow(i)];
+		guint8 s = 0;
+
+		for (p = 0; p < len; p++)
+			s = mul[s] ^ codeword[p];
+		syndromes[i] = s;
+		clean &= s == 0;
+	}
+	if (clean)
+		return 0;
+
+	for (i = 0; i < n; i++) {
+		guint8 d = syndromes[i];
+		guint8 scale;
+
+		for (j = 1; j <= l; j++)
+			d ^= gf_mul(lambda[j], syndromes[i - j]);
+		if (!d) {
+			m++;
+			continue;
+		}
+		scale = gf_div(d, b);
+		memcpy(t, lambda, sizeof(t));
+		for (j = 0; j + m <= n; j++)
+			lambda[j + m] ^= gf_mul(scale, prev[j]);
+		if (2 * l <= i) {
+			l = i + 1 - l;
+			memcpy(prev, t, sizeof(prev));
+			b = d;
+			m = 1;
+		}
+		else
+			m++;
+	}
+	if (l > n / 2)
+		return -1;
+
+	/* omega = syndromes * lambda mod x^n */
+	for (i = 0; i < n; i++) {
+		omega[i] = 0;
+		for (j = 0; j <= MIN(i, l); j++)
+			omega[i] ^= gf_mul(lambda[j], syndromes[i - j]);
+	}
+
+	/* byte p is the coefficient of x^(len - 1 - p) */
+	for (p = 0; p < len; p++) {
+		int power = len - 1 - p;
+		guint8 xinv = gf_pow(-power);
+		guint8 x = 1;
+		guint8 sum = 0;
+		guint8 num = 0;
+		guint8 den = 0;
+
+		for (j = 0; j <= l; j++) {
+			sum ^= gf_mul(lambda[j], x);
+			/* the derivative only keeps odd powers */
+			if (j & 1)
+				den ^= gf_mul(lambda[j], gf_div(x, xinv));
+			x = gf_mul(x, xinv);
+		}
+		if (sum)
+			continue;
+		x = 1;
+		for (j = 0; j < n; j++) {
+			num ^= gf_mul(omega[j], x);
+			x = gf_mul(x, xinv);
+		}
+		if (!den)
+			return -1;
+		codeword[p] ^= gf_mul(gf_pow(power), gf_div(num, den));
+		found++;
+	}
+
+	/* roots outside the codeword: more errors than we can tell */
+	return found == (int)l ? found : -1;
+}
+
+void rs_frame_init(struct rs_frame *frame, guint nroots, guint depth)
+{
+	rs_init(&frame->rs, nroots);
+	rs_init(&frame->header, RS_HEADER_ROOTS);
+	frame->depth = CLAMP(depth, 1, RS_DEPTH_MAX);
+	frame->frames = 0;
+	frame->corrected = 0;
+	frame->failed = 0;
+	frame->raw = 0;
+	frame->wire = 0;
+}
+
+/*
+ * Put len (1 to RS_FRAME_PAYLOAD()) bytes into a frame in out, which
+ * has room for RS_FRAME_BOUND(depth).  Returns the size of the frame.
+ */
+gsize rs_frame_pack(struct rs_frame *frame, const guint8 *in, gsize len, guint8 *out)
+{
+	guint nroots = frame->rs.nroots;
+	guint depth = MIN(frame->depth, len);
+	guint8 codeword[RS_SYMBOLS];
+	guint8 parity[RS_PARITY_MAX];
+	guint8 *payload;
+	gsize k, size;
+	guint i, j;
+
+	g_return_val_if_fail(len > 0 && len <= RS_FRAME_PAYLOAD(nroots, frame->depth), 0);
+
+	k = (len + depth - 1) / depth;
+	out[0] = RS_SYNC0;
+	out[1] = RS_SYNC1;
+	out[2] = nroots;
+	out[3] = depth;
+	out[4] = len >> 8;
+	out[5] = len;
+	rs_encode(&frame->header, out, 6, out + 6);
+
+	payload = out + RS_FRAME_HEADER;
+	memcpy(payload, in, len);
+	memset(payload + len, 0, depth * k - len);
+	for (i = 0; i < depth; i++) {
+		for (j = 0; j < k; j++)
+			codeword[j] = payload[j * depth + i];
+		rs_encode(&frame->rs, codeword, k, parity);
+		for (j = 0; j < nroots; j++)
+			payload[(k + j) * depth + i] = parity[j];
+	}
+	size = RS_FRAME_HEADER + depth * (k + nroots);
+
+	frame->frames++;
+	frame->raw += len;
+	frame->wire += size;
+
+	return size;
+}
+
+void rs_unpacker_init(struct rs_unpacker *unpacker)
+{
+	rs_frame_init(&unpacker->frame, RS_PARITY_MIN, 1);
+	unpacker->in = g_byte_array_new();
+}
+
+void rs_unpacker_clear(struct rs_unpacker *unpacker)
+{
+	g_clear_pointer(&unpacker->in, g_byte_array_unref);
+}
+
+/* start over; call when the stream (re)starts */
+void rs_unpacker_reset(struct rs_unpacker *unpacker)
+{
+	rs_frame_init(&unpacker->frame, RS_PARITY_MIN, 1);
+	g_byte_array_set_size(unpacker->in, 0);
+}
+
+/* where a frame may start: one of the sync bytes made it */
+static gsize rs_unpacker_hunt(const guint8 *data, gsize len)
+{
+	gsize i;
+
+	for (i = 0; i + 1 < len; i++)
+		if (data[i] == RS_SYNC0 || data[i + 1] == RS_SYNC1)
+			return i;
+	return len ? len - 1 : 0;
+}
+
+/* Take len bytes off the wire and append the payload they carry to out. */
+void rs_unpack(struct rs_unpacker *unpacker, const guint8 *data, gsize len, GByteArray *out)
+{
+	struct rs_frame *frame = &unpacker->frame;
+	GByteArray *in = unpacker->in;
+
+	g_byte_array_append(in, data, len);
+
+	while (in->len) {
+		guint8 header[RS_FRAME_HEADER];
+		guint8 codeword[RS_SYMBOLS];
+		guint nroots, depth, corrected = 0;
+		gsize payload, k, total;
+		guint i, j;
+		int ret;
+
+		g_byte_array_remove_range(in, 0, rs_unpacker_hunt(in->data, in->len));
+		if (in->len < RS_FRAME_HEADER)
+			break;
+
+		memcpy(header, in->data, sizeof(header));
+		if (rs_decode(&frame->header, header, sizeof(header)) < 0 ||
+		    header[0] != RS_SYNC0 || header[1] != RS_SYNC1)
+			goto skip;
+		nroots = header[2];
+		depth = header[3];
+		payload = header[4] << 8 | header[5];
+		if (nroots < RS_PARITY_MIN || nroots > RS_PARITY_MAX ||
+		    depth < 1 || depth > RS_DEPTH_MAX ||
+		    payload < depth || payload > RS_FRAME_PAYLOAD(nroots, depth))
+			goto skip;
+		k = (payload + depth - 1) / depth;
+		total = RS_FRAME_HEADER + depth * (k + nroots);
+		if (in->len < total)
+			break;
+
+		if (nroots != frame->rs.nroots)
+			rs_init(&frame->rs, nroots);
+		for (i = 0; i < depth; i++) {
+			guint8 *p = in->data + RS_FRAME_HEADER;
+
+			for (j = 0; j < k + nroots; j++)
+				codeword[j] = p[j * depth + i];
+			ret = rs_decode(&frame->rs, codeword, k + nroots);
+			if (ret < 0)
+				break;
+			for (j = 0; j < k; j++)
+				p[j * depth + i] = codeword[j];
+			corrected += ret;
+		}
+		/* a real frame beyond repair, or a false sync; hunt on */
+		if (i < depth) {
+			frame->failed++;
+			goto skip;
+		}
+
+		g_byte_array_append(out, in->data + RS_FRAME_HEADER, payload);
+		frame->frames++;
+		frame->corrected += corrected;
+		frame->raw += payload;
+		frame->wire += total;
+		g_byte_array_remove_range(in, 0, total);
+		continue;
+skip:
+		g_byte_array_remove_range(in, 0, 1);
+	}
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+ * Reed-Solomon over GF(256) (x^8 + x^4 + x^3 + x^2 + 1, roots from
+ * alpha^0), shortened to any length: nroots parity bytes correct up to
+ * nroots / 2 bad bytes in a codeword of at most 255.
+ *
+ * On the wire data goes in frames of depth codewords, interleaved a
+ * byte each so a burst of depth * nroots / 2 bytes is corrected too:
+ *
+ *   0-1   RS_SYNC0, RS_SYNC1
+ *   2     nroots
+ *   3     depth
+ *   4-5   payload length, big endian
+ *   6-9   RS_HEADER_ROOTS parity bytes of bytes 0 to 5
+ *   10-   the payload, zero padded to depth * k
+ *   then  nroots parity bytes of every codeword, interleaved
+ *
+ * where codeword i has the payload bytes i, i + depth, i + 2 * depth
+ * and so on, k of them.  The payload goes as is, so a frame costs
+ * only the header and depth * nroots bytes.  The header is a codeword
+ * of its own, sync included, so a frame is found even with a sync
+ * byte hit.
+ */
+#define RS_SYMBOLS (255)
+#define RS_PARITY_MIN (2)
+#define RS_PARITY_MAX (64)
+#define RS_DEPTH_MAX (64)
+#define RS_SYNC0 (0x5a)
+#define RS_SYNC1 (0xc3)
+#define RS_HEADER_ROOTS (4)
+#define RS_FRAME_HEADER (2 + 4 + RS_HEADER_ROOTS)
+
+/* largest payload of a frame, and the frame it makes */
+#define RS_FRAME_PAYLOAD(nroots, depth) ((depth) * (RS_SYMBOLS - (nroots)))
+#define RS_FRAME_BOUND(depth) (RS_FRAME_HEADER + (depth) * RS_SYMBOLS)
+
+struct rs {
+	guint nroots;
+	guint8 genpoly[RS_PARITY_MAX + 1];	/* highest power first, monic */
+};
+
+void rs_init(struct rs *rs, guint nroots);
+void rs_encode(const struct rs *rs, const guint8 *data, gsize len, guint8 *parity);
+int rs_decode(const struct rs *rs, guint8 *codeword, gsize len);
+
+struct rs_frame {
+	struct rs rs;
+	struct rs header;
+	guint depth;
+
+	guint64 frames;
+	guint64 corrected;	/* bytes */
+	guint64 failed;		/* frames beyond repair, on the receiving side */
+	guint64 raw;		/* payload bytes */
+	guint64 wire;		/* bytes, headers included */
+};
+
+/* receiving side: frames come in pieces */
+struct rs_unpacker {
+	struct rs_frame frame;
+	GByteArray *in;
+};
+
+void rs_frame_init(struct rs_frame *frame, guint nroots, guint depth);
+gsize rs_frame_pack(struct rs_frame *frame, const guint8 *in, gsize len, guint8 *out);
+
+void rs_unpacker_init(struct rs_unpacker *unpacker);
+void rs_unpacker_clear(struct rs_unpacker *unpacker);
+void rs_unpacker_reset(struct rs_unpacker *unpacker);
+void rs_unpack(struct rs_unpacker *unpacker, const guint8 *data, gsize len, GByteArray *out);
@@ -0,0 +1,226 @@
+#include <string.h>
+#include <glib.h>
+#include "trigger.h"
+
+#define AC_NEXT(ac, s) (&g_array_index((ac)->next, guint32, (s) * 256))
+
+static guint ac_new_state(struct ac *ac)
+{
+	guint s = ac->out->len;
+	guint zero = 0;
+
+	g_array_set_size(ac->next, (s + 1) * 256);
+	memset(AC_NEXT(ac, s), 0, 256 * sizeof(guint32));
+	g_array_append_val(ac->out, zero);
+	g_array_append_val(ac->dict, zero);
+
+	return s;
+}
+
+void ac_init(struct ac *ac)
+{
+	ac->next = g_array_new(FALSE, FALSE, sizeof(guint32));
+	ac->out = g_array_new(FALSE, FALSE, sizeof(guint));
+	ac->dict = g_array_new(FALSE, FALSE, sizeof(guint));
+	ac->lens = g_array_new(FALSE, FALSE, sizeof(guint));
+	ac->max_len = 0;
+	ac->state = 0;
+	ac_new_state(ac);
+}
+
+void ac_clear(struct ac *ac)
+{
+	g_clear_pointer(&ac->next, g_array_unref);
+	g_clear_pointer(&ac->out, g_array_unref);
+	g_clear_pointer(&ac->dict, g_array_unref);
+	g_clear_pointer(&ac->lens, g_array_unref);
+}
+
+/* before ac_compile() only; in the trie a 0 transition is none yet */
+void ac_add(struct ac *ac, const guint8 *pattern, gsize len)
+{
+	guint s = 0;
+	guint n;
+	gsize i;
+
+	g_return_if_fail(len > 0);
+
+	for (i = 0; i < len; i++) {
+		guint t = AC_NEXT(ac, s)[pattern[i]];
+
+		if (!t) {
+			t = ac_new_state(ac);
+			AC_NEXT(ac, s)[pattern[i]] = t;
+		}
+		s = t;
+	}
+	n = len;
+	g_array_append_val(ac->lens, n);
+	/* the same pattern twice reports as the first */
+	if (!g_array_index(ac->out, guint, s))
+		g_array_index(ac->out, guint, s) = ac->lens->len;
+	ac->max_len = MAX(ac->max_len, n);
+}
+
+/* breadth first, so the failure of a state is done before its children */
+void ac_compile(struct ac *ac)
+{
+	guint n = ac->out->len;
+	guint *fail = g_new0(guint, n);
+	guint *queue = g_new(guint, n);
+	guint head = 0, tail = 0;
+	guint c;
+
+	for (c = 0; c < 256; c++) {
+		guint t = AC_NEXT(ac, 0)[c];
+
+		if (t)
+			queue[tail++] = t;
+	}
+	while (head < tail) {
+		guint s = queue[head++];
+
+		for (c = 0; c < 256; c++) {
+			guint32 *next = AC_NEXT(ac, s);
+			guint t = next[c];
+			guint f;
+
+			if (!t) {
+				next[c] = AC_NEXT(ac, fail[s])[c];
+				continue;
+			}
+			f = fail[t] = AC_NEXT(ac, fail[s])[c];
+			g_array_index(ac->dict, guint, t) =
+				g_array_index(ac->out, guint, f) ? f : g_array_index(ac->dict, guint, f);
+			queue[tail++] = t;
+		}
+	}
+	g_free(queue);
+	g_free(fail);
+	ac->state = 0;
+}
+
+void trigger_init(struct trigger *trigger)
+{
+	ac_init(&trigger->ac);
+	trigger->gate = FALSE;
+	trigger->pre = 0;
+	trigger->post = 0;
+	trigger->pending = g_byte_array_new();
+	trigger->mask = g_byte_array_new();
+	trigger_reset(trigger);
+}
+
+void trigger_clear(struct trigger *trigger)
+{
+	ac_clear(&trigger->ac);
+	g_clear_pointer(&trigger->pending, g_byte_array_unref);
+	g_clear_pointer(&trigger->mask, g_byte_array_unref);
+}
+
+/* start over; call when the stream (re)starts */
+void trigger_reset(struct trigger *trigger)
+{
+	trigger->ac.state = 0;
+	trigger->offset = 0;
+	trigger->emit_until = 0;
+	g_byte_array_set_size(trigger->pending, 0);
+	g_byte_array_set_size(trigger->mask, 0);
+	trigger->matches = 0;
+	trigger->in = 0;
+	trigger->passed = 0;
+}
+
+/* let out the marked runs of the first n held back bytes and drop the rest */
+static void trigger_emit(struct trigger *trigger, guint n, GByteArray *out)
+{
+	const guint8 *mask = trigger->mask->data;
+	guint i = 0;
+
+	while (i < n) {
+		guint j = i;
+
+		while (j < n && mask[j] == mask[i])
+			j++;
+		if (mask[i]) {
+			g_byte_array_append(out, trigger->pending->data + i, j - i);
+			trigger->passed += j - i;
+		}
+		i = j;
+	}
+	g_byte_array_remove_range(trigger->pending, 0, n);
+	g_byte_array_remove_range(trigger->mask, 0, n);
+}
+
+/*
+ * Take len bytes of the stream and call func for every match.  When
+ * gating, append what gets out to out.
+ *
+ * A longer pattern ending later can start before a shorter one, so a
+ * byte is only decided once no match still to come can reach it with
+ * its pre window.
+ */
+void trigger_feed(struct trigger *trigger, const guint8 *in, gsize len, GByteArray *out,
+		  TriggerFunc func, gpointer user_data)
+{
+	struct ac *ac = &trigger->ac;
+	const guint32 *next = (const guint32 *)ac->next->data;
+	const guint *outputs = (const guint *)ac->out->data;
+	const guint *dict = (const guint *)ac->dict->data;
+	guint64 base = trigger->offset;
+	guint64 start = base - trigger->pending->len;
+	guint64 end = base + len;
+	guint64 decided;
+	guint8 *mask = NULL;
+	guint s = ac->state;
+	gsize i;
+
+	if (trigger->gate) {
+		g_byte_array_append(trigger->pending, in, len);
+		g_byte_array_set_size(trigger->mask, trigger->pending->len);
+		mask = trigger->mask->data;
+		memset(mask + (base - start), 0, len);
+	}
+
+	for (i = 0; i < len; i++) {
+		guint m;
+
+		s = next[s * 256 + in[i]];
+		for (m = outputs[s] ? s : dict[s]; m; m = dict[m]) {
+			guint p = outputs[m] - 1;
+			guint64 stop = base + i + 1;
+			guint64 first = stop - g_array_index(ac->lens, guint, p);
+			guint64 x;
+
+			trigger->matches++;
+			if (func)
+				func(p, first, user_data);
+			if (!mask)
+				continue;
+			/* the pre window and the match; the post window follows below */
+			for (x = MAX(first - MIN(first, trigger->pre), start); x < stop; x++)
+				mask[x - start] = 1;
+			trigger->emit_until = MAX(trigger->emit_until, stop + trigger->post);
+		}
+		if (mask && base + i < trigger->emit_until)
+			mask[base + i - start] = 1;
+	}
+	ac->state = s;
+	trigger->in += len;
+	trigger->offset = end;
+
+	if (!mask) {
+		trigger->passed += len;
+		return;
+	}
+	/* a match ending at end + 1 or later starts at end + 1 - max_len or later */
+	decided = end + 1 - MIN(end + 1, (guint64)ac->max_len + trigger->pre);
+	if (decided > start)
+		trigger_emit(trigger, decided - start, out);
+}
+
+/* the stream ended or the gate opened; let out what is held back in a window */
+void trigger_flush(struct trigger *trigger, GByteArray *out)
+{
+	trigger_emit(trigger, trigger->pending->len, out);
+}
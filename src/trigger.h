@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+ * Aho-Corasick over bytes.  ac_compile() turns the trie into a full
+ * DFA, so matching costs one table lookup per byte however many
+ * patterns there are.
+ */
+struct ac {
+	GArray *next;		/* guint32, 256 per state; state 0 is the root */
+	GArray *out;		/* guint, pattern index + 1 ending at the state, or 0 */
+	GArray *dict;		/* guint, next state down the suffix links with an output */
+	GArray *lens;		/* guint, of every pattern */
+	guint max_len;
+	guint state;
+};
+
+void ac_init(struct ac *ac);
+void ac_clear(struct ac *ac);
+void ac_add(struct ac *ac, const guint8 *pattern, gsize len);
+void ac_compile(struct ac *ac);
+
+/* a match of pattern whose first byte is at offset in the stream */
+typedef void (*TriggerFunc)(guint pattern, guint64 offset, gpointer user_data);
+
+/*
+ * Find the patterns in a stream and, when gating, let out only pre
+ * bytes before each match, the match and post bytes after it.  Bytes
+ * are held back until they are known to be in or out of a window.
+ */
+struct trigger {
+	struct ac ac;
+	gboolean gate;
+	guint pre;
+	guint post;
+	guint64 offset;		/* of the next byte in */
+	guint64 emit_until;	/* end of the last post window */
+	GByteArray *pending;	/* held back, ending at offset */
+	GByteArray *mask;	/* 1 for each pending byte in a window */
+
+	guint64 matches;
+	guint64 in;		/* bytes */
+	guint64 passed;		/* bytes let out */
+};
+
+void trigger_init(struct trigger *trigger);
+void trigger_clear(struct trigger *trigger);
+void trigger_reset(struct trigger *trigger);
+void trigger_feed(struct trigger *trigger, const guint8 *in, gsize len, GByteArray *out,
+		  TriggerFunc func, gpointer user_data);
+void trigger_flush(struct trigger *trigger, GByteArray *out);
@@ -1,9 +1,14 @@
 #include <fcntl.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/serial.h>
 #include <errno.h>
 #include <glib.h>
 #include <glib/gstdio.h>
 #include "uart.h"
+#include "uartvirtual.h"
 
 typedef enum {
 	UART_SETTING_ERROR_NO_BAUD,
@@ -27,6 +32,19 @@ static int speed_to_baud(speed_t speed)
 	case B115200: ret = 115200; break;
 	case B230400: ret = 230400; break;
 	case B460800: ret = 460800; break;
+#ifdef B500000
+	case B500000: ret = 500000; break;
+	case B576000: ret = 576000; break;
+	case B921600: ret = 921600; break;
+	case B1000000: ret = 1000000; break;
+	case B1152000: ret = 1152000; break;
+	case B1500000: ret = 1500000; break;
+	case B2000000: ret = 2000000; break;
+	case B2500000: ret = 2500000; break;
+	case B3000000: ret = 3000000; break;
+	case B3500000: ret = 3500000; break;
+	case B4000000: ret = 4000000; break;
+#endif
 	default: ret = -1; break;
 	}
 	return ret;
@@ -46,19 +64,254 @@ static speed_t baud_to_speed(int baud)
 	case 115200: ret = B115200; break;
 	case 230400: ret = B230400; break;
 	case 460800: ret = B460800; break;
+#ifdef B500000
+	case  500000: ret =  B500000; break;
+	case  576000: ret =  B576000; break;
+	case  921600: ret =  B921600; break;
+	case 1000000: ret = B1000000; break;
+	case 1152000: ret = B1152000; break;
+	case 1500000: ret = B1500000; break;
+	case 2000000: ret = B2000000; break;
+	case 2500000: ret = B2500000; break;
+	case 3000000: ret = B3000000; break;
+	case 3500000: ret = B3500000; break;
+	case 4000000: ret = B4000000; break;
+#endif
 	default: ret = B0; break;
 	}
 	return ret;
 }
 
+static int tty_get_attr(struct uart *uart, struct termios *options)
+{
+	return tcgetattr(uart->fd, options);
+}
+
+static int tty_set_attr(struct uart *uart, int when, const struct termios *options)
+{
+	return tcsetattr(uart->fd, when, options);
+}
+
+static int tty_flush(struct uart *uart, int queue)
+{
+	return tcflush(uart->fd, queue);
+}
+
+static int tty_drain(struct uart *uart)
+{
+	return tcdrain(uart->fd);
+}
+
+static int tty_output_queue(struct uart *uart)
+{
+	int queued;
+
+	if (ioctl(uart->fd, TIOCOUTQ, &queued) < 0)
+		return -1;
+	return queued;
+}
+
+static int tty_get_icount(struct uart *uart, struct uart_icount *icount)
+{
+	struct serial_icounter_struct counter;
+
+	if (ioctl(uart->fd, TIOCGICOUNT, &counter) < 0)
+		return -1;
+
+	icount->rx = counter.rx;
+	icount->tx = counter.tx;
+	icount->frame = counter.frame;
+	icount->parity = counter.parity;
+	icount->overrun = counter.overrun;
+	icount->brk = counter.brk;
+	icount->buf_overrun = counter.buf_overrun;
+
+	return 0;
+}
+
+static int tty_get_lines(struct uart *uart)
+{
+	int lines;
+
+	if (ioctl(uart->fd, TIOCMGET, &lines) < 0)
+		return -1;
+	return lines;
+}
+
+static int tty_wait_lines(struct uart *uart, int mask)
+{
+	return ioctl(uart->fd, TIOCMIWAIT, mask);
+}
+
+static int tty_set_lines(struct uart *uart, int set, int clear)
+{
+	if (set && ioctl(uart->fd, TIOCMBIS, &set) < 0)
+		return -1;
+	if (clear && ioctl(uart->fd, TIOCMBIC, &clear) < 0)
+		return -1;
+	return 0;
+}
+
+static int tty_get_rs485(struct uart *uart, struct uart_rs485 *rs485)
+{
+	struct serial_rs485 conf;
+
+	if (ioctl(uart->fd, TIOCGRS485, &conf) < 0)
+		return -1;
+	rs485->enabled = !!(conf.flags & SER_RS485_ENABLED);
+	rs485->rts_on_send = !!(conf.flags & SER_RS485_RTS_ON_SEND);
+	rs485->delay_before = conf.delay_rts_before_send;
+	rs485->delay_after = conf.delay_rts_after_send;
+	rs485->rx_during_tx = !!(conf.flags & SER_RS485_RX_DURING_TX);
+	return 0;
+}
+
+static int tty_set_rs485(struct uart *uart, const struct uart_rs485 *rs485)
+{
+	struct serial_rs485 conf;
+
+	memset(&conf, 0, sizeof(conf));
+	if (rs485->enabled)
+		conf.flags |= SER_RS485_ENABLED;
+	conf.flags |= rs485->rts_on_send ? SER_RS485_RTS_ON_SEND : SER_RS485_RTS_AFTER_SEND;
+	if (rs485->rx_during_tx)
+		conf.flags |= SER_RS485_RX_DURING_TX;
+	conf.delay_rts_before_send = rs485->delay_before;
+	conf.delay_rts_after_send = rs485->delay_after;
+	return ioctl(uart->fd, TIOCSRS485, &conf);
+}
+
+/* an attribute of our tty in sysfs, or NULL if it has no node there */
+static char *tty_sysfs_path(struct uart *uart, const char *attr)
+{
+	char *proc = g_strdup_printf("/proc/self/fd/%d", uart->fd);
+	char *dev = g_file_read_link(proc, NULL);
+	char *path = NULL;
+
+	if (dev && g_str_has_prefix(dev, "/dev/")) {
+		char *base = g_path_get_basename(dev);
+
+		path = g_strdup_printf("/sys/class/tty/%s/%s", base, attr);
+		g_free(base);
+	}
+	g_free(dev);
+	g_free(proc);
+	return path;
+}
+
+static int tty_sysfs_read(struct uart *uart, const char *attr)
+{
+	char *path = tty_sysfs_path(uart, attr);
+	char *contents = NULL;
+	int value = -1;
+
+	if (path && g_file_get_contents(path, &contents, NULL, NULL))
+		value = atoi(contents);
+	g_free(contents);
+	g_free(path);
+	return value;
+}
+
+static int tty_sysfs_write(struct uart *uart, const char *attr, int value)
+{
+	char *path = tty_sysfs_path(uart, attr);
+	char buf[16];
+	int len = g_snprintf(buf, sizeof(buf), "%d\n", value);
+	int fd = path ? g_open(path, O_WRONLY | O_CLOEXEC) : -1;
+	int ret = -1;
+
+	g_free(path);
+	if (fd < 0)
+		return -1;
+	if (write(fd, buf, len) == len)
+		ret = 0;
+	g_close(fd, NULL);
+	return ret;
+}
+
+static int tty_get_latency(struct uart *uart, struct uart_latency *latency)
+{
+	struct serial_struct serial;
+
+	latency->low_latency = -1;
+	if (ioctl(uart->fd, TIOCGSERIAL, &serial) == 0)
+		latency->low_latency = !!(serial.flags & ASYNC_LOW_LATENCY);
+	/* usb-serial ports have it on the port device */
+	latency->latency_timer = tty_sysfs_read(uart, "device/latency_timer");
+	latency->rx_trig_bytes = tty_sysfs_read(uart, "rx_trig_bytes");
+	return 0;
+}
+
+/* every field it can; -1 with errno of the first that failed */
+static int tty_set_latency(struct uart *uart, const struct uart_latency *latency)
+{
+	struct serial_struct serial;
+	int err = 0;
+
+	if (latency->low_latency >= 0) {
+		if (ioctl(uart->fd, TIOCGSERIAL, &serial) == 0) {
+			if (latency->low_latency)
+				serial.flags |= ASYNC_LOW_LATENCY;
+			else
+				serial.flags &= ~ASYNC_LOW_LATENCY;
+			if (ioctl(uart->fd, TIOCSSERIAL, &serial) < 0)
+				err = errno;
+		}
+		else
+			err = errno;
+	}
+	if (latency->latency_timer >= 0 &&
+	    tty_sysfs_write(uart, "device/latency_timer", latency->latency_timer) < 0 && !err)
+		err = errno;
+	if (latency->rx_trig_bytes >= 0 &&
+	    tty_sysfs_write(uart, "rx_trig_bytes", latency->rx_trig_bytes) < 0 && !err)
+		err = errno;
+
+	errno = err;
+	return err ? -1 : 0;
+}
+
+static void tty_close(struct uart *uart)
+{
+	g_close(uart->fd, NULL);
+}
+
+static const struct uart_ops tty_ops = {
+	.get_attr = tty_get_attr,
+	.set_attr = tty_set_attr,
+	.flush = tty_flush,
+	.drain = tty_drain,
+	.output_queue = tty_output_queue,
+	.get_icount = tty_get_icount,
+	.get_lines = tty_get_lines,
+	.wait_lines = tty_wait_lines,
+	.set_lines = tty_set_lines,
+	.get_rs485 = tty_get_rs485,
+	.set_rs485 = tty_set_rs485,
+	.get_latency = tty_get_latency,
+	.set_latency = tty_set_latency,
+	.close = tty_close,
+};
+
 struct uart* uart_open(const char *name, int flags)
 {
 	struct uart *uart;
 
-	uart = g_new(struct uart, 1);
+	if (uart_virtual_is_virtual(name))
+		return uart_virtual_open(name, flags);
+
+	uart = g_new0(struct uart, 1);
+	uart->ops = &tty_ops;
+	uart->backend = NULL;
 	uart->fd = g_open(name, flags | O_NOCTTY | O_CLOEXEC);
-	tcflush(uart->fd, TCIOFLUSH);
-	tcgetattr(uart->fd, &uart->current);
+	if (uart->fd < 0) {
+		int saved = errno;
+		g_free(uart);
+		errno = saved;
+		return NULL;
+	}
+	uart->ops->flush(uart, TCIOFLUSH);
+	uart->ops->get_attr(uart, &uart->current);
 	uart->orig = uart->current;
 
 	return uart;
@@ -69,12 +322,14 @@ struct uart* uart_open_raw(const char *name, int flags)
 	struct uart *uart;
 
 	uart = uart_open(name, flags);
+	if (!uart)
+		return NULL;
 	uart->current.c_iflag = 0;
 	uart->current.c_oflag = 0;
 	cfmakeraw(&uart->current);
-	tcsetattr(uart->fd, TCSAFLUSH, &uart->current);
+	uart->ops->set_attr(uart, TCSAFLUSH, &uart->current);
 	/* just in case; read back the current setting from the serial port */
-	tcgetattr(uart->fd, &uart->current);
+	uart->ops->get_attr(uart, &uart->current);
 
 	return uart;
 }
@@ -83,27 +338,45 @@ void uart_close(struct uart *uart)
 {
 	g_return_if_fail(uart);
 
-	tcsetattr(uart->fd, TCSAFLUSH, &uart->orig);
-	g_close(uart->fd, NULL);
+	uart_rs485_end(uart);
+	if (uart->orig_rs485)
+		uart->ops->set_rs485(uart, uart->orig_rs485);
+	g_free(uart->orig_rs485);
+	if (uart->orig_latency)
+		uart->ops->set_latency(uart, uart->orig_latency);
+	g_free(uart->orig_latency);
+	uart->ops->set_attr(uart, TCSAFLUSH, &uart->orig);
+	uart->ops->close(uart);
 	g_free(uart);
 }
 
+/*
+ * set the options and read them back into uart->current, so that
+ * uart_wire_time() and friends see what the driver actually took
+ */
+static int uart_apply(struct uart *uart, int when, const struct termios *options)
+{
+	if (uart->ops->set_attr(uart, when, options) < 0)
+		return -1;
+
+	return uart->ops->get_attr(uart, &uart->current);
+}
+
 int uart_get_baud_rate(struct uart *uart)
 {
 	struct termios options;
 
 	g_return_val_if_fail(uart, -1);
 
-	tcgetattr(uart->fd, &options);
+	uart->ops->get_attr(uart, &options);
 
 	return speed_to_baud(cfgetispeed(&options));
 }
 
-int uart_set_baud_rate(struct uart *uart, int baud, GError **error)
+int uart_set_baud_rate(struct uart *uart, int baud, int when, GError **error)
 {
 	struct termios options;
 	speed_t speed;
-	int ret;
 
 	g_return_val_if_fail(uart, -1);
 
@@ -113,28 +386,15 @@ int uart_set_baud_rate(struct uart *uart, int baud, GError **error)
 		return -1;
 	}
 
-	ret = tcgetattr(uart->fd, &options);
-	if (ret < 0) {
-		g_error("tcgetattr: %s", strerror(errno));
+	if (uart->ops->get_attr(uart, &options) < 0 ||
+	    cfsetspeed(&options, speed) < 0 ||
+	    uart_apply(uart, when, &options) < 0) {
+		g_set_error(error, UART_SETTING_ERROR, UART_SETTING_ERROR_INVALID_ARGS,
+			    "Failed to set baud rate %d: %s", baud, g_strerror(errno));
 		return -1;
 	}
-	ret = cfsetspeed(&options, speed);
-	if (ret < 0) {
-		g_error("cfsetspeed: %s", strerror(errno));
-		return -1;
-	}
-	ret = tcsetattr(uart->fd, TCSAFLUSH, &options);
-	if (ret < 0) {
-		g_error("tcsetattr: %s", strerror(errno));
-	}
-	ret = tcgetattr(uart->fd, &options);
-	if (ret < 0) {
-		g_error("tcgetattr: %s", strerror(errno));
-		return -1;
-	}
-	uart->current = options;
 
-	return ret;
+	return 0;
 }
 
 enum UartParity uart_get_parity(struct uart *uart)
@@ -144,9 +404,11 @@ enum UartParity uart_get_parity(struct uart *uart)
 
 	g_return_val_if_fail(uart, -1);
 
-	tcgetattr(uart->fd, &options);
+	uart->ops->get_attr(uart, &options);
 	if (options.c_cflag & PARENB) {
-		if (options.c_cflag & PARODD)
+		if (options.c_cflag & CMSPAR)
+			ret = options.c_cflag & PARODD ? UART_PARITY_MARK : UART_PARITY_SPACE;
+		else if (options.c_cflag & PARODD)
 			ret = UART_PARITY_ODD;
 		else
 			ret = UART_PARITY_EVEN;
@@ -155,29 +417,78 @@ enum UartParity uart_get_parity(struct uart *uart)
 	return ret;
 }
 
-int uart_set_parity(struct uart *uart, enum UartParity parity)
+static void termios_set_parity(struct termios *options, enum UartParity parity)
 {
-	struct termios options;
-
-	g_return_val_if_fail(uart, -1);
-
-	tcgetattr(uart->fd, &options);
+	options->c_cflag &= ~CMSPAR;
 	switch (parity) {
 	case UART_PARITY_EVEN:
-		options.c_cflag |= PARENB;
-		options.c_cflag &= ~PARODD;
+		options->c_cflag |= PARENB;
+		options->c_cflag &= ~PARODD;
 		break;
 	case UART_PARITY_ODD:
-		options.c_cflag |= PARENB;
-		options.c_cflag |= PARODD;
+		options->c_cflag |= PARENB;
+		options->c_cflag |= PARODD;
+		break;
+	/* with CMSPAR, PARODD picks mark */
+	case UART_PARITY_MARK:
+		options->c_cflag |= PARENB | CMSPAR | PARODD;
+		break;
+	case UART_PARITY_SPACE:
+		options->c_cflag |= PARENB | CMSPAR;
+		options->c_cflag &= ~PARODD;
 		break;
 	case UART_PARITY_NO:
 	default:
-		options.c_cflag &= ~PARENB;
+		options->c_cflag &= ~PARENB;
 		break;
 	}
+}
+
+int uart_set_parity(struct uart *uart, enum UartParity parity, int when)
+{
+	struct termios options;
 
-	return tcsetattr(uart->fd, TCSAFLUSH, &options);
+	g_return_val_if_fail(uart, -1);
+
+	if (uart->ops->get_attr(uart, &options) < 0)
+		return -1;
+	termios_set_parity(&options, parity);
+
+	return uart_apply(uart, when, &options);
+}
+
+/* names for the parity properties and caps */
+static const char *const parity_names[] = {
+	[UART_PARITY_NO] = "no",
+	[UART_PARITY_EVEN] = "even",
+	[UART_PARITY_ODD] = "odd",
+	[UART_PARITY_MARK] = "mark",
+	[UART_PARITY_SPACE] = "space",
+};
+
+/* FALSE, leaving *parity alone, if name is none of them */
+gboolean uart_parity_from_string(const char *name, enum UartParity *parity)
+{
+	guint i;
+
+	g_return_val_if_fail(parity, FALSE);
+
+	for (i = 0; name && i < G_N_ELEMENTS(parity_names); i++) {
+		if (g_str_equal(name, parity_names[i])) {
+			*parity = i;
+			return TRUE;
+		}
+	}
+
+	return FALSE;
+}
+
+const char* uart_parity_to_string(enum UartParity parity)
+{
+	if ((guint)parity >= G_N_ELEMENTS(parity_names))
+		return parity_names[UART_PARITY_NO];
+
+	return parity_names[parity];
 }
 
 int uart_get_stop_bit(struct uart *uart)
@@ -187,7 +498,7 @@ int uart_get_stop_bit(struct uart *uart)
 
 	g_return_val_if_fail(uart, -1);
 
-	tcgetattr(uart->fd, &options);
+	uart->ops->get_attr(uart, &options);
 	if (options.c_cflag & CSTOPB)
 		ret = 2;
 
@@ -200,10 +511,11 @@ int uart_set_stop_bit_1(struct uart *uart)
 
 	g_return_val_if_fail(uart, -1);
 
-	tcgetattr(uart->fd, &options);
+	if (uart->ops->get_attr(uart, &options) < 0)
+		return -1;
 	options.c_cflag &= ~CSTOPB;
 
-	return tcsetattr(uart->fd, TCSAFLUSH, &options);
+	return uart_apply(uart, TCSAFLUSH, &options);
 }
 
 int uart_set_stop_bit_2(struct uart *uart)
@@ -212,17 +524,328 @@ int uart_set_stop_bit_2(struct uart *uart)
 
 	g_return_val_if_fail(uart, -1);
 
-	tcgetattr(uart->fd, &options);
+	if (uart->ops->get_attr(uart, &options) < 0)
+		return -1;
 	options.c_cflag |= CSTOPB;
 
-	return tcsetattr(uart->fd, TCSAFLUSH, &options);
+	return uart_apply(uart, TCSAFLUSH, &options);
+}
+
+/* apply a whole set of options, e.g. the uart->current of a previous open */
+int uart_set_options(struct uart *uart, int when, const struct termios *options)
+{
+	g_return_val_if_fail(uart, -1);
+
+	return uart_apply(uart, when, options);
+}
+
+static gboolean termios_equal(const struct termios *a, const struct termios *b)
+{
+	return a->c_iflag == b->c_iflag && a->c_oflag == b->c_oflag &&
+		a->c_cflag == b->c_cflag && a->c_lflag == b->c_lflag &&
+		a->c_cc[VMIN] == b->c_cc[VMIN] && a->c_cc[VTIME] == b->c_cc[VTIME] &&
+		cfgetispeed(a) == cfgetispeed(b) && cfgetospeed(a) == cfgetospeed(b);
+}
+
+/*
+ * Put the port in raw mode with the settings in config, building the
+ * whole termios first: one tcsetattr() and a read back, instead of a
+ * round trip per setting.  Nothing is set if the port is that already,
+ * e.g. kept open from a previous run.
+ */
+int uart_configure(struct uart *uart, const struct uart_config *config, int when, GError **error)
+{
+	struct termios options;
+	speed_t speed;
+
+	g_return_val_if_fail(uart, -1);
+	g_return_val_if_fail(config, -1);
+
+	speed = baud_to_speed(config->baud_rate);
+	if (speed == B0) {
+		g_set_error(error, UART_SETTING_ERROR, UART_SETTING_ERROR_NO_BAUD, "Unsupported baud rate %d", config->baud_rate);
+		return -1;
+	}
+
+	options = uart->current;
+	options.c_iflag = 0;
+	options.c_oflag = 0;
+	cfmakeraw(&options);
+	cfsetspeed(&options, speed);
+	termios_set_parity(&options, config->parity);
+	/* cfmakeraw() leaves IGNPAR and ISTRIP off, so a real 0xff comes doubled */
+	if (config->mark_errors)
+		options.c_iflag |= INPCK | PARMRK;
+	if (termios_equal(&options, &uart->current))
+		return 0;
+
+	if (uart_apply(uart, when, &options) < 0) {
+		g_set_error(error, UART_SETTING_ERROR, UART_SETTING_ERROR_INVALID_ARGS,
+			    "Could not configure the port: %s", g_strerror(errno));
+		return -1;
+	}
+
+	return 0;
+}
+
+/*
+ * apply a setting changed while running; TCSADRAIN lets the bytes
+ * already queued leave with the old setting.  Returns 1 if the port
+ * changed, 0 if it was set up like this already.
+ */
+int uart_reconfigure(struct uart *uart, const struct uart_config *config, GError **error)
+{
+	struct termios before;
+
+	g_return_val_if_fail(uart, -1);
+
+	before = uart->current;
+	if (uart_configure(uart, config, TCSADRAIN, error) < 0)
+		return -1;
+
+	return !termios_equal(&before, &uart->current);
+}
+
+/* errno values a tty returns once its device has gone away */
+gboolean uart_error_is_hangup(int error)
+{
+	return error == EIO || error == ENXIO || error == ENODEV;
 }
 
 int uart_flush(struct uart *uart)
 {
 	g_return_val_if_fail(uart, -1);
 
-	return tcdrain(uart->fd);
+	return uart->ops->drain(uart);
+}
+
+/* discard what was received but not read yet */
+int uart_flush_input(struct uart *uart)
+{
+	g_return_val_if_fail(uart, -1);
+
+	return uart->ops->flush(uart, TCIFLUSH);
+}
+
+/* number of bytes waiting in the output queue of the driver */
+int uart_get_output_queue(struct uart *uart)
+{
+	g_return_val_if_fail(uart, -1);
+
+	return uart->ops->output_queue(uart);
+}
+
+/* line error counters; fails if the driver does not keep them */
+int uart_get_icount(struct uart *uart, struct uart_icount *icount)
+{
+	g_return_val_if_fail(uart, -1);
+
+	return uart->ops->get_icount(uart, icount);
+}
+
+/* state of the modem lines, as TIOCM_* bits */
+int uart_get_modem_lines(struct uart *uart)
+{
+	g_return_val_if_fail(uart, -1);
+
+	if (!uart->ops->get_lines) {
+		errno = ENOTTY;
+		return -1;
+	}
+	return uart->ops->get_lines(uart);
+}
+
+/*
+ * block until one of the TIOCM_* lines in mask changes; only a signal
+ * gets us out early, see uartlines.c
+ */
+int uart_wait_modem_lines(struct uart *uart, int mask)
+{
+	g_return_val_if_fail(uart, -1);
+
+	if (!uart->ops->wait_lines) {
+		errno = ENOTTY;
+		return -1;
+	}
+	return uart->ops->wait_lines(uart, mask);
+}
+
+/* raise the TIOCM_* output lines in set, drop those in clear */
+int uart_set_modem_lines(struct uart *uart, int set, int clear)
+{
+	g_return_val_if_fail(uart, -1);
+
+	if (!uart->ops->set_lines) {
+		errno = ENOTTY;
+		return -1;
+	}
+	return uart->ops->set_lines(uart, set, clear);
+}
+
+/*
+ * Hand RS-485 driver enable to the driver.  If it can't, fall back to
+ * raising RTS from uart_rs485_begin() to uart_rs485_end(); returns 1
+ * then, 0 if the driver does it and -1 on error.
+ */
+int uart_set_rs485(struct uart *uart, const struct uart_rs485 *rs485)
+{
+	struct uart_rs485 orig;
+
+	g_return_val_if_fail(uart && rs485, -1);
+
+	uart_rs485_end(uart);
+	uart->rs485 = *rs485;
+	uart->rs485_soft = FALSE;
+
+	if (uart->ops->set_rs485) {
+		if (!uart->orig_rs485 && uart->ops->get_rs485 &&
+		    uart->ops->get_rs485(uart, &orig) == 0) {
+			uart->orig_rs485 = g_new(struct uart_rs485, 1);
+			*uart->orig_rs485 = orig;
+		}
+		if (uart->ops->set_rs485(uart, rs485) == 0)
+			return 0;
+		if (errno != ENOTTY && errno != EINVAL && errno != EOPNOTSUPP)
+			return -1;
+	}
+	if (!rs485->enabled)
+		return 0;
+
+	/* receiver side idle: driver disabled */
+	uart->rs485_soft = TRUE;
+	if (rs485->rts_on_send)
+		return uart_set_modem_lines(uart, 0, TIOCM_RTS) < 0 ? -1 : 1;
+	return uart_set_modem_lines(uart, TIOCM_RTS, 0) < 0 ? -1 : 1;
+}
+
+/* about to write; enable the driver unless the kernel does */
+int uart_rs485_begin(struct uart *uart)
+{
+	int ret;
+
+	g_return_val_if_fail(uart, -1);
+
+	if (!uart->rs485_soft || uart->rs485_sending)
+		return 0;
+	if (uart->rs485.rts_on_send)
+		ret = uart_set_modem_lines(uart, TIOCM_RTS, 0);
+	else
+		ret = uart_set_modem_lines(uart, 0, TIOCM_RTS);
+	if (ret < 0)
+		return -1;
+	uart->rs485_sending = TRUE;
+	if (uart->rs485.delay_before)
+		g_usleep(uart->rs485.delay_before * 1000);
+	return 0;
+}
+
+/* done writing; let the last bit out and release the bus */
+int uart_rs485_end(struct uart *uart)
+{
+	g_return_val_if_fail(uart, -1);
+
+	if (!uart->rs485_sending)
+		return 0;
+	uart->rs485_sending = FALSE;
+	uart->ops->drain(uart);
+	if (uart->rs485.delay_after)
+		g_usleep(uart->rs485.delay_after * 1000);
+	if (uart->rs485.rts_on_send)
+		return uart_set_modem_lines(uart, 0, TIOCM_RTS);
+	return uart_set_modem_lines(uart, TIOCM_RTS, 0);
+}
+
+/* the driver's latency knobs as they are now */
+int uart_get_latency(struct uart *uart, struct uart_latency *latency)
+{
+	g_return_val_if_fail(uart && latency, -1);
+
+	if (!uart->ops->get_latency) {
+		errno = ENOTTY;
+		return -1;
+	}
+	return uart->ops->get_latency(uart, latency);
+}
+
+/*
+ * Turn every latency knob the device has all the way down: low latency
+ * flag, a 1 msec USB latency timer and a 1 byte FIFO trigger.  Or back
+ * to what they were.  The device gets its settings back on close
+ * either way.  -1 if any of them could not be set.
+ */
+int uart_set_low_latency(struct uart *uart, gboolean enable)
+{
+	struct uart_latency latency;
+
+	g_return_val_if_fail(uart, -1);
+
+	if (!uart->ops->set_latency) {
+		errno = ENOTTY;
+		return -1;
+	}
+	if (!enable) {
+		if (!uart->orig_latency)
+			return 0;
+		latency = *uart->orig_latency;
+		g_clear_pointer(&uart->orig_latency, g_free);
+		return uart->ops->set_latency(uart, &latency);
+	}
+
+	if (uart->ops->get_latency(uart, &latency) < 0)
+		return -1;
+	if (!uart->orig_latency) {
+		uart->orig_latency = g_new(struct uart_latency, 1);
+		*uart->orig_latency = latency;
+	}
+	if (latency.low_latency >= 0)
+		latency.low_latency = 1;
+	if (latency.latency_timer >= 0)
+		latency.latency_timer = 1;
+	if (latency.rx_trig_bytes >= 0)
+		latency.rx_trig_bytes = 1;
+	return uart->ops->set_latency(uart, &latency);
+}
+
+/* time, in nano sec, it takes to put bytes on the wire with the current setting */
+guint64 uart_wire_time(struct uart *uart, gsize bytes)
+{
+	int baud;
+
+	g_return_val_if_fail(uart, 0);
+
+	baud = uart_termios_baud_rate(&uart->current);
+	if (baud <= 0)
+		return 0;
+
+	return (guint64)bytes * uart_termios_frame_bits(&uart->current) * 1000000000 / baud;
+}
+
+int uart_termios_baud_rate(const struct termios *options)
+{
+	g_return_val_if_fail(options, -1);
+
+	return speed_to_baud(cfgetospeed(options));
+}
+
+/* number of bits one character occupies on the wire, start bit included */
+int uart_termios_frame_bits(const struct termios *options)
+{
+	int bits = 1;
+
+	g_return_val_if_fail(options, -1);
+
+	switch (options->c_cflag & CSIZE) {
+	case CS5: bits += 5; break;
+	case CS6: bits += 6; break;
+	case CS7: bits += 7; break;
+	case CS8:
+	default: bits += 8; break;
+	}
+	if (options->c_cflag & PARENB)
+		bits += 1;
+	bits += (options->c_cflag & CSTOPB) ? 2 : 1;
+
+	return bits;
 }
 
 GQuark uart_setting_error_quark(void)
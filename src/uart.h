@@ -6,12 +6,82 @@ enum UartParity {
 	UART_PARITY_NO,
 	UART_PARITY_EVEN,
 	UART_PARITY_ODD,
+	UART_PARITY_MARK,	/* always 1; the 9th bit of multidrop address bytes */
+	UART_PARITY_SPACE,	/* always 0; multidrop data bytes */
+};
+
+struct uart;
+
+/* line statistics kept by the driver, see TIOCGICOUNT */
+struct uart_icount {
+	guint32 rx;
+	guint32 tx;
+	guint32 frame;
+	guint32 parity;
+	guint32 overrun;
+	guint32 brk;
+	guint32 buf_overrun;
+};
+
+/* RS-485 driver enable control, see TIOCSRS485 */
+struct uart_rs485 {
+	gboolean enabled;
+	gboolean rts_on_send;	/* RTS level while sending; the other one after */
+	guint delay_before;	/* msec from driver enable to the first bit */
+	guint delay_after;	/* msec from the last bit to driver disable */
+	gboolean rx_during_tx;	/* hear our own transmission */
+};
+
+/*
+ * Driver knobs that trade CPU for read latency.  A field the device
+ * does not have reads -1 and is left alone when set.
+ */
+struct uart_latency {
+	int low_latency;	/* ASYNC_LOW_LATENCY, see TIOCSSERIAL */
+	int latency_timer;	/* msec a USB adapter (FTDI) holds data back */
+	int rx_trig_bytes;	/* receive FIFO trigger level of a 16550 */
+};
+
+/* how the elements set a port up, see uart_configure() */
+struct uart_config {
+	int baud_rate;
+	enum UartParity parity;
+	gboolean mark_errors;	/* INPCK | PARMRK: bytes with a parity or framing error come as 0xff 0x00 byte */
+};
+
+/*
+ * Backend operations.  A real tty uses the termios library calls
+ * directly; other backends (see uartvirtual.c) emulate them on top of
+ * whatever file descriptor they hand out in uart->fd.
+ */
+struct uart_ops {
+	int (*get_attr)(struct uart *uart, struct termios *options);
+	int (*set_attr)(struct uart *uart, int when, const struct termios *options);
+	int (*flush)(struct uart *uart, int queue);
+	int (*drain)(struct uart *uart);
+	int (*output_queue)(struct uart *uart);
+	int (*get_icount)(struct uart *uart, struct uart_icount *icount);
+	int (*get_lines)(struct uart *uart);
+	int (*wait_lines)(struct uart *uart, int mask);
+	int (*set_lines)(struct uart *uart, int set, int clear);
+	int (*get_rs485)(struct uart *uart, struct uart_rs485 *rs485);
+	int (*set_rs485)(struct uart *uart, const struct uart_rs485 *rs485);
+	int (*get_latency)(struct uart *uart, struct uart_latency *latency);
+	int (*set_latency)(struct uart *uart, const struct uart_latency *latency);
+	void (*close)(struct uart *uart);
 };
 
 struct uart {
 	int fd;
 	struct termios orig;
 	struct termios current;
+	const struct uart_ops *ops;
+	void *backend;
+	struct uart_rs485 rs485;	/* as set by uart_set_rs485() */
+	struct uart_rs485 *orig_rs485;	/* restored on close, if we changed it */
+	gboolean rs485_soft;	/* the driver can't; we toggle RTS ourselves */
+	gboolean rs485_sending;
+	struct uart_latency *orig_latency;	/* restored on close, if we changed it */
 };
 
 struct uart* uart_open(const char *name, int flags);
@@ -19,13 +89,35 @@ struct uart* uart_open_raw(const char *name, int flags);
 void uart_close(struct uart *uart);
 
 int uart_get_baud_rate(struct uart *uart);
-int uart_set_baud_rate(struct uart *uart, int baud, GError **err);
+int uart_set_baud_rate(struct uart *uart, int baud, int when, GError **err);
 
 enum UartParity uart_get_parity(struct uart *uart);
-int uart_set_parity(struct uart *uart, enum UartParity parity);
+int uart_set_parity(struct uart *uart, enum UartParity parity, int when);
+gboolean uart_parity_from_string(const char *name, enum UartParity *parity);
+const char* uart_parity_to_string(enum UartParity parity);
 
 int uart_get_stop_bit(struct uart *uart);
 int uart_set_stop_bit_1(struct uart *uart);
 int uart_set_stop_bit_2(struct uart *uart);
 
+int uart_set_options(struct uart *uart, int when, const struct termios *options);
+int uart_configure(struct uart *uart, const struct uart_config *config, int when, GError **err);
+int uart_reconfigure(struct uart *uart, const struct uart_config *config, GError **err);
+gboolean uart_error_is_hangup(int error);
+
 int uart_flush(struct uart *uart);
+int uart_flush_input(struct uart *uart);
+int uart_get_output_queue(struct uart *uart);
+int uart_get_icount(struct uart *uart, struct uart_icount *icount);
+int uart_get_modem_lines(struct uart *uart);
+int uart_wait_modem_lines(struct uart *uart, int mask);
+int uart_set_modem_lines(struct uart *uart, int set, int clear);
+int uart_set_rs485(struct uart *uart, const struct uart_rs485 *rs485);
+int uart_rs485_begin(struct uart *uart);
+int uart_rs485_end(struct uart *uart);
+int uart_get_latency(struct uart *uart, struct uart_latency *latency);
+int uart_set_low_latency(struct uart *uart, gboolean enable);
+guint64 uart_wire_time(struct uart *uart, gsize bytes);
+
+int uart_termios_baud_rate(const struct termios *options);
+int uart_termios_frame_bits(const struct termios *options);
@@ -0,0 +1,111 @@
+#include <errno.h>
+#include <fcntl.h>
+#include "uartconn.h"
+#include "uartwatch.h"
+
+void uart_conn_post(GstElement *element, const char *device, gboolean connected,
+		    GstClockTime downtime)
+{
+	GstStructure *s;
+
+	s = gst_structure_new("uart-connection",
+			      "device", G_TYPE_STRING, device,
+			      "connected", G_TYPE_BOOLEAN, connected,
+			      "downtime", G_TYPE_UINT64, downtime,
+			      NULL);
+	gst_element_post_message(element, gst_message_new_element(GST_OBJECT(element), s));
+}
+
+/*
+ * the device went away; take *uart out under the object lock, close it
+ * and remember how it was set up
+ */
+void uart_conn_lost(struct uart_conn *conn, GstElement *element, const char *device,
+		    struct uart **uart)
+{
+	struct uart *lost;
+
+	conn->lost_since = g_get_monotonic_time() * GST_USECOND;
+	conn->options = (*uart)->current;
+
+	GST_OBJECT_LOCK(element);
+	lost = *uart;
+	*uart = NULL;
+	GST_OBJECT_UNLOCK(element);
+	uart_close(lost);
+
+	uart_conn_post(element, device, FALSE, 0);
+}
+
+/* the bits of the old setup uart_configure() doesn't cover */
+#define UART_CONN_CARRY (CSTOPB | CRTSCTS)
+
+/* set a reopened port up like config, and like the old one otherwise */
+static int uart_conn_setup(struct uart_conn *conn, struct uart *uart,
+			   const struct uart_config *config)
+{
+	struct termios options;
+
+	if (uart_configure(uart, config, TCSANOW, NULL) < 0)
+		return -1;
+
+	options = uart->current;
+	options.c_cflag &= ~UART_CONN_CARRY;
+	options.c_cflag |= conn->options.c_cflag & UART_CONN_CARRY;
+	if (options.c_cflag == uart->current.c_cflag)
+		return 0;
+
+	return uart_set_options(uart, TCSANOW, &options);
+}
+
+/*
+ * Wait for the device to come back (inotify, with a retry every
+ * interval msec as fallback) and reopen it set up as config says.
+ * A node that is back but won't take the settings yet, as udev may
+ * still be at it, is closed and waited for again.  fdset is one the
+ * element flushes on unlock; returns NULL if that happened.
+ */
+struct uart* uart_conn_wait(struct uart_conn *conn, GstElement *element, const char *device,
+			    const struct uart_config *config, GstPoll *fdset, guint interval,
+			    GstClockTime *downtime)
+{
+	GstPollFD watchfd = GST_POLL_FD_INIT;
+	struct uart_watch *watch;
+	struct uart *uart;
+
+	watch = uart_watch_new(device);
+	watchfd.fd = uart_watch_get_fd(watch);
+	if (watchfd.fd >= 0) {
+		gst_poll_add_fd(fdset, &watchfd);
+		gst_poll_fd_ctl_read(fdset, &watchfd, TRUE);
+	}
+
+	for (;;) {
+		uart = uart_open(device, O_RDWR);
+		if (uart && uart_conn_setup(conn, uart, config) == 0)
+			break;
+		if (uart) {
+			GST_LOG_OBJECT(element, "\"%s\" is back but not ready: %s", device, g_strerror(errno));
+			uart_close(uart);
+			uart = NULL;
+		}
+		else {
+			GST_LOG_OBJECT(element, "\"%s\" not back yet: %s", device, g_strerror(errno));
+		}
+		if (gst_poll_wait(fdset, interval * GST_MSECOND) < 0 && errno == EBUSY)
+			break;
+		uart_watch_consume(watch);
+	}
+
+	if (watchfd.fd >= 0)
+		gst_poll_remove_fd(fdset, &watchfd);
+	uart_watch_free(watch);
+	if (!uart)
+		return NULL;
+
+	*downtime = g_get_monotonic_time() * GST_USECOND - conn->lost_since;
+	GST_INFO_OBJECT(element, "\"%s\" is back after %" GST_TIME_FORMAT,
+			device, GST_TIME_ARGS(*downtime));
+
+	return uart;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <gst/gst.h>
+#include "uart.h"
+
+/*
+ * Losing a device and getting it back, for the elements with a
+ * reconnect property.  The element keeps its own poll sets and side
+ * state (lines, PPS, ...) and calls these for the part they share: the
+ * "uart-connection" messages, remembering how the port was set up, and
+ * waiting for the device node to come back.
+ */
+struct uart_conn {
+	GstClockTime lost_since;	/* monotonic */
+	struct termios options;		/* as the device was set up when it went away */
+};
+
+void uart_conn_post(GstElement *element, const char *device, gboolean connected,
+		    GstClockTime downtime);
+void uart_conn_lost(struct uart_conn *conn, GstElement *element, const char *device,
+		    struct uart **uart);
+struct uart* uart_conn_wait(struct uart_conn *conn, GstElement *element, const char *device,
+			    const struct uart_config *config, GstPoll *fdset, guint interval,
+			    GstClockTime *downtime);
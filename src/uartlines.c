@@ -0,0 +1,144 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <time.h>
+#include <glib.h>
+#include "uart.h"
+#include "uartlines.h"
+
+struct uart_line_monitor {
+	struct uart *uart;
+	int mask;
+	UartLineFunc func;
+	gpointer user_data;
+	pthread_t thread;
+	gint quit;
+};
+
+/*
+ * TIOCMIWAIT only gives up on a signal, and there is no fd to poll for
+ * the lines instead.  MONITOR_SIGNAL gets a handler, installed without
+ * SA_RESTART, so that the wait returns EINTR and the thread gets to see
+ * quit.  That handler is process wide: ours are queued with
+ * monitor_cookie as their value and swallowed, anything else is passed
+ * on to the handler the process had before, if it had one.  A handler
+ * installed over ours later must not use SA_RESTART.
+ */
+#define MONITOR_SIGNAL SIGRTMAX
+/* how long uart_line_monitor_free() waits before signalling again */
+#define MONITOR_KICK_NS (10 * 1000 * 1000)
+
+static int monitor_cookie;
+static struct sigaction monitor_previous;
+
+static void monitor_signal(int sig, siginfo_t *info, void *context)
+{
+	if (info && info->si_code == SI_QUEUE && info->si_value.sival_ptr == &monitor_cookie)
+		return;
+
+	if (monitor_previous.sa_flags & SA_SIGINFO)
+		monitor_previous.sa_sigaction(sig, info, context);
+	else if (monitor_previous.sa_handler != SIG_DFL &&
+		 monitor_previous.sa_handler != SIG_IGN)
+		monitor_previous.sa_handler(sig);
+}
+
+static void monitor_signal_init(void)
+{
+	static gsize done;
+
+	if (g_once_init_enter(&done)) {
+		struct sigaction sa = { 0 };
+
+		sa.sa_sigaction = monitor_signal;
+		sigemptyset(&sa.sa_mask);
+		sa.sa_flags = SA_SIGINFO;
+		sigaction(MONITOR_SIGNAL, &sa, &monitor_previous);
+		g_once_init_leave(&done, 1);
+	}
+}
+
+static guint64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (guint64)ts.tv_sec * G_GUINT64_CONSTANT(1000000000) + ts.tv_nsec;
+}
+
+static void *monitor_thread(void *data)
+{
+	struct uart_line_monitor *monitor = data;
+
+	while (!g_atomic_int_get(&monitor->quit)) {
+		guint64 when;
+		int lines;
+		int ret;
+
+		ret = uart_wait_modem_lines(monitor->uart, monitor->mask);
+		when = now_ns();
+
+		if (ret < 0 && errno == EINTR)
+			continue;
+		lines = ret < 0 ? -1 : uart_get_modem_lines(monitor->uart);
+		if (lines < 0) {
+			monitor->func(-errno, when, monitor->user_data);
+			break;
+		}
+		monitor->func(lines, when, monitor->user_data);
+	}
+
+	return NULL;
+}
+
+struct uart_line_monitor* uart_line_monitor_new(struct uart *uart, int mask,
+						UartLineFunc func, gpointer user_data)
+{
+	struct uart_line_monitor *monitor;
+	int ret;
+
+	g_return_val_if_fail(uart, NULL);
+	g_return_val_if_fail(func, NULL);
+
+	monitor = g_new0(struct uart_line_monitor, 1);
+	monitor->uart = uart;
+	monitor->mask = mask;
+	monitor->func = func;
+	monitor->user_data = user_data;
+
+	monitor_signal_init();
+	ret = pthread_create(&monitor->thread, NULL, monitor_thread, monitor);
+	if (ret != 0) {
+		g_free(monitor);
+		errno = ret;
+		return NULL;
+	}
+
+	return monitor;
+}
+
+/* stops the thread; func is not called any more once this returns */
+void uart_line_monitor_free(struct uart_line_monitor *monitor)
+{
+	if (!monitor)
+		return;
+
+	g_atomic_int_set(&monitor->quit, TRUE);
+	/* a signal that lands just before the wait starts is lost; send another */
+	for (;;) {
+		struct timespec deadline;
+
+		pthread_sigqueue(monitor->thread, MONITOR_SIGNAL,
+				 (union sigval) { .sival_ptr = &monitor_cookie });
+		clock_gettime(CLOCK_REALTIME, &deadline);
+		deadline.tv_nsec += MONITOR_KICK_NS;
+		if (deadline.tv_nsec >= 1000000000) {
+			deadline.tv_sec++;
+			deadline.tv_nsec -= 1000000000;
+		}
+		if (pthread_timedjoin_np(monitor->thread, NULL, &deadline) != ETIMEDOUT)
+			break;
+	}
+	g_free(monitor);
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <glib.h>
+#include "uart.h"
+
+/*
+ * Watching the modem lines of a uart from a thread of its own.  func
+ * is called from that thread with the TIOCM_* state of all lines and
+ * the CLOCK_MONOTONIC time (ns) we woke up at, each time one of the
+ * lines in mask changes.  If the lines can't be waited for, func gets
+ * a negative errno once and the thread ends.
+ */
+/* name of the events elements carry modem line state in */
+#define UART_MODEM_LINES_EVENT "uart-modem-lines"
+
+typedef void (*UartLineFunc)(int lines, guint64 when, gpointer user_data);
+
+struct uart_line_monitor;
+
+struct uart_line_monitor* uart_line_monitor_new(struct uart *uart, int mask,
+						UartLineFunc func, gpointer user_data);
+void uart_line_monitor_free(struct uart_line_monitor *monitor);
@@ -0,0 +1,716 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <poll.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <glib.h>
+#include "uart.h"
+#include "uartvirtual.h"
+
+#define VIRTUAL_ACK 0x06
+#define VIRTUAL_NAK 0x15
+#define VIRTUAL_CHUNK_MAX 4096
+#define VIRTUAL_LINES_OUT (TIOCM_DTR | TIOCM_RTS)
+
+enum virtual_peer {
+	VIRTUAL_PEER_PAIR,
+	VIRTUAL_PEER_LOOP,
+	VIRTUAL_PEER_ACKNAK,
+};
+
+/* a piece of data in flight towards an endpoint */
+struct virtual_chunk {
+	gint64 due;		/* monotonic ns the last bit arrives */
+	gsize len;
+	gsize off;
+	int baud;		/* setting the data was sent with */
+	tcflag_t framing;
+	gboolean framed;	/* receiver's setting already checked */
+	guint8 data[];
+};
+
+struct virtual_endpoint {
+	struct virtual_link *link;
+	gboolean attached;
+	int wire_fd;		/* our side of the socketpair */
+	struct termios options;
+	gint64 wire_free;	/* transmitter busy until, in ns */
+	gint64 peer_wire_free;	/* same, for the emulated acknak peer */
+	gboolean pending_ack;
+	GQueue rx;		/* chunks to be delivered to this endpoint */
+	struct uart_icount icount;
+	gint lines_out;		/* DTR / RTS, atomic */
+};
+
+struct virtual_link {
+	char *name;
+	enum virtual_peer peer;
+	gint64 latency;		/* in ns */
+	gdouble ber;
+	gdouble nak_rate;
+	GRand *rand;
+	GMutex lock;
+	GThread *pump;
+	gboolean quit;
+	int wake[2];
+	int users;
+	gint lines_seq;		/* bumped, atomically, when any line changes */
+	struct virtual_endpoint ep[2];
+};
+
+G_LOCK_DEFINE_STATIC(links);
+static GHashTable *links;
+
+static gint64 now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (gint64)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/* wire time of one character in ns; 0 means unpaced */
+static gint64 char_time(const struct termios *options)
+{
+	int baud = uart_termios_baud_rate(options);
+
+	if (baud <= 0)
+		return 0;
+	return (gint64)uart_termios_frame_bits(options) * 1000000000 / baud;
+}
+
+static gsize chunk_max(const struct termios *options)
+{
+	gint64 t = char_time(options);
+
+	/* about a milli second worth of characters */
+	if (t == 0)
+		return VIRTUAL_CHUNK_MAX;
+	return CLAMP(1000000 / t, 1, VIRTUAL_CHUNK_MAX);
+}
+
+static gint chunk_compare(gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	const struct virtual_chunk *ca = a;
+	const struct virtual_chunk *cb = b;
+
+	return (ca->due > cb->due) - (ca->due < cb->due);
+}
+
+#define FRAMING_FLAGS (CSIZE | PARENB | PARODD)
+
+static void queue_chunk(struct virtual_endpoint *dest, const struct termios *options,
+			const guint8 *data, gsize len, gint64 due)
+{
+	struct virtual_chunk *chunk;
+
+	chunk = g_malloc(sizeof(*chunk) + len);
+	chunk->due = due;
+	chunk->len = len;
+	chunk->off = 0;
+	chunk->baud = uart_termios_baud_rate(options);
+	chunk->framing = options->c_cflag & FRAMING_FLAGS;
+	chunk->framed = FALSE;
+	memcpy(chunk->data, data, len);
+	g_queue_insert_sorted(&dest->rx, chunk, chunk_compare, NULL);
+}
+
+static void corrupt(struct virtual_link *link, const struct termios *options, guint8 *data, gsize len)
+{
+	gdouble p;
+	gsize i;
+
+	if (link->ber <= 0)
+		return;
+
+	p = MIN(link->ber * uart_termios_frame_bits(options), 1.0);
+	for (i = 0; i < len; i++)
+		if (g_rand_double(link->rand) < p)
+			data[i] ^= 1 << g_rand_int_range(link->rand, 0, 8);
+}
+
+/*
+ * What the receiver makes of a chunk sent with a different setting.  A
+ * baud rate off by more than a few percent garbles every character and
+ * flags it as a frame error; a framing difference at the right rate is
+ * counted as parity errors.  Called with link->lock held.
+ */
+static void receive_check(struct virtual_endpoint *dest, struct virtual_chunk *chunk)
+{
+	int baud = uart_termios_baud_rate(&dest->options);
+	gsize i;
+
+	chunk->framed = TRUE;
+	dest->icount.rx += chunk->len;
+
+	if (abs(chunk->baud - baud) * 32 > baud) {
+		for (i = 0; i < chunk->len; i++)
+			chunk->data[i] = g_rand_int_range(dest->link->rand, 0, 256);
+		dest->icount.frame += chunk->len;
+	}
+	else if (chunk->framing != (dest->options.c_cflag & FRAMING_FLAGS))
+		dest->icount.parity += chunk->len;
+}
+
+/* called with link->lock held */
+static void transmit(struct virtual_link *link, int from, guint8 *data, gsize len, gint64 now)
+{
+	struct virtual_endpoint *src = &link->ep[from];
+	struct virtual_endpoint *dest = NULL;
+	gint64 start;
+
+	/* a late wakeup of the pump is not idle time on the wire */
+	start = src->wire_free + 1000000 >= now ? src->wire_free : now;
+	src->wire_free = start + char_time(&src->options) * len;
+	src->icount.tx += len;
+
+	switch (link->peer) {
+	case VIRTUAL_PEER_PAIR:
+		if (link->ep[!from].attached)
+			dest = &link->ep[!from];
+		break;
+	case VIRTUAL_PEER_LOOP:
+		dest = src;
+		break;
+	case VIRTUAL_PEER_ACKNAK:
+		src->pending_ack = TRUE;
+		break;
+	}
+	if (!dest)
+		return;
+
+	corrupt(link, &src->options, data, len);
+	queue_chunk(dest, &src->options, data, len, src->wire_free + link->latency);
+}
+
+/* called with link->lock held */
+static void answer(struct virtual_link *link, struct virtual_endpoint *ep, gint64 now)
+{
+	guint8 response = VIRTUAL_ACK;
+	gint64 start;
+	int avail = 0;
+
+	if (!ep->pending_ack || ep->wire_free > now)
+		return;
+	/* only answer once the sender paused */
+	if (ioctl(ep->wire_fd, FIONREAD, &avail) == 0 && avail > 0)
+		return;
+
+	ep->pending_ack = FALSE;
+	if (link->nak_rate > 0 && g_rand_double(link->rand) < link->nak_rate)
+		response = VIRTUAL_NAK;
+
+	start = MAX(now + link->latency, ep->peer_wire_free);
+	ep->peer_wire_free = start + char_time(&ep->options);
+	queue_chunk(ep, &ep->options, &response, 1, ep->peer_wire_free + link->latency);
+}
+
+/* called with link->lock held; returns TRUE if dest can not take more */
+static gboolean deliver(struct virtual_endpoint *dest, gint64 now)
+{
+	struct virtual_chunk *chunk;
+	gssize sent;
+
+	while ((chunk = g_queue_peek_head(&dest->rx)) && chunk->due <= now) {
+		if (!chunk->framed)
+			receive_check(dest, chunk);
+		sent = send(dest->wire_fd, chunk->data + chunk->off, chunk->len - chunk->off,
+			    MSG_DONTWAIT | MSG_NOSIGNAL);
+		if (sent < 0) {
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return TRUE;
+			/* nobody is listening; the line is dead */
+			g_free(g_queue_pop_head(&dest->rx));
+			continue;
+		}
+		chunk->off += sent;
+		if (chunk->off < chunk->len)
+			return TRUE;
+		g_free(g_queue_pop_head(&dest->rx));
+	}
+
+	return FALSE;
+}
+
+static gpointer pump(gpointer data)
+{
+	struct virtual_link *link = data;
+	guint8 buf[VIRTUAL_CHUNK_MAX];
+	struct pollfd pfd[3];
+	int which[3];
+	gboolean blocked[2] = { FALSE, FALSE };
+
+	g_mutex_lock(&link->lock);
+	while (!link->quit) {
+		struct timespec timeout;
+		gint64 now = now_ns();
+		gint64 deadline = G_MAXINT64;
+		struct virtual_chunk *chunk;
+		int n = 0;
+		int i;
+
+		pfd[n].fd = link->wake[0];
+		pfd[n].events = POLLIN;
+		which[n++] = -1;
+		for (i = 0; i < 2; i++) {
+			struct virtual_endpoint *ep = &link->ep[i];
+			short events = 0;
+
+			if (!ep->attached)
+				continue;
+			if (ep->wire_free <= now)
+				events |= POLLIN;
+			else
+				deadline = MIN(deadline, ep->wire_free);
+			if (blocked[i])
+				events |= POLLOUT;
+			else if ((chunk = g_queue_peek_head(&ep->rx)))
+				deadline = MIN(deadline, chunk->due);
+			if (ep->pending_ack)
+				deadline = MIN(deadline, ep->wire_free);
+			pfd[n].fd = ep->wire_fd;
+			pfd[n].events = events;
+			which[n++] = i;
+		}
+
+		if (deadline != G_MAXINT64) {
+			deadline = MAX(deadline - now, 0);
+			timeout.tv_sec = deadline / 1000000000;
+			timeout.tv_nsec = deadline % 1000000000;
+		}
+		g_mutex_unlock(&link->lock);
+		ppoll(pfd, n, deadline == G_MAXINT64 ? NULL : &timeout, NULL);
+		g_mutex_lock(&link->lock);
+
+		if (pfd[0].revents & POLLIN)
+			while (read(link->wake[0], buf, sizeof(buf)) > 0)
+				;
+
+		now = now_ns();
+		for (i = 1; i < n; i++) {
+			struct virtual_endpoint *ep = &link->ep[which[i]];
+			gssize red;
+
+			if (!ep->attached || ep->wire_free > now)
+				continue;
+			red = recv(ep->wire_fd, buf, chunk_max(&ep->options), MSG_DONTWAIT);
+			if (red > 0)
+				transmit(link, which[i], buf, red, now);
+			if (link->peer == VIRTUAL_PEER_ACKNAK)
+				answer(link, ep, now);
+		}
+		for (i = 0; i < 2; i++)
+			if (link->ep[i].attached)
+				blocked[i] = deliver(&link->ep[i], now);
+	}
+	g_mutex_unlock(&link->lock);
+
+	return NULL;
+}
+
+static void wake(struct virtual_link *link)
+{
+	guint8 c = 0;
+
+	if (write(link->wake[1], &c, 1) < 0 && errno != EAGAIN)
+		g_warning("virtual uart %s: cannot wake pump: %s", link->name, strerror(errno));
+}
+
+/* called with links lock held */
+static void pump_start(struct virtual_link *link)
+{
+	link->quit = FALSE;
+	link->pump = g_thread_new("uart-virtual", pump, link);
+}
+
+/* called with links lock held */
+static void pump_stop(struct virtual_link *link)
+{
+	g_mutex_lock(&link->lock);
+	link->quit = TRUE;
+	g_mutex_unlock(&link->lock);
+	wake(link);
+	g_thread_join(link->pump);
+	link->pump = NULL;
+}
+
+static void link_free(struct virtual_link *link)
+{
+	close(link->wake[0]);
+	close(link->wake[1]);
+	g_rand_free(link->rand);
+	g_mutex_clear(&link->lock);
+	g_free(link->name);
+	g_free(link);
+}
+
+static struct virtual_link* link_new(const char *spec)
+{
+	struct virtual_link *link;
+	char **options;
+	char **opt;
+	gboolean seeded = FALSE;
+	guint32 seed = 0;
+	int i;
+
+	options = g_strsplit(spec, ",", -1);
+	if (!options[0] || options[0][0] == '\0') {
+		g_strfreev(options);
+		errno = EINVAL;
+		return NULL;
+	}
+
+	link = g_new0(struct virtual_link, 1);
+	link->name = g_strdup(options[0]);
+	link->peer = VIRTUAL_PEER_PAIR;
+
+	for (opt = options + 1; *opt; opt++) {
+		char *value = strchr(*opt, '=');
+
+		if (!value)
+			goto invalid;
+		*value++ = '\0';
+
+		if (g_str_equal(*opt, "latency"))
+			link->latency = g_ascii_strtoll(value, NULL, 0) * 1000;
+		else if (g_str_equal(*opt, "ber"))
+			link->ber = g_ascii_strtod(value, NULL);
+		else if (g_str_equal(*opt, "nak-rate"))
+			link->nak_rate = g_ascii_strtod(value, NULL);
+		else if (g_str_equal(*opt, "seed")) {
+			seed = g_ascii_strtoull(value, NULL, 0);
+			seeded = TRUE;
+		}
+		else if (g_str_equal(*opt, "peer")) {
+			if (g_str_equal(value, "pair"))
+				link->peer = VIRTUAL_PEER_PAIR;
+			else if (g_str_equal(value, "loop"))
+				link->peer = VIRTUAL_PEER_LOOP;
+			else if (g_str_equal(value, "acknak"))
+				link->peer = VIRTUAL_PEER_ACKNAK;
+			else
+				goto invalid;
+		}
+		else
+			goto invalid;
+	}
+	g_strfreev(options);
+
+	if (pipe2(link->wake, O_CLOEXEC | O_NONBLOCK) < 0) {
+		g_free(link->name);
+		g_free(link);
+		return NULL;
+	}
+	link->rand = seeded ? g_rand_new_with_seed(seed) : g_rand_new();
+	g_mutex_init(&link->lock);
+	for (i = 0; i < 2; i++) {
+		link->ep[i].link = link;
+		link->ep[i].wire_fd = -1;
+		g_queue_init(&link->ep[i].rx);
+	}
+
+	return link;
+
+invalid:
+	g_strfreev(options);
+	g_free(link->name);
+	g_free(link);
+	errno = EINVAL;
+	return NULL;
+}
+
+static int virtual_get_attr(struct uart *uart, struct termios *options)
+{
+	struct virtual_endpoint *ep = uart->backend;
+
+	g_mutex_lock(&ep->link->lock);
+	*options = ep->options;
+	g_mutex_unlock(&ep->link->lock);
+
+	return 0;
+}
+
+static int virtual_flush(struct uart *uart, int queue)
+{
+	struct virtual_endpoint *ep = uart->backend;
+	guint8 buf[VIRTUAL_CHUNK_MAX];
+
+	g_mutex_lock(&ep->link->lock);
+	if (queue == TCIFLUSH || queue == TCIOFLUSH) {
+		g_queue_clear_full(&ep->rx, g_free);
+		while (recv(uart->fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+			;
+	}
+	if (queue == TCOFLUSH || queue == TCIOFLUSH)
+		while (recv(ep->wire_fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+			;
+	g_mutex_unlock(&ep->link->lock);
+
+	return 0;
+}
+
+static int virtual_drain(struct uart *uart)
+{
+	struct virtual_endpoint *ep = uart->backend;
+
+	for (;;) {
+		gint64 wait;
+		int queued = 0;
+
+		ioctl(ep->wire_fd, FIONREAD, &queued);
+		g_mutex_lock(&ep->link->lock);
+		wait = MAX(ep->wire_free - now_ns(), 0);
+		wait += queued * char_time(&ep->options);
+		g_mutex_unlock(&ep->link->lock);
+		if (wait == 0 && queued == 0)
+			return 0;
+
+		/* the pump wakes at the same deadline; don't oversleep it */
+		g_usleep(CLAMP(wait / 1000, 1, 10000));
+	}
+}
+
+static int virtual_output_queue(struct uart *uart)
+{
+	struct virtual_endpoint *ep = uart->backend;
+	int queued = 0;
+
+	if (ioctl(ep->wire_fd, FIONREAD, &queued) < 0)
+		return -1;
+	return queued;
+}
+
+static int virtual_get_icount(struct uart *uart, struct uart_icount *icount)
+{
+	struct virtual_endpoint *ep = uart->backend;
+
+	g_mutex_lock(&ep->link->lock);
+	*icount = ep->icount;
+	g_mutex_unlock(&ep->link->lock);
+
+	return 0;
+}
+
+/*
+ * The modem lines work like a null modem cable: RTS shows up as the
+ * other end's CTS, DTR as its DSR and DCD.  An emulated peer keeps its
+ * own lines up, and a loop sees its own.
+ */
+static int lines_in(struct virtual_endpoint *ep)
+{
+	struct virtual_link *link = ep->link;
+	int out;
+
+	switch (link->peer) {
+	case VIRTUAL_PEER_LOOP:
+		out = g_atomic_int_get(&ep->lines_out);
+		break;
+	case VIRTUAL_PEER_ACKNAK:
+		out = VIRTUAL_LINES_OUT;
+		break;
+	case VIRTUAL_PEER_PAIR:
+	default:
+		out = g_atomic_int_get(&link->ep[ep == &link->ep[0]].lines_out);
+		break;
+	}
+
+	return ((out & TIOCM_RTS) ? TIOCM_CTS : 0) | ((out & TIOCM_DTR) ? TIOCM_DSR | TIOCM_CD : 0);
+}
+
+static void lines_changed(struct virtual_link *link)
+{
+	g_atomic_int_inc(&link->lines_seq);
+	syscall(SYS_futex, &link->lines_seq, FUTEX_WAKE_PRIVATE, G_MAXINT, NULL, NULL, 0);
+}
+
+static int virtual_get_lines(struct uart *uart)
+{
+	struct virtual_endpoint *ep = uart->backend;
+
+	return g_atomic_int_get(&ep->lines_out) | lines_in(ep);
+}
+
+/*
+ * A futex on lines_seq does the waiting; unlike a GCond it returns
+ * EINTR on a signal, as TIOCMIWAIT does (see uartlines.c).
+ */
+static int virtual_wait_lines(struct uart *uart, int mask)
+{
+	struct virtual_endpoint *ep = uart->backend;
+	gint *seq = &ep->link->lines_seq;
+	int before = virtual_get_lines(uart);
+
+	for (;;) {
+		gint now = g_atomic_int_get(seq);
+
+		if ((virtual_get_lines(uart) ^ before) & mask)
+			return 0;
+		if (syscall(SYS_futex, seq, FUTEX_WAIT_PRIVATE, now, NULL, NULL, 0) < 0 &&
+		    errno != EAGAIN)
+			return -1;
+	}
+}
+
+static int virtual_set_lines(struct uart *uart, int set, int clear)
+{
+	struct virtual_endpoint *ep = uart->backend;
+	gint old, new;
+
+	do {
+		old = g_atomic_int_get(&ep->lines_out);
+		new = ((old | set) & ~clear) & VIRTUAL_LINES_OUT;
+	} while (!g_atomic_int_compare_and_exchange(&ep->lines_out, old, new));
+	if (new != old)
+		lines_changed(ep->link);
+
+	return 0;
+}
+
+static int virtual_set_attr(struct uart *uart, int when, const struct termios *options)
+{
+	struct virtual_endpoint *ep = uart->backend;
+
+	if (when == TCSADRAIN || when == TCSAFLUSH)
+		virtual_drain(uart);
+	if (when == TCSAFLUSH)
+		virtual_flush(uart, TCIFLUSH);
+
+	g_mutex_lock(&ep->link->lock);
+	ep->options = *options;
+	g_mutex_unlock(&ep->link->lock);
+	wake(ep->link);
+
+	return 0;
+}
+
+static void virtual_close(struct uart *uart)
+{
+	struct virtual_endpoint *ep = uart->backend;
+	struct virtual_link *link = ep->link;
+
+	G_LOCK(links);
+	pump_stop(link);
+
+	ep->attached = FALSE;
+	ep->pending_ack = FALSE;
+	g_atomic_int_set(&ep->lines_out, 0);
+	lines_changed(link);
+	g_queue_clear_full(&ep->rx, g_free);
+	close(ep->wire_fd);
+	ep->wire_fd = -1;
+	close(uart->fd);
+
+	if (--link->users == 0) {
+		g_hash_table_remove(links, link->name);
+		link_free(link);
+	}
+	else
+		pump_start(link);
+	G_UNLOCK(links);
+}
+
+static const struct uart_ops virtual_ops = {
+	.get_attr = virtual_get_attr,
+	.set_attr = virtual_set_attr,
+	.flush = virtual_flush,
+	.drain = virtual_drain,
+	.output_queue = virtual_output_queue,
+	.get_icount = virtual_get_icount,
+	.get_lines = virtual_get_lines,
+	.wait_lines = virtual_wait_lines,
+	.set_lines = virtual_set_lines,
+	.close = virtual_close,
+};
+
+gboolean uart_virtual_is_virtual(const char *name)
+{
+	return name && g_str_has_prefix(name, UART_VIRTUAL_PREFIX);
+}
+
+struct uart* uart_virtual_open(const char *name, int flags)
+{
+	struct virtual_link *link;
+	struct virtual_endpoint *ep;
+	struct uart *uart;
+	const char *spec;
+	char *key;
+	int sv[2];
+
+	g_return_val_if_fail(uart_virtual_is_virtual(name), NULL);
+
+	spec = name + strlen(UART_VIRTUAL_PREFIX);
+	key = g_strndup(spec, strcspn(spec, ","));
+
+	G_LOCK(links);
+	if (!links)
+		links = g_hash_table_new(g_str_hash, g_str_equal);
+
+	link = g_hash_table_lookup(links, key);
+	g_free(key);
+	if (!link) {
+		link = link_new(spec);
+		if (!link)
+			goto failed;
+		g_hash_table_insert(links, link->name, link);
+	}
+	else if (link->ep[0].attached && link->ep[1].attached) {
+		errno = EBUSY;
+		goto failed;
+	}
+	else
+		pump_stop(link);
+
+	if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sv) < 0)
+		goto socket_failed;
+
+	ep = link->ep[0].attached ? &link->ep[1] : &link->ep[0];
+	ep->attached = TRUE;
+	ep->wire_fd = sv[1];
+	fcntl(ep->wire_fd, F_SETFL, O_NONBLOCK);
+	ep->wire_free = 0;
+	ep->peer_wire_free = 0;
+	ep->pending_ack = FALSE;
+	memset(&ep->options, 0, sizeof(ep->options));
+	memset(&ep->icount, 0, sizeof(ep->icount));
+	/* raised on open, as a tty does */
+	g_atomic_int_set(&ep->lines_out, VIRTUAL_LINES_OUT);
+	lines_changed(link);
+	cfmakeraw(&ep->options);
+	ep->options.c_cflag |= CS8 | CREAD | CLOCAL;
+	cfsetspeed(&ep->options, B9600);
+	link->users++;
+	pump_start(link);
+	G_UNLOCK(links);
+
+	if (flags & O_NONBLOCK)
+		fcntl(sv[0], F_SETFL, O_NONBLOCK);
+
+	uart = g_new0(struct uart, 1);
+	uart->ops = &virtual_ops;
+	uart->backend = ep;
+	uart->fd = sv[0];
+	uart->current = ep->options;
+	uart->orig = ep->options;
+
+	return uart;
+
+socket_failed:
+	if (link->users == 0) {
+		int saved = errno;
+		g_hash_table_remove(links, link->name);
+		link_free(link);
+		errno = saved;
+	}
+	else
+		pump_start(link);
+failed:
+	G_UNLOCK(links);
+	return NULL;
+}
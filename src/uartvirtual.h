@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glib.h>
+#include "uart.h"
+
+/*
+ * In-process virtual UART.  Device names of the form
+ *
+ *   virtual:NAME[,option=value...]
+ *
+ * are opened as one end of an emulated serial line instead of a tty.
+ * Two opens of the same NAME are connected to each other, so a
+ * uartsink and a uartsrc with the same device talk through it.
+ *
+ * Options (taken from the first open of a line):
+ *   latency=USEC    one-way delivery latency, in micro sec
+ *   ber=FLOAT       bit error rate applied to delivered data
+ *   peer=MODE       pair (default), loop (echo back to the sender), or
+ *                   acknak (answer each burst with ACK / NAK)
+ *   nak-rate=FLOAT  probability of NAK instead of ACK for peer=acknak
+ *   seed=UINT       seed for the error / nak generator
+ *
+ * Data is paced at the baud rate and framing the sender configured.
+ * A receiver set to another baud rate gets garbage and frame errors,
+ * one with other parity settings parity errors (see uart_get_icount()).
+ */
+#define UART_VIRTUAL_PREFIX "virtual:"
+
+gboolean uart_virtual_is_virtual(const char *name);
+struct uart* uart_virtual_open(const char *name, int flags);
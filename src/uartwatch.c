@@ -0,0 +1,108 @@
+#include <errno.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <glib.h>
+#include "uartvirtual.h"
+#include "uartwatch.h"
+
+#define WATCH_EVENTS (IN_CREATE | IN_MOVED_TO | IN_ATTRIB | IN_DELETE_SELF | IN_MOVE_SELF)
+
+struct uart_watch {
+	char *path;
+	char *dir;		/* currently watched */
+	int fd;
+	int wd;
+};
+
+/* the deepest directory on the way to the device node that exists */
+static char* watch_dir(const char *path)
+{
+	char *dir = g_path_get_dirname(path);
+
+	while (!g_file_test(dir, G_FILE_TEST_IS_DIR)) {
+		char *parent = g_path_get_dirname(dir);
+
+		if (g_str_equal(parent, dir)) {
+			g_free(parent);
+			break;
+		}
+		g_free(dir);
+		dir = parent;
+	}
+
+	return dir;
+}
+
+static void watch_arm(struct uart_watch *watch)
+{
+	char *dir = watch_dir(watch->path);
+
+	/* removing a watch queues an event itself; don't loop on it */
+	if (watch->dir && g_str_equal(dir, watch->dir)) {
+		g_free(dir);
+		return;
+	}
+
+	if (watch->wd >= 0)
+		inotify_rm_watch(watch->fd, watch->wd);
+	watch->wd = inotify_add_watch(watch->fd, dir, WATCH_EVENTS | IN_ONLYDIR);
+	g_free(watch->dir);
+	watch->dir = dir;
+}
+
+struct uart_watch* uart_watch_new(const char *name)
+{
+	struct uart_watch *watch;
+
+	watch = g_new0(struct uart_watch, 1);
+	watch->fd = -1;
+	watch->wd = -1;
+
+	if (uart_virtual_is_virtual(name))
+		return watch;
+
+	watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->fd < 0)
+		return watch;
+
+	watch->path = g_strdup(name);
+	watch_arm(watch);
+
+	return watch;
+}
+
+int uart_watch_get_fd(struct uart_watch *watch)
+{
+	g_return_val_if_fail(watch, -1);
+
+	return watch->fd;
+}
+
+/* drain pending events; the directory to watch may have changed */
+void uart_watch_consume(struct uart_watch *watch)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	gboolean seen = FALSE;
+
+	g_return_if_fail(watch);
+
+	if (watch->fd < 0)
+		return;
+
+	while (read(watch->fd, buf, sizeof(buf)) > 0)
+		seen = TRUE;
+	if (seen)
+		watch_arm(watch);
+}
+
+void uart_watch_free(struct uart_watch *watch)
+{
+	if (!watch)
+		return;
+
+	if (watch->fd >= 0)
+		close(watch->fd);
+	g_free(watch->path);
+	g_free(watch->dir);
+	g_free(watch);
+}
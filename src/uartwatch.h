@@ -0,0 +1,18 @@
+#pragma once
+
+#include <glib.h>
+
+/*
+ * Waiting for a device node to come back, e.g. after a USB serial
+ * adapter reset.  The watch follows the device path (a by-id symlink
+ * works as well) with inotify on the nearest directory that exists,
+ * and its fd gets readable when something there may have changed.  The
+ * fd is -1 if nothing can be watched (virtual devices, no inotify);
+ * callers are expected to retry the open periodically regardless.
+ */
+struct uart_watch;
+
+struct uart_watch* uart_watch_new(const char *name);
+int uart_watch_get_fd(struct uart_watch *watch);
+void uart_watch_consume(struct uart_watch *watch);
+void uart_watch_free(struct uart_watch *watch);
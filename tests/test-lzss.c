@@ -0,0 +1,168 @@
+#include <string.h>
+#include <glib.h>
+#include "lzss.h"
+
+#define BLOCK (1000)
+
+/* something that compresses, different for every block */
+static void
+fill(guint8 *data, gsize len, guint seed)
+{
+	static const char *words[] = { "uart ", "frame ", "parity ", "baud ", "stop bit " };
+	gsize i = 0;
+
+	while (i < len) {
+		const char *word = words[seed++ * 7 % G_N_ELEMENTS(words)];
+		gsize n = MIN(strlen(word), len - i);
+
+		memcpy(data + i, word, n);
+		i += n;
+	}
+}
+
+/* pack blocks of BLOCK bytes, a reset wherever reset[] says */
+static GByteArray *
+pack(struct lzss *lzss, GByteArray *raw, const gboolean *reset, guint blocks, GArray *sizes)
+{
+	GByteArray *wire = g_byte_array_new();
+	guint8 in[BLOCK];
+	guint8 out[LZSS_BLOCK_BOUND(BLOCK)];
+	guint i;
+
+	for (i = 0; i < blocks; i++) {
+		guint size;
+
+		fill(in, sizeof(in), i);
+		g_byte_array_append(raw, in, sizeof(in));
+		size = lzss_block_pack(lzss, in, sizeof(in), reset[i], out);
+		g_assert_cmpuint(size, >, 0);
+		g_assert_cmpuint(size, <=, sizeof(out));
+		g_byte_array_append(wire, out, size);
+		if (sizes)
+			g_array_append_val(sizes, size);
+	}
+
+	return wire;
+}
+
+static GByteArray *
+unpack(struct lzss_unpacker *unpacker, const GByteArray *wire, gsize step)
+{
+	GByteArray *out = g_byte_array_new();
+	gsize offset;
+
+	for (offset = 0; offset < wire->len; offset += step)
+		lzss_unpack(unpacker, wire->data + offset, MIN(step, wire->len - offset), out);
+
+	return out;
+}
+
+/* the dictionary carries over from block to block, in pieces of any size */
+static void
+test_lzss_roundtrip(void)
+{
+	static const gboolean reset[] = { TRUE, FALSE, FALSE, FALSE };
+	static const gsize steps[] = { 1, 7, 100, 100000 };
+	struct lzss lzss;
+	GByteArray *raw = g_byte_array_new();
+	GByteArray *wire;
+	guint i;
+
+	lzss_init(&lzss, 10, 4);
+	wire = pack(&lzss, raw, reset, G_N_ELEMENTS(reset), NULL);
+	g_assert_cmpuint(lzss.stored, ==, 0);
+	g_assert_cmpuint(wire->len, <, raw->len);
+
+	for (i = 0; i < G_N_ELEMENTS(steps); i++) {
+		struct lzss_unpacker unpacker;
+		GByteArray *out;
+
+		lzss_unpacker_init(&unpacker);
+		out = unpack(&unpacker, wire, steps[i]);
+		g_assert_cmpmem(out->data, out->len, raw->data, raw->len);
+		g_assert_cmpuint(unpacker.lzss.blocks, ==, G_N_ELEMENTS(reset));
+		g_assert_cmpuint(unpacker.lzss.errors, ==, 0);
+		lzss_unpacker_clear(&unpacker);
+		g_byte_array_unref(out);
+	}
+
+	lzss_clear(&lzss);
+	g_byte_array_unref(wire);
+	g_byte_array_unref(raw);
+}
+
+/* what does not get smaller goes as is */
+static void
+test_lzss_stored(void)
+{
+	guint8 in[256];
+	guint8 out[LZSS_BLOCK_BOUND(sizeof(in))];
+	struct lzss lzss;
+	struct lzss_unpacker unpacker;
+	GByteArray *decoded = g_byte_array_new();
+	GRand *rand = g_rand_new_with_seed(1);
+	gsize size;
+	guint i;
+
+	for (i = 0; i < sizeof(in); i++)
+		in[i] = g_rand_int(rand);
+	lzss_init(&lzss, 8, 3);
+	size = lzss_block_pack(&lzss, in, sizeof(in), TRUE, out);
+	g_assert_cmpuint(size, ==, LZSS_BLOCK_BOUND(sizeof(in)));
+	g_assert_cmpuint(out[1] & LZSS_FLAG_COMPRESSED, ==, 0);
+	g_assert_cmpuint(lzss.stored, ==, 1);
+
+	lzss_unpacker_init(&unpacker);
+	lzss_unpack(&unpacker, out, size, decoded);
+	g_assert_cmpmem(decoded->data, decoded->len, in, sizeof(in));
+
+	lzss_unpacker_clear(&unpacker);
+	lzss_clear(&lzss);
+	g_byte_array_unref(decoded);
+	g_rand_free(rand);
+}
+
+/* a bad block is lost, and so is the rest until the next reset */
+static void
+test_lzss_corrupt(void)
+{
+	static const gboolean reset[] = { TRUE, FALSE, FALSE, TRUE };
+	struct lzss lzss;
+	struct lzss_unpacker unpacker;
+	GByteArray *raw = g_byte_array_new();
+	GArray *sizes = g_array_new(FALSE, FALSE, sizeof(guint));
+	GByteArray *wire;
+	GByteArray *out;
+	guint first;
+
+	lzss_init(&lzss, 10, 4);
+	wire = pack(&lzss, raw, reset, G_N_ELEMENTS(reset), sizes);
+	first = g_array_index(sizes, guint, 0);
+	wire->data[first + LZSS_BLOCK_HEADER + 10] ^= 0x01;
+
+	lzss_unpacker_init(&unpacker);
+	out = unpack(&unpacker, wire, 64);
+	g_assert_cmpuint(out->len, ==, 2 * BLOCK);
+	g_assert_cmpmem(out->data, BLOCK, raw->data, BLOCK);
+	g_assert_cmpmem(out->data + BLOCK, BLOCK, raw->data + 3 * BLOCK, BLOCK);
+	g_assert_cmpuint(unpacker.lzss.errors, >=, 2);
+
+	lzss_unpacker_clear(&unpacker);
+	lzss_clear(&lzss);
+	g_byte_array_unref(out);
+	g_byte_array_unref(wire);
+	g_byte_array_unref(raw);
+	g_array_unref(sizes);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/lzss/roundtrip", test_lzss_roundtrip);
+	g_test_add_func("/lzss/stored", test_lzss_stored);
+	g_test_add_func("/lzss/corrupt", test_lzss_corrupt);
+
+	return g_test_run();
+}
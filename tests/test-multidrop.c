@@ -0,0 +1,132 @@
+#include <string.h>
+#include <glib.h>
+#include "multidrop.h"
+
+/* two frames, for 0x01 and 0x02, with a 0xff in each */
+static const guint8 line[] = {
+	0xff, 0x00, 0x01, 0x10, 0xff, 0xff, 0x11,
+	0xff, 0x00, 0x02, 0x20, 0xff, 0xff, 0x21,
+};
+
+/* all of in, in pieces of at most step bytes, as uartsrc would hand it */
+static GByteArray *
+unpack(struct multidrop *md, const guint8 *in, gsize len, gsize step)
+{
+	GByteArray *out = g_byte_array_new();
+	guint8 buf[64];
+	gsize offset = 0;
+
+	while (offset < len) {
+		gsize size = MIN(step, len - offset);
+		gsize used;
+		gsize n;
+
+		memcpy(buf, in + offset, size);
+		n = multidrop_unpack(md, buf, size, FALSE, &used);
+		g_assert_cmpuint(n, <=, used);
+		g_byte_array_append(out, buf, n);
+		offset += used;
+	}
+
+	return out;
+}
+
+static void
+test_multidrop_all(void)
+{
+	static const guint8 expect[] = { 0x01, 0x10, 0xff, 0x11, 0x02, 0x20, 0xff, 0x21 };
+	struct multidrop md;
+	GByteArray *out;
+
+	multidrop_init(&md);
+	out = unpack(&md, line, sizeof(line), sizeof(line));
+	g_assert_cmpmem(out->data, out->len, expect, sizeof(expect));
+	g_assert_cmpuint(md.frames, ==, 2);
+	g_assert_cmpuint(md.passed, ==, 2);
+	g_assert_cmpuint(md.dropped, ==, 0);
+	g_byte_array_unref(out);
+}
+
+static void
+test_multidrop_filter(void)
+{
+	static const guint8 expect[] = { 0x02, 0x20, 0xff, 0x21 };
+	gsize step;
+
+	for (step = 1; step <= sizeof(line); step++) {
+		struct multidrop md;
+		GByteArray *out;
+
+		multidrop_init(&md);
+		multidrop_add_address(&md, 0x02);
+		multidrop_reset(&md);
+		out = unpack(&md, line, sizeof(line), step);
+		g_assert_cmpmem(out->data, out->len, expect, sizeof(expect));
+		g_assert_cmpuint(md.frames, ==, 2);
+		g_assert_cmpuint(md.passed, ==, 1);
+		g_assert_cmpuint(md.dropped, ==, 4);
+		g_byte_array_unref(out);
+	}
+}
+
+/* a frame for us ends what we have; the rest is handed in again */
+static void
+test_multidrop_split(void)
+{
+	guint8 buf[sizeof(line)];
+	struct multidrop md;
+	gsize used;
+	gsize n;
+
+	multidrop_init(&md);
+	memcpy(buf, line, sizeof(line));
+	n = multidrop_unpack(&md, buf, sizeof(buf), FALSE, &used);
+	g_assert_cmpuint(n, ==, 4);
+	g_assert_cmpuint(used, ==, 9);
+	g_assert_cmpuint(buf[0], ==, 0x01);
+
+	memmove(buf, buf + used, sizeof(line) - used);
+	n = multidrop_unpack(&md, buf, sizeof(line) - used, FALSE, &used);
+	g_assert_cmpuint(n, ==, 4);
+	g_assert_cmpuint(used, ==, sizeof(line) - 9);
+	g_assert_cmpuint(buf[0], ==, 0x02);
+}
+
+/* a lone 0xff carried over does not get ahead of the data after it */
+static void
+test_multidrop_lone(void)
+{
+	static const guint8 in[] = { 0xff, 0x41, 0x42, 0x43, 0xff, 0xff, 0x44 };
+	static const guint8 expect[] = { 0xff, 0x41, 0x42, 0x43, 0xff, 0x44 };
+	gsize step;
+
+	for (step = 1; step <= sizeof(in); step++) {
+		struct multidrop md;
+		GByteArray *out;
+		int held;
+
+		multidrop_init(&md);
+		out = unpack(&md, in, sizeof(in), step);
+		held = parmrk_escape_release(&md.esc);
+		if (held >= 0) {
+			guint8 c = held;
+
+			g_byte_array_append(out, &c, 1);
+		}
+		g_assert_cmpmem(out->data, out->len, expect, sizeof(expect));
+		g_byte_array_unref(out);
+	}
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/multidrop/all", test_multidrop_all);
+	g_test_add_func("/multidrop/filter", test_multidrop_filter);
+	g_test_add_func("/multidrop/split", test_multidrop_split);
+	g_test_add_func("/multidrop/lone", test_multidrop_lone);
+
+	return g_test_run();
+}
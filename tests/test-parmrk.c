@@ -0,0 +1,129 @@
+#include <string.h>
+#include <glib.h>
+#include "parmrk.h"
+
+/* unpack in in pieces of at most step bytes, as reads would give them */
+static GByteArray *
+unpack(struct parmrk *parmrk, const guint8 *in, gsize len, gsize step, GArray *errors)
+{
+	GByteArray *out = g_byte_array_new();
+	guint8 buf[64];
+	gsize offset;
+
+	g_assert_cmpuint(step, <=, sizeof(buf));
+	for (offset = 0; offset < len; offset += step) {
+		gsize size = MIN(step, len - offset);
+		gsize n;
+
+		memcpy(buf, in + offset, size);
+		n = parmrk_unpack(parmrk, buf, size, errors, out->len);
+		g_assert_cmpuint(n, <=, size);
+		g_byte_array_append(out, buf, n);
+	}
+
+	return out;
+}
+
+static void
+test_parmrk_clean(void)
+{
+	struct parmrk parmrk;
+	guint8 in[40];
+	GByteArray *out;
+	guint i;
+
+	for (i = 0; i < sizeof(in); i++)
+		in[i] = i * 7;
+	parmrk_init(&parmrk);
+	out = unpack(&parmrk, in, sizeof(in), sizeof(in), NULL);
+	g_assert_cmpmem(out->data, out->len, in, sizeof(in));
+	g_assert_cmpuint(parmrk.errors, ==, 0);
+	g_byte_array_unref(out);
+}
+
+static void
+test_parmrk_marks(void)
+{
+	static const guint8 in[] = {
+		0x01, 0xff, 0xff, 0x02,		/* a real 0xff */
+		0xff, 0x00, 0x55, 0x03,		/* a bad byte */
+		0xff, 0x00, 0x00, 0x04,		/* a break */
+	};
+	static const guint8 expect[] = { 0x01, 0xff, 0x02, 0x55, 0x03, 0x00, 0x04 };
+	gsize step;
+
+	/* marks cut anywhere by the ends of the reads */
+	for (step = 1; step <= sizeof(in); step++) {
+		struct parmrk parmrk;
+		GArray *errors = g_array_new(FALSE, FALSE, sizeof(guint));
+		GByteArray *out;
+
+		parmrk_init(&parmrk);
+		out = unpack(&parmrk, in, sizeof(in), step, errors);
+		g_assert_cmpmem(out->data, out->len, expect, sizeof(expect));
+		g_assert_cmpuint(parmrk.errors, ==, 2);
+		g_assert_cmpuint(errors->len, ==, 2);
+		g_assert_cmpuint(g_array_index(errors, guint, 0), ==, 3);
+		g_assert_cmpuint(g_array_index(errors, guint, 1), ==, 5);
+		g_byte_array_unref(out);
+		g_array_unref(errors);
+	}
+}
+
+/* a 0xff without PARMRK is data, however the reads cut it */
+static void
+test_parmrk_lone(void)
+{
+	static const guint8 in[] = { 0xff, 0x41, 0x42, 0x43, 0xff, 0x44, 0xff, 0xff, 0x45 };
+	static const guint8 expect[] = { 0xff, 0x41, 0x42, 0x43, 0xff, 0x44, 0xff, 0x45 };
+	gsize step;
+
+	for (step = 1; step <= sizeof(in); step++) {
+		struct parmrk parmrk;
+		GByteArray *out;
+		int held;
+
+		parmrk_init(&parmrk);
+		out = unpack(&parmrk, in, sizeof(in), step, NULL);
+		/* whatever did not fit yet is held back */
+		held = parmrk_escape_release(&parmrk.esc);
+		if (held >= 0) {
+			guint8 c = held;
+
+			g_byte_array_append(out, &c, 1);
+		}
+		g_assert_cmpmem(out->data, out->len, expect, sizeof(expect));
+		g_assert_cmpuint(parmrk.errors, ==, 0);
+		g_byte_array_unref(out);
+	}
+}
+
+static void
+test_parmrk_reset(void)
+{
+	static const guint8 mark[] = { 0xff, 0x00 };
+	static const guint8 in[] = { 0x10, 0x11 };
+	struct parmrk parmrk;
+	GByteArray *out;
+
+	parmrk_init(&parmrk);
+	g_byte_array_unref(unpack(&parmrk, mark, sizeof(mark), sizeof(mark), NULL));
+	parmrk_reset(&parmrk);
+	out = unpack(&parmrk, in, sizeof(in), sizeof(in), NULL);
+	g_assert_cmpmem(out->data, out->len, in, sizeof(in));
+	g_assert_cmpuint(parmrk.errors, ==, 0);
+	g_byte_array_unref(out);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/parmrk/clean", test_parmrk_clean);
+	g_test_add_func("/parmrk/marks", test_parmrk_marks);
+	g_test_add_func("/parmrk/lone", test_parmrk_lone);
+	g_test_add_func("/parmrk/reset", test_parmrk_reset);
+
+	return g_test_run();
+}
@@ -0,0 +1,89 @@
+#include <glib.h>
+#include "pps.h"
+
+#define SECOND (G_GUINT64_CONSTANT(1000000000))
+#define START (5 * SECOND)
+#define LATENCY (20000)	/* ns, at most */
+#define SLOPE (2 * LATENCY / PPS_FIT)	/* ns a second the fit may be off by */
+
+/* scheduling latency, the same every run */
+static guint64
+latency(guint i)
+{
+	return (i * 7919) % LATENCY;
+}
+
+static void
+test_pps_lock(void)
+{
+	struct pps pps;
+	guint i;
+
+	pps_reset(&pps);
+	for (i = 0; i < PPS_LOCK - 1; i++)
+		g_assert_false(pps_pulse(&pps, START + i * SECOND + latency(i)));
+	g_assert_true(pps_pulse(&pps, START + i * SECOND + latency(i)));
+	g_assert_cmpuint(pps.index, ==, PPS_LOCK);
+	g_assert_cmpuint(pps.rejected, ==, 0);
+}
+
+/* a host clock 50 ppm fast: a reference second is longer in host ns */
+static void
+test_pps_fit(void)
+{
+	const gdouble period = SECOND * 1.00005;
+	guint64 last = 0;
+	struct pps pps;
+	guint i;
+
+	pps_reset(&pps);
+	for (i = 0; i < 3 * PPS_FIT; i++) {
+		last = START + (guint64)(i * period);
+		pps_pulse(&pps, last + latency(i));
+	}
+	g_assert_true(pps.locked);
+	g_assert_cmpfloat(ABS(pps.period - period), <, SLOPE);
+	g_assert_cmpfloat(pps.jitter, <, LATENCY);
+	/* latency only adds, so the fit goes down to the earliest pulses */
+	g_assert_cmpuint(pps.edge, <=, last + LATENCY);
+	g_assert_cmpuint(pps.edge + LATENCY, >=, last);
+	g_assert_cmpuint(pps_host_to_reference(&pps, (guint64)(10 * period)), >, 10 * SECOND - 10 * SLOPE);
+	g_assert_cmpuint(pps_host_to_reference(&pps, (guint64)(10 * period)), <, 10 * SECOND + 10 * SLOPE);
+}
+
+/* a pulse out of place throws the fit away, and it locks again */
+static void
+test_pps_glitch(void)
+{
+	struct pps pps;
+	guint64 t = START;
+	guint i;
+
+	pps_reset(&pps);
+	for (i = 0; i < PPS_LOCK; i++, t += SECOND)
+		pps_pulse(&pps, t);
+	g_assert_true(pps.locked);
+
+	g_assert_false(pps_pulse(&pps, t - SECOND / 2));
+	g_assert_cmpuint(pps.rejected, ==, 1);
+	/* unlocked, durations go through as they are */
+	g_assert_cmpuint(pps_host_to_reference(&pps, 12345), ==, 12345);
+
+	t = t - SECOND / 2;
+	for (i = 1; i < PPS_LOCK; i++)
+		pps_pulse(&pps, t + i * SECOND);
+	g_assert_true(pps.locked);
+	g_assert_cmpuint(pps.rejected, ==, 1);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/pps/lock", test_pps_lock);
+	g_test_add_func("/pps/fit", test_pps_fit);
+	g_test_add_func("/pps/glitch", test_pps_glitch);
+
+	return g_test_run();
+}
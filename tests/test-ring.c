@@ -0,0 +1,107 @@
+#include <glib.h>
+#include "ring.h"
+
+#define PASSES (100000)
+
+static void
+test_ring_size(void)
+{
+	struct ring ring;
+
+	ring_init(&ring, 5);
+	g_assert_cmpuint(ring_size(&ring), ==, 8);
+	ring_clear(&ring);
+
+	ring_init(&ring, 16);
+	g_assert_cmpuint(ring_size(&ring), ==, 16);
+	ring_clear(&ring);
+}
+
+static void
+test_ring_order(void)
+{
+	struct ring ring;
+	guint i;
+
+	ring_init(&ring, 4);
+	g_assert_null(ring_pop(&ring));
+	for (i = 1; i <= 4; i++)
+		g_assert_true(ring_push(&ring, GUINT_TO_POINTER(i)));
+	g_assert_false(ring_push(&ring, GUINT_TO_POINTER(5)));
+	g_assert_cmpuint(ring_count(&ring), ==, 4);
+
+	for (i = 1; i <= 4; i++)
+		g_assert_cmpuint(GPOINTER_TO_UINT(ring_pop(&ring)), ==, i);
+	g_assert_null(ring_pop(&ring));
+	g_assert_cmpuint(ring_count(&ring), ==, 0);
+	ring_clear(&ring);
+}
+
+/* the indexes run past the size many times over */
+static void
+test_ring_wrap(void)
+{
+	struct ring ring;
+	guint i;
+
+	ring_init(&ring, 4);
+	for (i = 1; i <= 1000; i++) {
+		g_assert_true(ring_push(&ring, GUINT_TO_POINTER(i)));
+		g_assert_true(ring_push(&ring, GUINT_TO_POINTER(i + 1)));
+		g_assert_cmpuint(GPOINTER_TO_UINT(ring_pop(&ring)), ==, i);
+		g_assert_cmpuint(GPOINTER_TO_UINT(ring_pop(&ring)), ==, i + 1);
+	}
+	g_assert_cmpuint(ring_count(&ring), ==, 0);
+	ring_clear(&ring);
+}
+
+static gpointer
+producer(gpointer data)
+{
+	struct ring *ring = data;
+	guint i;
+
+	for (i = 1; i <= PASSES; i++)
+		while (!ring_push(ring, GUINT_TO_POINTER(i)))
+			g_thread_yield();
+
+	return NULL;
+}
+
+/* one producer and one consumer thread, everything in order */
+static void
+test_ring_threads(void)
+{
+	struct ring ring;
+	GThread *thread;
+	guint expect = 1;
+
+	ring_init(&ring, 64);
+	thread = g_thread_new("producer", producer, &ring);
+	while (expect <= PASSES) {
+		gpointer data = ring_pop(&ring);
+
+		if (!data) {
+			g_thread_yield();
+			continue;
+		}
+		g_assert_cmpuint(GPOINTER_TO_UINT(data), ==, expect);
+		expect++;
+	}
+	g_thread_join(thread);
+	g_assert_null(ring_pop(&ring));
+	ring_clear(&ring);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/ring/size", test_ring_size);
+	g_test_add_func("/ring/order", test_ring_order);
+	g_test_add_func("/ring/wrap", test_ring_wrap);
+	g_test_add_func("/ring/threads", test_ring_threads);
+
+	return g_test_run();
+}
@@ -0,0 +1,134 @@
+#include <string.h>
+#include <glib.h>
+#include "rs.h"
+
+#define NROOTS (8)
+#define DEPTH (4)
+
+/* up to nroots / 2 bad bytes anywhere in a codeword are corrected */
+static void
+test_rs_codeword(void)
+{
+	GRand *rand = g_rand_new_with_seed(2);
+	struct rs rs;
+	guint pass;
+
+	rs_init(&rs, NROOTS);
+	for (pass = 0; pass < 200; pass++) {
+		guint8 sent[RS_SYMBOLS];
+		guint8 codeword[RS_SYMBOLS];
+		gsize k = g_rand_int_range(rand, 1, RS_SYMBOLS - NROOTS + 1);
+		guint bad = g_rand_int_range(rand, 0, NROOTS / 2 + 1);
+		guint i;
+
+		for (i = 0; i < k; i++)
+			sent[i] = g_rand_int(rand);
+		rs_encode(&rs, sent, k, sent + k);
+		memcpy(codeword, sent, k + NROOTS);
+		g_assert_cmpint(rs_decode(&rs, codeword, k + NROOTS), ==, 0);
+
+		/* bad distinct bytes, each really changed */
+		for (i = 0; i < bad;) {
+			gsize at = g_rand_int_range(rand, 0, k + NROOTS);
+
+			if (codeword[at] != sent[at])
+				continue;
+			codeword[at] ^= g_rand_int_range(rand, 1, 256);
+			i++;
+		}
+		g_assert_cmpint(rs_decode(&rs, codeword, k + NROOTS), ==, bad);
+		g_assert_cmpmem(codeword, k + NROOTS, sent, k + NROOTS);
+	}
+	g_rand_free(rand);
+}
+
+static GByteArray *
+unpack(struct rs_unpacker *unpacker, const guint8 *wire, gsize len, gsize step)
+{
+	GByteArray *out = g_byte_array_new();
+	gsize offset;
+
+	for (offset = 0; offset < len; offset += step)
+		rs_unpack(unpacker, wire + offset, MIN(step, len - offset), out);
+
+	return out;
+}
+
+/* a burst of depth * nroots / 2 bytes, and a garbled header */
+static void
+test_rs_frame(void)
+{
+	static const gsize steps[] = { 1, 13, 4096 };
+	guint8 in[600];
+	guint8 wire[RS_FRAME_BOUND(DEPTH) + 3];
+	struct rs_frame frame;
+	gsize size;
+	guint i;
+
+	for (i = 0; i < sizeof(in); i++)
+		in[i] = i * 13 + 5;
+	rs_frame_init(&frame, NROOTS, DEPTH);
+	/* some noise ahead of the frame */
+	wire[0] = RS_SYNC1;
+	wire[1] = 0x00;
+	wire[2] = RS_SYNC0;
+	size = rs_frame_pack(&frame, in, sizeof(in), wire + 3);
+	g_assert_cmpuint(size, ==, RS_FRAME_HEADER + sizeof(in) + DEPTH * NROOTS);
+	size += 3;
+
+	for (i = 0; i < DEPTH * NROOTS / 2; i++)
+		wire[3 + RS_FRAME_HEADER + 100 + i] ^= 0xa5;
+	wire[3 + 4] ^= 0xff;
+
+	for (i = 0; i < G_N_ELEMENTS(steps); i++) {
+		struct rs_unpacker unpacker;
+		GByteArray *out;
+
+		rs_unpacker_init(&unpacker);
+		out = unpack(&unpacker, wire, size, steps[i]);
+		g_assert_cmpmem(out->data, out->len, in, sizeof(in));
+		g_assert_cmpuint(unpacker.frame.frames, ==, 1);
+		g_assert_cmpuint(unpacker.frame.corrected, ==, DEPTH * NROOTS / 2);
+		g_assert_cmpuint(unpacker.frame.failed, ==, 0);
+		rs_unpacker_clear(&unpacker);
+		g_byte_array_unref(out);
+	}
+}
+
+/* one byte too many in a codeword, and the frame is dropped */
+static void
+test_rs_beyond(void)
+{
+	guint8 in[100];
+	guint8 wire[RS_FRAME_BOUND(1)];
+	struct rs_frame frame;
+	struct rs_unpacker unpacker;
+	GByteArray *out;
+	gsize size;
+	guint i;
+
+	memset(in, 0x33, sizeof(in));
+	rs_frame_init(&frame, 4, 1);
+	size = rs_frame_pack(&frame, in, sizeof(in), wire);
+	for (i = 0; i < 3; i++)
+		wire[RS_FRAME_HEADER + i * 10] ^= 0x5a;
+
+	rs_unpacker_init(&unpacker);
+	out = unpack(&unpacker, wire, size, size);
+	g_assert_cmpuint(out->len, ==, 0);
+	g_assert_cmpuint(unpacker.frame.failed, >=, 1);
+	rs_unpacker_clear(&unpacker);
+	g_byte_array_unref(out);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/rs/codeword", test_rs_codeword);
+	g_test_add_func("/rs/frame", test_rs_frame);
+	g_test_add_func("/rs/beyond", test_rs_beyond);
+
+	return g_test_run();
+}
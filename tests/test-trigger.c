@@ -0,0 +1,133 @@
+#include <string.h>
+#include <glib.h>
+#include "trigger.h"
+
+struct match {
+	guint pattern;
+	guint64 offset;
+};
+
+static void
+on_match(guint pattern, guint64 offset, gpointer user_data)
+{
+	GArray *matches = user_data;
+	struct match m = { pattern, offset };
+
+	g_array_append_val(matches, m);
+}
+
+static void
+add(struct trigger *trigger, const char *pattern)
+{
+	ac_add(&trigger->ac, (const guint8 *)pattern, strlen(pattern));
+}
+
+static void
+feed(struct trigger *trigger, const char *in, gsize step, GByteArray *out, GArray *matches)
+{
+	gsize len = strlen(in);
+	gsize offset;
+
+	for (offset = 0; offset < len; offset += step)
+		trigger_feed(trigger, (const guint8 *)in + offset, MIN(step, len - offset), out,
+			     matches ? on_match : NULL, matches);
+}
+
+/* overlapping patterns, and ones cut by the ends of the buffers */
+static void
+test_trigger_match(void)
+{
+	static const char *in = "ushers say she is here";
+	gsize step;
+
+	for (step = 1; step <= strlen(in); step++) {
+		struct trigger trigger;
+		GArray *matches = g_array_new(FALSE, FALSE, sizeof(struct match));
+
+		trigger_init(&trigger);
+		add(&trigger, "he");
+		add(&trigger, "she");
+		add(&trigger, "hers");
+		ac_compile(&trigger.ac);
+		feed(&trigger, in, step, NULL, matches);
+
+		g_assert_cmpuint(matches->len, ==, 6);
+		/* at the end of "ushe", "she" and then the shorter "he" */
+		g_assert_cmpuint(g_array_index(matches, struct match, 0).pattern, ==, 1);
+		g_assert_cmpuint(g_array_index(matches, struct match, 0).offset, ==, 1);
+		g_assert_cmpuint(g_array_index(matches, struct match, 1).pattern, ==, 0);
+		g_assert_cmpuint(g_array_index(matches, struct match, 1).offset, ==, 2);
+		g_assert_cmpuint(g_array_index(matches, struct match, 2).pattern, ==, 2);
+		g_assert_cmpuint(g_array_index(matches, struct match, 2).offset, ==, 2);
+		g_assert_cmpuint(trigger.matches, ==, 6);
+		g_assert_cmpuint(trigger.in, ==, strlen(in));
+		g_assert_cmpuint(trigger.passed, ==, strlen(in));
+
+		trigger_clear(&trigger);
+		g_array_unref(matches);
+	}
+}
+
+/* pre bytes before a match, the match and post bytes after it */
+static void
+test_trigger_gate(void)
+{
+	static const char *in = "aaaaaaaaXYbbbbbbbbbbXYcc";
+	static const char *expect = "aaXYbbbbbXYcc";
+	gsize step;
+
+	for (step = 1; step <= strlen(in); step++) {
+		struct trigger trigger;
+		GByteArray *out = g_byte_array_new();
+
+		trigger_init(&trigger);
+		add(&trigger, "XY");
+		ac_compile(&trigger.ac);
+		trigger.gate = TRUE;
+		trigger.pre = 2;
+		trigger.post = 3;
+		feed(&trigger, in, step, out, NULL);
+		trigger_flush(&trigger, out);
+
+		g_assert_cmpmem(out->data, out->len, expect, strlen(expect));
+		g_assert_cmpuint(trigger.matches, ==, 2);
+		g_assert_cmpuint(trigger.passed, ==, strlen(expect));
+
+		trigger_clear(&trigger);
+		g_byte_array_unref(out);
+	}
+}
+
+/* nothing gets out of the gate without a match */
+static void
+test_trigger_closed(void)
+{
+	struct trigger trigger;
+	GByteArray *out = g_byte_array_new();
+
+	trigger_init(&trigger);
+	add(&trigger, "XY");
+	ac_compile(&trigger.ac);
+	trigger.gate = TRUE;
+	trigger.pre = 4;
+	feed(&trigger, "abcdefghijklmnopX", 5, out, NULL);
+	trigger_flush(&trigger, out);
+
+	g_assert_cmpuint(out->len, ==, 0);
+	g_assert_cmpuint(trigger.passed, ==, 0);
+
+	trigger_clear(&trigger);
+	g_byte_array_unref(out);
+}
+
+int
+main(int argc, char *argv[])
+{
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/trigger/match", test_trigger_match);
+	g_test_add_func("/trigger/gate", test_trigger_gate);
+	g_test_add_func("/trigger/closed", test_trigger_closed);
+
+	return g_test_run();
+}
@@ -0,0 +1,144 @@
+#include <string.h>
+#include <gst/gst.h>
+#include <gst/app/gstappsrc.h>
+#include <gst/app/gstappsink.h>
+
+#define BAUD (3000000)
+#define SIZE (16 * 1024)
+#define CHUNK (1024)
+#define TIMEOUT (5 * GST_SECOND)
+
+/* uartsink writes to one end of a virtual line and uartsrc reads the other */
+static GstElement *
+pipeline_new(const char *line, const char *parity, GstElement ** in, GstElement ** out)
+{
+	GstElement *pipeline;
+	GError *error = NULL;
+	gchar *desc;
+
+	desc = g_strdup_printf("appsrc name=in format=bytes "
+			       "! uartsink device=virtual:%s baud-rate=%d parity=%s "
+			       "uartsrc device=virtual:%s baud-rate=%d parity=%s "
+			       "! appsink name=out sync=false",
+			       line, BAUD, parity, line, BAUD, parity);
+	pipeline = gst_parse_launch(desc, &error);
+	g_assert_no_error(error);
+	g_free(desc);
+
+	*in = gst_bin_get_by_name(GST_BIN(pipeline), "in");
+	*out = gst_bin_get_by_name(GST_BIN(pipeline), "out");
+	g_assert_nonnull(*in);
+	g_assert_nonnull(*out);
+	g_assert_cmpint(gst_element_set_state(pipeline, GST_STATE_PLAYING), !=,
+			GST_STATE_CHANGE_FAILURE);
+
+	return pipeline;
+}
+
+static void
+pipeline_free(GstElement * pipeline, GstElement * in, GstElement * out)
+{
+	gst_element_set_state(pipeline, GST_STATE_NULL);
+	gst_object_unref(in);
+	gst_object_unref(out);
+	gst_object_unref(pipeline);
+}
+
+static void
+push(GstElement * in, const guint8 * data, gsize size)
+{
+	gsize offset;
+
+	for (offset = 0; offset < size; offset += CHUNK) {
+		gsize n = MIN(CHUNK, size - offset);
+		GstBuffer *buffer = gst_buffer_new_allocate(NULL, n, NULL);
+
+		gst_buffer_fill(buffer, 0, data + offset, n);
+		g_assert_cmpint(gst_app_src_push_buffer(GST_APP_SRC(in), buffer), ==, GST_FLOW_OK);
+	}
+	gst_app_src_end_of_stream(GST_APP_SRC(in));
+}
+
+/* uartsrc is live and never ends; pull until size bytes are in */
+static GByteArray *
+pull(GstElement * out, gsize size, GstCaps ** caps)
+{
+	GByteArray *received = g_byte_array_new();
+
+	while (received->len < size) {
+		GstSample *sample = gst_app_sink_try_pull_sample(GST_APP_SINK(out), TIMEOUT);
+		GstMapInfo info;
+
+		g_assert_nonnull(sample);
+		if (caps && !*caps)
+			*caps = gst_caps_ref(gst_sample_get_caps(sample));
+		g_assert_true(gst_buffer_map(gst_sample_get_buffer(sample), &info, GST_MAP_READ));
+		g_byte_array_append(received, info.data, info.size);
+		gst_buffer_unmap(gst_sample_get_buffer(sample), &info);
+		gst_sample_unref(sample);
+	}
+
+	return received;
+}
+
+static void
+test_virtual_data(void)
+{
+	GstElement *pipeline, *in, *out;
+	GByteArray *received;
+	guint8 *data;
+	gsize i;
+
+	data = g_malloc(SIZE);
+	for (i = 0; i < SIZE; i++)
+		data[i] = i * 31 + (i >> 8);
+
+	pipeline = pipeline_new("data", "no", &in, &out);
+	push(in, data, SIZE);
+	received = pull(out, SIZE, NULL);
+	g_assert_cmpmem(received->data, received->len, data, SIZE);
+
+	pipeline_free(pipeline, in, out);
+	g_byte_array_unref(received);
+	g_free(data);
+}
+
+/* uartsrc tells the line settings downstream */
+static void
+test_virtual_caps(void)
+{
+	static const guint8 data[] = "caps";
+	GstElement *pipeline, *in, *out;
+	GstStructure *s;
+	GByteArray *received;
+	GstCaps *caps = NULL;
+	gint baud;
+
+	pipeline = pipeline_new("caps", "even", &in, &out);
+	push(in, data, sizeof(data));
+	received = pull(out, sizeof(data), &caps);
+	g_assert_cmpmem(received->data, received->len, data, sizeof(data));
+
+	g_assert_nonnull(caps);
+	s = gst_caps_get_structure(caps, 0);
+	g_assert_true(gst_structure_has_name(s, "application/x-uart"));
+	g_assert_true(gst_structure_get_int(s, "baud", &baud));
+	g_assert_cmpint(baud, ==, BAUD);
+	g_assert_cmpstr(gst_structure_get_string(s, "parity"), ==, "even");
+
+	pipeline_free(pipeline, in, out);
+	gst_caps_unref(caps);
+	g_byte_array_unref(received);
+}
+
+int
+main(int argc, char *argv[])
+{
+	gst_init(&argc, &argv);
+	g_test_init(&argc, &argv, NULL);
+
+	g_test_add_func("/virtual/data", test_virtual_data);
+	g_test_add_func("/virtual/caps", test_virtual_caps);
+
+	return g_test_run();
+}